@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include <gst/gst.h>
+#include "container-sniff.h"
+#include "gupnp-dlna-profile-private.h"
+
+/*
+ * A cheap look at the first few KB of a file tells us which container it
+ * uses, if any, and thus which profiles it could possibly match. The
+ * profiles that use a different container can be dropped before matching,
+ * and files that no profile could match at all need not be discovered.
+ *
+ * The classification only has to be as good as GStreamer's typefinding for
+ * the formats we have profiles for. Anything ambiguous is classified as
+ * GUPNP_DLNA_SNIFF_UNKNOWN, which filters nothing.
+ */
+
+#define SNIFF_SIZE 4096
+
+#define TS_PACKET_SIZE 188
+#define TS_SYNC_PACKETS 3
+
+static const guint8 asf_guid[] = {
+        0x30, 0x26, 0xb2, 0x75, 0x8e, 0x66, 0xcf, 0x11,
+        0xa6, 0xd9, 0x00, 0xaa, 0x00, 0x62, 0xce, 0x6c
+};
+
+static const guint8 png_signature[] = {
+        0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'
+};
+
+/* Extensions of files that commonly sit next to media files. These are only
+ * classified as not being media if their contents do not look like any of
+ * the formats above either. */
+static const gchar *not_media_extensions[] = {
+        "srt", "sub", "idx", "ssa", "ass", "smi", "vtt",
+        "nfo", "txt", "log", "xml", "htm", "html", "url",
+        "m3u", "m3u8", "pls", "cue", "sfv", "md5", "par2",
+        "db", "ini", "nzb", "torrent", "ds_store",
+        NULL
+};
+
+static const gchar *sniff_class_names[] = {
+        "unknown",
+        "not-media",
+        "image",
+        "audio",
+        "mp4",
+        "mpeg-ts",
+        "mpeg-ps",
+        "asf"
+};
+
+static gboolean
+is_ts (const guint8 *data, gsize size, gsize offset, gsize packet_size)
+{
+        guint i;
+
+        for (i = 0; i < TS_SYNC_PACKETS; i++) {
+                gsize pos = offset + i * packet_size;
+
+                if (pos >= size || data[pos] != 0x47)
+                        return FALSE;
+        }
+
+        return TRUE;
+}
+
+static gboolean
+is_mpeg_audio (const guint8 *data, gsize size)
+{
+        if (size < 2)
+                return FALSE;
+
+        /* MPEG audio (layer != 0) or ADTS (layer == 0) sync word */
+        if (data[0] == 0xff && (data[1] & 0xe0) == 0xe0)
+                return TRUE;
+
+        /* AC-3 */
+        if (data[0] == 0x0b && data[1] == 0x77)
+                return TRUE;
+
+        return FALSE;
+}
+
+static GUPnPDLNASniffClass
+sniff_data (const guint8 *data, gsize size)
+{
+        if (size >= 3 && data[0] == 0xff && data[1] == 0xd8 && data[2] == 0xff)
+                return GUPNP_DLNA_SNIFF_IMAGE;
+
+        if (size >= sizeof (png_signature) &&
+            memcmp (data, png_signature, sizeof (png_signature)) == 0)
+                return GUPNP_DLNA_SNIFF_IMAGE;
+
+        if (size >= 8 &&
+            (memcmp (data + 4, "ftyp", 4) == 0 ||
+             memcmp (data + 4, "moov", 4) == 0 ||
+             memcmp (data + 4, "mdat", 4) == 0 ||
+             memcmp (data + 4, "wide", 4) == 0 ||
+             memcmp (data + 4, "free", 4) == 0))
+                return GUPNP_DLNA_SNIFF_MP4;
+
+        if (size >= sizeof (asf_guid) &&
+            memcmp (data, asf_guid, sizeof (asf_guid)) == 0)
+                return GUPNP_DLNA_SNIFF_ASF;
+
+        /* Plain and timestamped (M2TS) transport streams */
+        if (is_ts (data, size, 0, TS_PACKET_SIZE) ||
+            is_ts (data, size, 4, TS_PACKET_SIZE + 4))
+                return GUPNP_DLNA_SNIFF_MPEG_TS;
+
+        if (size >= 4 &&
+            data[0] == 0x00 && data[1] == 0x00 &&
+            data[2] == 0x01 && data[3] == 0xba)
+                return GUPNP_DLNA_SNIFF_MPEG_PS;
+
+        if ((size >= 3 && memcmp (data, "ID3", 3) == 0) ||
+            (size >= 5 && memcmp (data, "#!AMR", 5) == 0) ||
+            is_mpeg_audio (data, size))
+                return GUPNP_DLNA_SNIFF_AUDIO;
+
+        return GUPNP_DLNA_SNIFF_UNKNOWN;
+}
+
+static gboolean
+has_not_media_extension (const gchar *path)
+{
+        const gchar *ext;
+        guint i;
+
+        ext = strrchr (path, '.');
+        if (!ext || strchr (ext, G_DIR_SEPARATOR))
+                return FALSE;
+
+        for (i = 0; not_media_extensions[i]; i++)
+                if (g_ascii_strcasecmp (ext + 1, not_media_extensions[i]) == 0)
+                        return TRUE;
+
+        return FALSE;
+}
+
+/*
+ * Classifies the media at @uri from its first few KB and its file name.
+ * Non-local URIs are not sniffed and are always GUPNP_DLNA_SNIFF_UNKNOWN.
+ */
+GUPnPDLNASniffClass
+gupnp_dlna_sniff_uri (const gchar *uri)
+{
+        GUPnPDLNASniffClass ret;
+        GMappedFile *file;
+        gchar *path;
+
+        path = g_filename_from_uri (uri, NULL, NULL);
+        if (!path)
+                return GUPNP_DLNA_SNIFF_UNKNOWN;
+
+        file = g_mapped_file_new (path, FALSE, NULL);
+        if (!file) {
+                g_free (path);
+
+                return GUPNP_DLNA_SNIFF_UNKNOWN;
+        }
+
+        ret = sniff_data ((const guint8 *) g_mapped_file_get_contents (file),
+                          MIN (g_mapped_file_get_length (file), SNIFF_SIZE));
+
+        if (ret == GUPNP_DLNA_SNIFF_UNKNOWN && has_not_media_extension (path))
+                ret = GUPNP_DLNA_SNIFF_NOT_MEDIA;
+
+        g_mapped_file_unref (file);
+        g_free (path);
+
+        return ret;
+}
+
+const gchar *
+gupnp_dlna_sniff_class_get_name (GUPnPDLNASniffClass sniff_class)
+{
+        g_return_val_if_fail (sniff_class < GUPNP_DLNA_SNIFF_LAST, NULL);
+
+        return sniff_class_names[sniff_class];
+}
+
+static gboolean
+caps_has_name (const GstCaps *caps, const gchar *name)
+{
+        guint i;
+
+        for (i = 0; i < gst_caps_get_size (caps); i++)
+                if (gst_structure_has_name (gst_caps_get_structure (caps, i),
+                                            name))
+                        return TRUE;
+
+        return FALSE;
+}
+
+/*
+ * Returns TRUE if a file of class @sniff_class could match @profile, judging
+ * by the container the profile requires.
+ */
+gboolean
+gupnp_dlna_sniff_class_accepts (GUPnPDLNASniffClass sniff_class,
+                                GUPnPDLNAProfile    *profile)
+{
+        const GstCaps *container, *video;
+        gboolean has_container, has_video;
+
+        container = gupnp_dlna_profile_get_container_caps (profile);
+        video = gupnp_dlna_profile_get_video_caps (profile);
+        has_container = container && !gst_caps_is_empty (container);
+        has_video = video && !gst_caps_is_empty (video);
+
+        switch (sniff_class) {
+                case GUPNP_DLNA_SNIFF_NOT_MEDIA:
+                        return FALSE;
+
+                case GUPNP_DLNA_SNIFF_IMAGE:
+                        return has_video && !has_container;
+
+                case GUPNP_DLNA_SNIFF_AUDIO:
+                        return !has_video &&
+                               (!has_container ||
+                                caps_has_name (container,
+                                               "application/x-id3"));
+
+                case GUPNP_DLNA_SNIFF_MP4:
+                        return has_container &&
+                               (caps_has_name (container,
+                                               "video/quicktime") ||
+                                caps_has_name (container,
+                                               "application/x-3gp"));
+
+                case GUPNP_DLNA_SNIFF_MPEG_TS:
+                        return has_container &&
+                               caps_has_name (container, "video/mpegts");
+
+                case GUPNP_DLNA_SNIFF_MPEG_PS:
+                        return has_container &&
+                               caps_has_name (container, "video/mpeg");
+
+                case GUPNP_DLNA_SNIFF_ASF:
+                        return has_container &&
+                               caps_has_name (container, "video/x-ms-asf");
+
+                default:
+                        return TRUE;
+        }
+}
+
+/*
+ * Returns a new list with the profiles of @profiles that a file of class
+ * @sniff_class could match. The profiles are not referenced.
+ */
+GList *
+gupnp_dlna_sniff_filter_profiles (GUPnPDLNASniffClass sniff_class,
+                                  const GList         *profiles)
+{
+        const GList *i;
+        GList *ret = NULL;
+
+        for (i = profiles; i; i = i->next)
+                if (gupnp_dlna_sniff_class_accepts (sniff_class, i->data))
+                        ret = g_list_prepend (ret, i->data);
+
+        return g_list_reverse (ret);
+}
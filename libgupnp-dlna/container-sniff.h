@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GUPNP_DLNA_CONTAINER_SNIFF_H__
+#define __GUPNP_DLNA_CONTAINER_SNIFF_H__
+
+#include <glib.h>
+#include "gupnp-dlna-profile.h"
+
+G_BEGIN_DECLS
+
+typedef enum {
+        GUPNP_DLNA_SNIFF_UNKNOWN,
+        GUPNP_DLNA_SNIFF_NOT_MEDIA,
+        GUPNP_DLNA_SNIFF_IMAGE,
+        GUPNP_DLNA_SNIFF_AUDIO,
+        GUPNP_DLNA_SNIFF_MP4,
+        GUPNP_DLNA_SNIFF_MPEG_TS,
+        GUPNP_DLNA_SNIFF_MPEG_PS,
+        GUPNP_DLNA_SNIFF_ASF,
+        GUPNP_DLNA_SNIFF_LAST
+} GUPnPDLNASniffClass;
+
+GUPnPDLNASniffClass
+gupnp_dlna_sniff_uri (const gchar *uri);
+
+const gchar *
+gupnp_dlna_sniff_class_get_name (GUPnPDLNASniffClass sniff_class);
+
+gboolean
+gupnp_dlna_sniff_class_accepts (GUPnPDLNASniffClass sniff_class,
+                                GUPnPDLNAProfile    *profile);
+
+GList *
+gupnp_dlna_sniff_filter_profiles (GUPnPDLNASniffClass sniff_class,
+                                  const GList         *profiles);
+
+G_END_DECLS
+
+#endif /* __GUPNP_DLNA_CONTAINER_SNIFF_H__ */
@@ -0,0 +1,647 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include <gst/gst.h>
+#include "fast-probe.h"
+
+/*
+ * Some formats can be described well enough for profile matching by reading
+ * a few header fields, which is a lot cheaper than running a GstDiscoverer
+ * pipeline over the file. This is currently done for still images, where the
+ * DLNA profiles only restrict the dimensions (and, for PNG, the depth), and
+ * for MP3 and AAC ADTS audio, where they only restrict fields found in the
+ * frame headers.
+ *
+ * The file is mapped rather than read, so only the pages that hold the
+ * headers are actually paged in. Anything unusual makes the probe give up,
+ * and the caller is expected to fall back to a regular discovery then.
+ */
+
+static const guint8 png_signature[] = {
+        0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'
+};
+
+/* JPEG markers */
+#define JPEG_SOF0 0xc0 /* Baseline */
+#define JPEG_SOF1 0xc1 /* Extended sequential, Huffman */
+#define JPEG_SOF2 0xc2 /* Progressive, Huffman */
+#define JPEG_DHT  0xc4
+#define JPEG_JPG  0xc8
+#define JPEG_DAC  0xcc
+#define JPEG_RST0 0xd0
+#define JPEG_RST7 0xd7
+#define JPEG_EOI  0xd9
+#define JPEG_SOS  0xda
+#define JPEG_TEM  0x01
+
+/* PNG colour types */
+#define PNG_COLOR_GRAY       0
+#define PNG_COLOR_RGB        2
+#define PNG_COLOR_PALETTE    3
+#define PNG_COLOR_GRAY_ALPHA 4
+#define PNG_COLOR_RGB_ALPHA  6
+
+static GUPnPDLNAStreamDescription *
+image_description_new (const gchar *name, gint width, gint height, gint depth)
+{
+        GUPnPDLNAStreamDescription *desc;
+        GstCaps *caps;
+
+        caps = gst_caps_new_simple (name,
+                                    "width", G_TYPE_INT, width,
+                                    "height", G_TYPE_INT, height,
+                                    NULL);
+        if (depth)
+                gst_caps_set_simple (caps, "depth", G_TYPE_INT, depth, NULL);
+
+        desc = gupnp_dlna_stream_description_new ();
+        desc->video = g_list_append (NULL, caps);
+        desc->is_image = TRUE;
+
+        return desc;
+}
+
+/*
+ * Walks the marker segments up to the first start of frame. Only the frame
+ * types that jpegdec can decode are handled, so that arithmetic coded,
+ * lossless or hierarchical images end up going through GStreamer just like
+ * before.
+ */
+static GUPnPDLNAStreamDescription *
+probe_jpeg (const guint8 *data, gsize size)
+{
+        gsize pos = 2;
+
+        while (pos + 4 <= size) {
+                guint8 marker;
+                guint16 length;
+
+                if (data[pos] != 0xff)
+                        return NULL;
+
+                marker = data[pos + 1];
+
+                /* Fill bytes */
+                if (marker == 0xff) {
+                        pos++;
+                        continue;
+                }
+
+                pos += 2;
+
+                /* Markers without a segment */
+                if (marker == JPEG_TEM ||
+                    (marker >= JPEG_RST0 && marker <= JPEG_RST7))
+                        continue;
+
+                /* No frame header before the image data */
+                if (marker == JPEG_SOS || marker == JPEG_EOI)
+                        return NULL;
+
+                length = GST_READ_UINT16_BE (data + pos);
+                if (length < 2 || pos + length > size)
+                        return NULL;
+
+                if (marker == JPEG_SOF0 ||
+                    marker == JPEG_SOF1 ||
+                    marker == JPEG_SOF2) {
+                        guint16 width, height;
+                        guint8 components;
+
+                        if (length < 8)
+                                return NULL;
+
+                        height = GST_READ_UINT16_BE (data + pos + 3);
+                        width = GST_READ_UINT16_BE (data + pos + 5);
+                        components = data[pos + 7];
+
+                        /* A zero height is defined later on by a DNL
+                         * marker, and CMYK/YCCK images are not handled by
+                         * jpegdec */
+                        if (width == 0 || height == 0 ||
+                            (components != 1 && components != 3))
+                                return NULL;
+
+                        return image_description_new ("image/jpeg",
+                                                      width,
+                                                      height,
+                                                      0);
+                } else if (marker >= 0xc0 && marker <= 0xcf &&
+                           marker != JPEG_DHT &&
+                           marker != JPEG_JPG &&
+                           marker != JPEG_DAC)
+                        /* Some other kind of frame */
+                        return NULL;
+
+                pos += length;
+        }
+
+        return NULL;
+}
+
+/*
+ * Reads the IHDR chunk, and scans the chunks before the image data for
+ * transparency and animation. The depth reported is the one of the buffers
+ * pngdec would output for the image, which is what the discoverer reports.
+ */
+static GUPnPDLNAStreamDescription *
+probe_png (const guint8 *data, gsize size)
+{
+        guint32 width, height;
+        guint8 bit_depth, color_type;
+        gboolean has_trns = FALSE;
+        gsize pos;
+        gint depth;
+
+        /* Signature + IHDR length, type, data and CRC */
+        if (size < 8 + 8 + 13 + 4 ||
+            GST_READ_UINT32_BE (data + 8) != 13 ||
+            memcmp (data + 12, "IHDR", 4) != 0)
+                return NULL;
+
+        width = GST_READ_UINT32_BE (data + 16);
+        height = GST_READ_UINT32_BE (data + 20);
+        bit_depth = data[24];
+        color_type = data[25];
+
+        if (width == 0 || width > G_MAXINT || height == 0 || height > G_MAXINT)
+                return NULL;
+
+        for (pos = 8 + 8 + 13 + 4; pos + 8 <= size;) {
+                guint32 length = GST_READ_UINT32_BE (data + pos);
+                const guint8 *type = data + pos + 4;
+
+                if (memcmp (type, "IDAT", 4) == 0)
+                        break;
+                else if (memcmp (type, "tRNS", 4) == 0)
+                        has_trns = TRUE;
+                else if (memcmp (type, "acTL", 4) == 0)
+                        /* Animated PNG */
+                        return NULL;
+
+                if (size - pos < 12 || length > size - pos - 12)
+                        return NULL;
+
+                pos += 12 + length;
+        }
+
+        switch (color_type) {
+                case PNG_COLOR_GRAY:
+                        if (has_trns)
+                                return NULL;
+                        depth = (bit_depth == 16) ? 16 : 8;
+
+                        break;
+
+                case PNG_COLOR_RGB:
+                        if (bit_depth != 8 || has_trns)
+                                return NULL;
+                        depth = 24;
+
+                        break;
+
+                case PNG_COLOR_PALETTE:
+                        depth = has_trns ? 32 : 24;
+
+                        break;
+
+                case PNG_COLOR_GRAY_ALPHA:
+                case PNG_COLOR_RGB_ALPHA:
+                        if (bit_depth != 8)
+                                return NULL;
+                        depth = 32;
+
+                        break;
+
+                default:
+                        return NULL;
+        }
+
+        return image_description_new ("image/png", width, height, depth);
+}
+
+/*
+ * MPEG audio (MP3) and AAC ADTS streams have no global header, but each
+ * frame starts with a header that carries everything the profiles restrict
+ * except for the bitrate. For MP3, the bitrate is taken from the Xing or
+ * VBRI header if there is one. Otherwise, and for ADTS, the frames of a few
+ * windows spread across the file are read and the bitrate is averaged over
+ * them, which is a lot more reliable than the first few frames aacparse uses
+ * for its estimate.
+ */
+
+typedef struct {
+        gint        mpegversion;
+        gint        mpegaudioversion; /* MP3 only */
+        gint        layer;            /* MP3 only */
+        const gchar *profile;         /* AAC only */
+        gint        rate;
+        gint        channels;
+        guint       length;           /* in bytes */
+        guint       samples;
+        guint       bitrate;          /* MP3 only */
+} AudioFrame;
+
+typedef gboolean (* ParseFrameFunc) (const guint8 *data,
+                                     gsize        size,
+                                     AudioFrame   *frame);
+
+/* Number of consecutive frames that must be found at the start of the
+ * stream before it is trusted to be MP3 or ADTS */
+#define AUDIO_SYNC_FRAMES 3
+/* Bitrate sampling */
+#define AUDIO_WINDOWS 8
+#define AUDIO_WINDOW_FRAMES 16
+#define AUDIO_RESYNC_LIMIT 8192
+
+#define ID3V2_HEADER_SIZE 10
+#define ID3V1_SIZE 128
+
+static const guint mp3_bitrates[2][16] = {
+        /* MPEG-1 Layer III */
+        { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320,
+          0 },
+        /* MPEG-2 and MPEG-2.5 Layer III */
+        { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0 }
+};
+
+static const guint mp3_rates[3] = { 44100, 48000, 32000 };
+
+/* What the rates above are divided by, indexed by the version bits:
+ * MPEG-2.5, reserved, MPEG-2, MPEG-1 */
+static const guint mp3_rate_divisors[4] = { 4, 0, 2, 1 };
+
+static const guint aac_rates[13] = {
+        96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000,
+        11025, 8000, 7350
+};
+
+static const gchar *aac_profiles[4] = { "main", "lc", "ssr", "ltp" };
+
+static gboolean
+parse_mp3_frame (const guint8 *data, gsize size, AudioFrame *frame)
+{
+        guint version, layer, bitrate_index, rate_index, padding;
+
+        if (size < 4 || data[0] != 0xff || (data[1] & 0xe0) != 0xe0)
+                return FALSE;
+
+        /* 0: MPEG-2.5, 1: reserved, 2: MPEG-2, 3: MPEG-1 */
+        version = (data[1] >> 3) & 0x3;
+        /* 1: Layer III, 2: Layer II, 3: Layer I */
+        layer = (data[1] >> 1) & 0x3;
+        bitrate_index = data[2] >> 4;
+        rate_index = (data[2] >> 2) & 0x3;
+        padding = (data[2] >> 1) & 0x1;
+
+        /* Only Layer III is handled, and free format streams have no
+         * bitrate in their headers */
+        if (version == 1 || layer != 1 ||
+            bitrate_index == 0 || bitrate_index == 15 || rate_index == 3)
+                return FALSE;
+
+        frame->mpegversion = 1;
+        frame->layer = 3;
+        frame->profile = NULL;
+        frame->channels = ((data[3] >> 6) == 0x3) ? 1 : 2;
+        frame->rate = mp3_rates[rate_index] / mp3_rate_divisors[version];
+
+        if (version == 3) {
+                frame->mpegaudioversion = 1;
+                frame->samples = 1152;
+                frame->bitrate = mp3_bitrates[0][bitrate_index] * 1000;
+                frame->length = 144 * frame->bitrate / frame->rate + padding;
+        } else {
+                frame->mpegaudioversion = (version == 2) ? 2 : 3;
+                frame->samples = 576;
+                frame->bitrate = mp3_bitrates[1][bitrate_index] * 1000;
+                frame->length = 72 * frame->bitrate / frame->rate + padding;
+        }
+
+        return TRUE;
+}
+
+static gboolean
+parse_adts_frame (const guint8 *data, gsize size, AudioFrame *frame)
+{
+        guint rate_index, channel_config, header_size;
+
+        /* Sync word, and layer is always 0 */
+        if (size < 7 || data[0] != 0xff || (data[1] & 0xf6) != 0xf0)
+                return FALSE;
+
+        rate_index = (data[2] >> 2) & 0xf;
+        channel_config = ((data[2] & 0x1) << 2) | (data[3] >> 6);
+
+        /* A channel configuration of 0 means that it is given by a program
+         * config element in the raw data, which we do not parse */
+        if (rate_index >= G_N_ELEMENTS (aac_rates) || channel_config == 0)
+                return FALSE;
+
+        frame->mpegversion = (data[1] & 0x08) ? 2 : 4;
+        frame->mpegaudioversion = 0;
+        frame->layer = 0;
+        frame->profile = aac_profiles[data[2] >> 6];
+        frame->rate = aac_rates[rate_index];
+        frame->channels = (channel_config == 7) ? 8 : channel_config;
+        frame->length = ((data[3] & 0x3) << 11) |
+                        (data[4] << 3) |
+                        (data[5] >> 5);
+        frame->samples = 1024 * ((data[6] & 0x3) + 1);
+        frame->bitrate = 0;
+
+        header_size = (data[1] & 0x1) ? 7 : 9;
+        if (frame->length <= header_size)
+                return FALSE;
+
+        return TRUE;
+}
+
+static gboolean
+audio_frames_match (const AudioFrame *a, const AudioFrame *b)
+{
+        return a->mpegversion == b->mpegversion &&
+               a->mpegaudioversion == b->mpegaudioversion &&
+               a->layer == b->layer &&
+               a->profile == b->profile &&
+               a->rate == b->rate &&
+               a->channels == b->channels;
+}
+
+/* Checks whether a frame like @ref starts at @pos, and is followed by
+ * another one (unless it is the last frame) */
+static gboolean
+audio_frame_at (const guint8     *data,
+                gsize            pos,
+                gsize            end,
+                ParseFrameFunc   parse,
+                const AudioFrame *ref,
+                AudioFrame       *frame)
+{
+        AudioFrame next;
+
+        if (!parse (data + pos, end - pos, frame) ||
+            !audio_frames_match (ref, frame) ||
+            frame->length > end - pos)
+                return FALSE;
+
+        pos += frame->length;
+
+        return pos == end ||
+               (parse (data + pos, end - pos, &next) &&
+                audio_frames_match (ref, &next));
+}
+
+/* Averages the bitrate over the frames of AUDIO_WINDOWS windows evenly
+ * spread between @start and @end. If all of those frames have the same
+ * nominal bitrate, that is returned instead, as the padding of CBR streams
+ * would otherwise make the average slightly off. Returns 0 if too few frames
+ * were found. */
+static guint
+audio_sample_bitrate (const guint8     *data,
+                      gsize            start,
+                      gsize            end,
+                      ParseFrameFunc   parse,
+                      const AudioFrame *ref)
+{
+        guint64 bytes = 0, samples = 0;
+        guint w, n, n_frames = 0;
+        gboolean constant = TRUE;
+
+        for (w = 0; w < AUDIO_WINDOWS; w++) {
+                gsize pos = start + (end - start) / AUDIO_WINDOWS * w;
+                gsize limit = MIN (pos + AUDIO_RESYNC_LIMIT, end);
+                AudioFrame frame;
+
+                while (pos < limit &&
+                       !audio_frame_at (data, pos, end, parse, ref, &frame))
+                        pos++;
+
+                for (n = 0; n < AUDIO_WINDOW_FRAMES && pos < end; n++) {
+                        if (!parse (data + pos, end - pos, &frame) ||
+                            !audio_frames_match (ref, &frame) ||
+                            frame.length > end - pos)
+                                break;
+
+                        if (frame.bitrate != ref->bitrate)
+                                constant = FALSE;
+
+                        bytes += frame.length;
+                        samples += frame.samples;
+                        n_frames++;
+                        pos += frame.length;
+                }
+        }
+
+        if (n_frames < AUDIO_SYNC_FRAMES)
+                return 0;
+
+        if (constant && ref->bitrate)
+                return ref->bitrate;
+
+        return (guint) gst_util_uint64_scale (bytes * 8, ref->rate, samples);
+}
+
+/* Reads the Xing/Info or VBRI header that encoders put in the first frame of
+ * VBR streams. Returns 0 if there is none. */
+static guint
+mp3_vbr_bitrate (const guint8     *data,
+                 gsize            start,
+                 gsize            end,
+                 const AudioFrame *frame)
+{
+        const guint8 *xing, *vbri;
+        guint32 flags, n_frames = 0;
+        guint64 bytes = end - start;
+        gsize side_info;
+
+        if (frame->mpegaudioversion == 1)
+                side_info = (frame->channels == 1) ? 17 : 32;
+        else
+                side_info = (frame->channels == 1) ? 9 : 17;
+
+        xing = data + start + 4 + side_info;
+        vbri = data + start + 4 + 32;
+
+        /* LAME writes an "Info" header with the same layout for CBR streams,
+         * for which the nominal bitrate of the frames is more accurate */
+        if (4 + side_info + 16 <= frame->length &&
+            memcmp (xing, "Xing", 4) == 0) {
+                flags = GST_READ_UINT32_BE (xing + 4);
+                xing += 8;
+
+                if (flags & 0x1) {
+                        n_frames = GST_READ_UINT32_BE (xing);
+                        xing += 4;
+                }
+
+                if (flags & 0x2)
+                        bytes = GST_READ_UINT32_BE (xing);
+        } else if (4 + 32 + 18 <= frame->length &&
+                   memcmp (vbri, "VBRI", 4) == 0) {
+                bytes = GST_READ_UINT32_BE (vbri + 10);
+                n_frames = GST_READ_UINT32_BE (vbri + 14);
+        }
+
+        if (n_frames == 0 || bytes == 0)
+                return 0;
+
+        return (guint) gst_util_uint64_scale (bytes * 8,
+                                              frame->rate,
+                                              (guint64) n_frames *
+                                              frame->samples);
+}
+
+static GUPnPDLNAStreamDescription *
+probe_audio (const guint8 *data, gsize size)
+{
+        GUPnPDLNAStreamDescription *desc;
+        ParseFrameFunc parse;
+        AudioFrame first, frame;
+        GstCaps *caps;
+        gsize start = 0, end = size, pos;
+        gboolean has_id3 = FALSE;
+        guint i, bitrate = 0;
+
+        /* ID3v2 tag */
+        if (size >= ID3V2_HEADER_SIZE && memcmp (data, "ID3", 3) == 0) {
+                start = ID3V2_HEADER_SIZE +
+                        (((data[6] & 0x7f) << 21) |
+                         ((data[7] & 0x7f) << 14) |
+                         ((data[8] & 0x7f) << 7) |
+                         (data[9] & 0x7f));
+                /* Footer */
+                if (data[5] & 0x10)
+                        start += ID3V2_HEADER_SIZE;
+                has_id3 = TRUE;
+        }
+
+        /* Without an ID3v2 tag, whether an ID3v1 tag shows up as a container
+         * depends on typefinding, and APE tags need apedemux, so leave those
+         * to the discoverer */
+        if (size >= ID3V1_SIZE &&
+            memcmp (data + size - ID3V1_SIZE, "TAG", 3) == 0) {
+                if (!has_id3)
+                        return NULL;
+                end -= ID3V1_SIZE;
+        }
+
+        if (end >= 32 && memcmp (data + end - 32, "APETAGEX", 8) == 0)
+                return NULL;
+
+        if (start >= end)
+                return NULL;
+
+        if (parse_mp3_frame (data + start, end - start, &first))
+                parse = parse_mp3_frame;
+        else if (parse_adts_frame (data + start, end - start, &first))
+                parse = parse_adts_frame;
+        else
+                return NULL;
+
+        /* Make sure this was not just a stray sync word */
+        for (i = 0, pos = start; i < AUDIO_SYNC_FRAMES; i++) {
+                if (!audio_frame_at (data, pos, end, parse, &first, &frame))
+                        return NULL;
+
+                pos += frame.length;
+                if (pos == end)
+                        break;
+        }
+
+        if (parse == parse_mp3_frame)
+                bitrate = mp3_vbr_bitrate (data, start, end, &first);
+
+        if (bitrate == 0)
+                bitrate = audio_sample_bitrate (data, start, end, parse, &first);
+
+        if (bitrate == 0)
+                return NULL;
+
+        if (parse == parse_mp3_frame)
+                caps = gst_caps_new_simple ("audio/mpeg",
+                                            "mpegversion", G_TYPE_INT, 1,
+                                            "mpegaudioversion", G_TYPE_INT,
+                                            first.mpegaudioversion,
+                                            "layer", G_TYPE_INT, 3,
+                                            NULL);
+        else
+                caps = gst_caps_new_simple ("audio/mpeg",
+                                            "mpegversion", G_TYPE_INT,
+                                            first.mpegversion,
+                                            "stream-format", G_TYPE_STRING,
+                                            "adts",
+                                            "profile", G_TYPE_STRING,
+                                            first.profile,
+                                            NULL);
+
+        gst_caps_set_simple (caps,
+                             "rate", G_TYPE_INT, first.rate,
+                             "channels", G_TYPE_INT, first.channels,
+                             "bitrate", G_TYPE_INT, bitrate,
+                             NULL);
+
+        desc = gupnp_dlna_stream_description_new ();
+        desc->audio = g_list_append (NULL, caps);
+        if (has_id3)
+                desc->container = gst_caps_new_simple ("application/x-id3",
+                                                       NULL);
+
+        return desc;
+}
+
+/*
+ * Returns a description of the media at @uri, or NULL if @uri is not a local
+ * file of a format that can be probed by parsing its headers.
+ */
+GUPnPDLNAStreamDescription *
+gupnp_dlna_fast_probe_uri (const gchar *uri)
+{
+        GUPnPDLNAStreamDescription *desc = NULL;
+        GMappedFile *file;
+        const guint8 *data;
+        gchar *path;
+        gsize size;
+
+        path = g_filename_from_uri (uri, NULL, NULL);
+        if (!path)
+                return NULL;
+
+        file = g_mapped_file_new (path, FALSE, NULL);
+        g_free (path);
+        if (!file)
+                return NULL;
+
+        data = (const guint8 *) g_mapped_file_get_contents (file);
+        size = g_mapped_file_get_length (file);
+
+        if (size >= sizeof (png_signature) &&
+            memcmp (data, png_signature, sizeof (png_signature)) == 0)
+                desc = probe_png (data, size);
+        else if (size >= 3 &&
+                 data[0] == 0xff && data[1] == 0xd8 && data[2] == 0xff)
+                desc = probe_jpeg (data, size);
+        else
+                desc = probe_audio (data, size);
+
+        g_mapped_file_unref (file);
+
+        return desc;
+}
@@ -19,9 +19,15 @@
  * Boston, MA 02111-1307, USA.
  */
 
+#include <string.h>
+#include <glib/gstdio.h>
 #include "gupnp-dlna-discoverer.h"
 #include "gupnp-dlna-marshal.h"
-#include "profile-loading.h"
+#include "profile-registry.h"
+#include "profile-order.h"
+#include "stream-description.h"
+#include "fast-probe.h"
+#include "container-sniff.h"
 
 /**
  * SECTION:gupnp-dlna-discoverer
@@ -40,6 +46,64 @@
  * The asynchronous mode requires a running #GMainLoop in the default
  * #GMainContext, where one connects to the various signals, appends the
  * URIs to be processed and then asks for the discovery to begin.
+ *
+ * Results of synchronous discovery of local files can be kept in an
+ * in-memory cache by setting the #GUPnPDLNADiscoverer:cache-size property.
+ * A cached result is only returned as long as the size and modification time
+ * of the file have not changed since it was discovered. Discoveries that did
+ * not complete, such as those that timed out, are not cached, and the cache
+ * is emptied whenever #GUPnPDLNADiscoverer:fast-probe or
+ * #GUPnPDLNADiscoverer:compact-results is changed.
+ *
+ * Setting the #GUPnPDLNADiscoverer:fast-probe property lets synchronous
+ * discovery of local JPEG and PNG images, and of MP3 and AAC ADTS audio files,
+ * read the headers directly instead of running a GStreamer pipeline over the
+ * file. The #GUPnPDLNAInformation returned for such files has no
+ * #GstDiscovererInfo.
+ *
+ * Applications that keep many results around can set
+ * #GUPnPDLNADiscoverer:compact-results so that the #GstDiscovererInfo is
+ * dropped as soon as the profile has been matched. The results then only
+ * carry the profile name, MIME type and the summary returned by
+ * gupnp_dlna_information_get_summary().
+ *
+ * Before being discovered, local files are classified by looking at their
+ * first few bytes, and only the profiles using a matching container are
+ * considered for them. With #GUPnPDLNADiscoverer:skip-non-media set, files
+ * that do not look like media at all (such as subtitles or playlists) are
+ * not discovered: synchronous discovery fails right away, and they are not
+ * queued for asynchronous discovery.
+ *
+ * The time taken by each synchronous discovery is recorded in a histogram
+ * per kind of file, which can be retrieved with
+ * gupnp_dlna_discoverer_get_latency_histograms(). Once enough files of a kind
+ * have been seen, setting #GUPnPDLNADiscoverer:adaptive-timeout shortens the
+ * timeout used for such files to a multiple of their 99th percentile, so that
+ * a few broken files do not each hold up a scan for the full timeout. A file
+ * that times out with a shortened timeout is given the full one before
+ * discovery is considered to have failed.
+ *
+ * Setting #GUPnPDLNADiscoverer:collect-stats makes the discoverer count how
+ * often each profile is checked and matched, which restriction fields reject
+ * it, and how long discovery and matching take. These statistics can be
+ * retrieved with gupnp_dlna_discoverer_get_stats().
+ *
+ * Profiles are checked one after the other until one of them matches. With
+ * #GUPnPDLNADiscoverer:adaptive-order set, the profiles that were matched most
+ * often are checked first, which shortens matching when most files use a
+ * handful of profiles. Profiles that could match the same file keep their
+ * relative order, so the results are the same as without it. What was learnt
+ * can be kept across runs with gupnp_dlna_discoverer_save_profile_order() and
+ * gupnp_dlna_discoverer_load_profile_order().
+ *
+ * To serve media that a client cannot play as it is, the profiles that the
+ * client supports can be sorted by how much work it would take to transcode
+ * the media to them with gupnp_dlna_discoverer_rank_targets(): streams that
+ * already fit a profile are passed through, so a profile that only needs the
+ * streams put into another container comes before one that needs the audio
+ * re-encoded, which comes before one that needs the video re-encoded.
+ * gupnp_dlna_discoverer_get_passthrough_profile() then gives an encoding
+ * profile for the chosen one that leaves the streams that fit untouched.
  */
 enum {
         DONE,
@@ -58,17 +122,310 @@ G_DEFINE_TYPE (GUPnPDLNADiscoverer, gupnp_dlna_discoverer, GST_TYPE_DISCOVERER)
 
 typedef struct _GUPnPDLNADiscovererPrivate GUPnPDLNADiscovererPrivate;
 
+/* Bucket i counts discoveries that took [2^i, 2^(i+1)) microseconds, the
+ * first one also counting anything faster and the last one anything slower */
+#define LATENCY_BUCKETS 32
+
+typedef struct {
+        guint   buckets[LATENCY_BUCKETS];
+        guint   count;
+        guint   timeouts;
+        guint64 total;
+} LatencyHistogram;
+
+/* The adaptive timeout for a kind of file is ADAPTIVE_TIMEOUT_FACTOR times
+ * the 99th percentile of its latencies, once there are at least
+ * ADAPTIVE_TIMEOUT_MIN_SAMPLES of those. It is never shorter than
+ * ADAPTIVE_TIMEOUT_MIN, nor longer than the timeout set on the discoverer. */
+#define ADAPTIVE_TIMEOUT_FACTOR 4
+#define ADAPTIVE_TIMEOUT_MIN_SAMPLES 32
+#define ADAPTIVE_TIMEOUT_MIN GST_SECOND
+
 struct _GUPnPDLNADiscovererPrivate {
         gboolean  relaxed_mode;
         gboolean  extended_mode;
+        gboolean  fast_probe;
+        gboolean  compact_results;
+        gboolean  skip_non_media;
+
+        /* URI -> GUPnPDLNASniffClass of the URIs queued for asynchronous
+         * discovery, so that they are only sniffed once */
+        GHashTable *sniffed;
+
+        /* Discovery result cache */
+        GHashTable *cache;          /* URI -> CacheEntry */
+        GQueue     cache_lru;       /* CacheEntry, most recently used first */
+        guint      cache_size;      /* budget in bytes, 0 disables caching */
+        gsize      cache_used;
+        guint      cache_hits;
+        guint      cache_misses;
+        guint      cache_evictions;
+
+        /* Synchronous discovery latencies, per sniffed class */
+        gboolean         adaptive_timeout;
+        LatencyHistogram latency[GUPNP_DLNA_SNIFF_LAST];
+        /* The GstDiscoverer:timeout set by the application, which is only
+         * replaced by an adaptive one for the length of a discovery */
+        GstClockTime     timeout;
+        gboolean         applying_timeout;
+
+        /* Matching statistics, NULL until collect-stats is set */
+        gboolean            collect_stats;
+        GUPnPDLNAMatchStats *stats;
+
+        /* Profile match counts, NULL until adaptive-order is set or an
+         * order is loaded */
+        gboolean              adaptive_order;
+        GUPnPDLNAProfileOrder *order;
 };
 
+/* Rough footprint of each stream in a cached GstDiscovererInfo (caps, tags
+ * and misc structures), and of each field of a summary, used to account
+ * entries against the cache budget */
+#define CACHE_STREAM_COST 2048
+#define CACHE_FIELD_COST 64
+
+typedef struct {
+        gchar                *uri;
+        GUPnPDLNAInformation *dlna;
+        time_t               mtime;
+        goffset              size;
+        gsize                cost;
+        GList                *link;
+} CacheEntry;
+
+/* The profiles of each [relaxed][extended] mode, shared by all instances.
+ * NULL if GStreamer was not initialised when the class was. */
+static GUPnPDLNAProfileRegistry *registries[2][2];
+
 enum {
         PROP_0,
         PROP_DLNA_RELAXED_MODE,
         PROP_DLNA_EXTENDED_MODE,
+        PROP_CACHE_SIZE,
+        PROP_CACHE_HITS,
+        PROP_CACHE_MISSES,
+        PROP_CACHE_EVICTIONS,
+        PROP_FAST_PROBE,
+        PROP_ADAPTIVE_TIMEOUT,
+        PROP_COMPACT_RESULTS,
+        PROP_COLLECT_STATS,
+        PROP_ADAPTIVE_ORDER,
+        PROP_SKIP_NON_MEDIA,
 };
 
+static void
+cache_entry_free (CacheEntry *entry)
+{
+        g_free (entry->uri);
+        g_object_unref (entry->dlna);
+        g_slice_free (CacheEntry, entry);
+}
+
+/* Returns TRUE if @uri refers to a local file whose size and modification
+ * time could be read. Only such URIs can be cached, since there is no other
+ * way to tell whether a cached result is still valid. */
+static gboolean
+cache_stat_uri (const gchar *uri, time_t *mtime, goffset *size)
+{
+        gchar *path;
+        struct stat st;
+        gboolean ret = FALSE;
+
+        path = g_filename_from_uri (uri, NULL, NULL);
+        if (!path)
+                return FALSE;
+
+        if (g_stat (path, &st) == 0 && S_ISREG (st.st_mode)) {
+                *mtime = st.st_mtime;
+                *size = st.st_size;
+                ret = TRUE;
+        }
+
+        g_free (path);
+
+        return ret;
+}
+
+static gsize
+cache_entry_cost (const gchar *uri, GUPnPDLNAInformation *dlna)
+{
+        GstDiscovererInfo *info;
+        const GstStructure *summary;
+        const gchar *name, *mime;
+        gsize cost;
+
+        name = gupnp_dlna_information_get_name (dlna);
+        mime = gupnp_dlna_information_get_mime (dlna);
+        info = (GstDiscovererInfo *) gupnp_dlna_information_get_info (dlna);
+
+        cost = sizeof (CacheEntry) + strlen (uri) + 1;
+        if (name)
+                cost += strlen (name) + 1;
+        if (mime)
+                cost += strlen (mime) + 1;
+
+        if (info) {
+                GList *streams = gst_discoverer_info_get_stream_list (info);
+
+                cost += g_list_length (streams) * CACHE_STREAM_COST;
+                gst_discoverer_stream_info_list_free (streams);
+        }
+
+        summary = gupnp_dlna_information_get_summary (dlna);
+        if (summary)
+                cost += gst_structure_n_fields (summary) * CACHE_FIELD_COST;
+
+        return cost;
+}
+
+static void
+cache_remove (GUPnPDLNADiscovererPrivate *priv, CacheEntry *entry)
+{
+        g_queue_delete_link (&priv->cache_lru, entry->link);
+        priv->cache_used -= entry->cost;
+
+        /* Frees the entry */
+        g_hash_table_remove (priv->cache, entry->uri);
+}
+
+/* Evicts least recently used entries until @needed more bytes fit in the
+ * budget */
+static void
+cache_trim (GUPnPDLNADiscovererPrivate *priv, gsize needed)
+{
+        while (priv->cache_lru.tail &&
+               priv->cache_used + needed > priv->cache_size) {
+                cache_remove (priv, priv->cache_lru.tail->data);
+                priv->cache_evictions++;
+        }
+}
+
+static GUPnPDLNAInformation *
+cache_lookup (GUPnPDLNADiscovererPrivate *priv,
+              const gchar                *uri,
+              time_t                     mtime,
+              goffset                    size)
+{
+        CacheEntry *entry;
+
+        entry = g_hash_table_lookup (priv->cache, uri);
+
+        if (entry && (entry->mtime != mtime || entry->size != size)) {
+                /* The file changed since it was discovered */
+                cache_remove (priv, entry);
+                entry = NULL;
+        }
+
+        if (!entry) {
+                priv->cache_misses++;
+
+                return NULL;
+        }
+
+        /* Move to the front of the LRU list */
+        g_queue_unlink (&priv->cache_lru, entry->link);
+        g_queue_push_head_link (&priv->cache_lru, entry->link);
+        priv->cache_hits++;
+
+        return g_object_ref (entry->dlna);
+}
+
+static void
+cache_insert (GUPnPDLNADiscovererPrivate *priv,
+              const gchar                *uri,
+              GUPnPDLNAInformation       *dlna,
+              time_t                     mtime,
+              goffset                    size)
+{
+        CacheEntry *entry;
+        gsize cost;
+
+        entry = g_hash_table_lookup (priv->cache, uri);
+        if (entry)
+                cache_remove (priv, entry);
+
+        cost = cache_entry_cost (uri, dlna);
+        if (cost > priv->cache_size)
+                return;
+
+        cache_trim (priv, cost);
+
+        entry = g_slice_new (CacheEntry);
+        entry->uri = g_strdup (uri);
+        entry->dlna = g_object_ref (dlna);
+        entry->mtime = mtime;
+        entry->size = size;
+        entry->cost = cost;
+
+        g_queue_push_head (&priv->cache_lru, entry);
+        entry->link = priv->cache_lru.head;
+        priv->cache_used += cost;
+
+        g_hash_table_insert (priv->cache, entry->uri, entry);
+}
+
+static void
+cache_clear (GUPnPDLNADiscovererPrivate *priv)
+{
+        g_queue_clear (&priv->cache_lru);
+        g_hash_table_remove_all (priv->cache);
+        priv->cache_used = 0;
+}
+
+static void
+latency_record (LatencyHistogram *histogram, GstClockTime latency)
+{
+        guint64 usecs = latency / GST_USECOND;
+        guint bucket = 0;
+
+        if (usecs > 1)
+                bucket = MIN (g_bit_storage (MIN (usecs, G_MAXUINT32)) - 1,
+                              LATENCY_BUCKETS - 1);
+
+        histogram->buckets[bucket]++;
+        histogram->count++;
+        histogram->total += latency;
+}
+
+/* Returns an upper bound for the given percentile of the recorded latencies,
+ * or GST_CLOCK_TIME_NONE if nothing was recorded */
+static GstClockTime
+latency_percentile (const LatencyHistogram *histogram, guint percentile)
+{
+        guint64 needed, seen = 0;
+        guint i;
+
+        if (histogram->count == 0)
+                return GST_CLOCK_TIME_NONE;
+
+        needed = ((guint64) histogram->count * percentile + 99) / 100;
+
+        for (i = 0; i < LATENCY_BUCKETS - 1; i++) {
+                seen += histogram->buckets[i];
+                if (seen >= needed)
+                        break;
+        }
+
+        return (G_GUINT64_CONSTANT (1) << (i + 1)) * GST_USECOND;
+}
+
+static GstClockTime
+latency_adaptive_timeout (const LatencyHistogram *histogram,
+                          GstClockTime           max_timeout)
+{
+        GstClockTime timeout;
+
+        if (histogram->count < ADAPTIVE_TIMEOUT_MIN_SAMPLES)
+                return max_timeout;
+
+        timeout = latency_percentile (histogram, 99) * ADAPTIVE_TIMEOUT_FACTOR;
+
+        return CLAMP (timeout,
+                      MIN (ADAPTIVE_TIMEOUT_MIN, max_timeout),
+                      max_timeout);
+}
+
 static void
 gupnp_dlna_discoverer_set_property (GObject      *object,
                                     guint        property_id,
@@ -87,6 +444,47 @@ gupnp_dlna_discoverer_set_property (GObject      *object,
                         priv->extended_mode = g_value_get_boolean (value);
                         break;
 
+                case PROP_CACHE_SIZE:
+                        priv->cache_size = g_value_get_uint (value);
+                        if (priv->cache_size)
+                                cache_trim (priv, 0);
+                        else
+                                cache_clear (priv);
+                        break;
+
+                /* Results cached in one mode are not what discovery in
+                 * the other one would return */
+                case PROP_FAST_PROBE:
+                        if (priv->fast_probe != g_value_get_boolean (value))
+                                cache_clear (priv);
+                        priv->fast_probe = g_value_get_boolean (value);
+                        break;
+
+                case PROP_ADAPTIVE_TIMEOUT:
+                        priv->adaptive_timeout = g_value_get_boolean (value);
+                        break;
+
+                case PROP_COMPACT_RESULTS:
+                        if (priv->compact_results !=
+                            g_value_get_boolean (value))
+                                cache_clear (priv);
+                        priv->compact_results = g_value_get_boolean (value);
+                        break;
+
+                case PROP_COLLECT_STATS:
+                        priv->collect_stats = g_value_get_boolean (value);
+                        if (priv->collect_stats && !priv->stats)
+                                priv->stats = gupnp_dlna_match_stats_new ();
+                        break;
+
+                case PROP_ADAPTIVE_ORDER:
+                        priv->adaptive_order = g_value_get_boolean (value);
+                        break;
+
+                case PROP_SKIP_NON_MEDIA:
+                        priv->skip_non_media = g_value_get_boolean (value);
+                        break;
+
                 default:
                         G_OBJECT_WARN_INVALID_PROPERTY_ID (object,
                                                            property_id,
@@ -113,6 +511,46 @@ gupnp_dlna_discoverer_get_property (GObject    *object,
                         g_value_set_boolean (value, priv->extended_mode);
                         break;
 
+                case PROP_CACHE_SIZE:
+                        g_value_set_uint (value, priv->cache_size);
+                        break;
+
+                case PROP_CACHE_HITS:
+                        g_value_set_uint (value, priv->cache_hits);
+                        break;
+
+                case PROP_CACHE_MISSES:
+                        g_value_set_uint (value, priv->cache_misses);
+                        break;
+
+                case PROP_CACHE_EVICTIONS:
+                        g_value_set_uint (value, priv->cache_evictions);
+                        break;
+
+                case PROP_FAST_PROBE:
+                        g_value_set_boolean (value, priv->fast_probe);
+                        break;
+
+                case PROP_ADAPTIVE_TIMEOUT:
+                        g_value_set_boolean (value, priv->adaptive_timeout);
+                        break;
+
+                case PROP_COMPACT_RESULTS:
+                        g_value_set_boolean (value, priv->compact_results);
+                        break;
+
+                case PROP_COLLECT_STATS:
+                        g_value_set_boolean (value, priv->collect_stats);
+                        break;
+
+                case PROP_ADAPTIVE_ORDER:
+                        g_value_set_boolean (value, priv->adaptive_order);
+                        break;
+
+                case PROP_SKIP_NON_MEDIA:
+                        g_value_set_boolean (value, priv->skip_non_media);
+                        break;
+
                 default:
                         G_OBJECT_WARN_INVALID_PROPERTY_ID (object,
                                                            property_id,
@@ -121,36 +559,167 @@ gupnp_dlna_discoverer_get_property (GObject    *object,
         }
 }
 
+/* Keeps track of the timeout set by the application, as opposed to the
+ * adaptive ones set around each discovery */
+static void
+gupnp_dlna_timeout_notify_cb (GObject    *object,
+                              GParamSpec *pspec,
+                              gpointer   user_data)
+{
+        GUPnPDLNADiscovererPrivate *priv =
+                GET_PRIVATE (GUPNP_DLNA_DISCOVERER (object));
+
+        if (!priv->applying_timeout)
+                g_object_get (object, "timeout", &priv->timeout, NULL);
+}
+
+static void
+gupnp_dlna_discoverer_constructed (GObject *object)
+{
+        GUPnPDLNADiscovererPrivate *priv =
+                GET_PRIVATE (GUPNP_DLNA_DISCOVERER (object));
+        GObjectClass *parent_class =
+                G_OBJECT_CLASS (gupnp_dlna_discoverer_parent_class);
+
+        if (parent_class->constructed)
+                parent_class->constructed (object);
+
+        g_object_get (object, "timeout", &priv->timeout, NULL);
+        g_signal_connect (object,
+                          "notify::timeout",
+                          G_CALLBACK (gupnp_dlna_timeout_notify_cb),
+                          NULL);
+}
+
 static void
 gupnp_dlna_discoverer_dispose (GObject *object)
 {
+        GUPnPDLNADiscovererPrivate *priv =
+                GET_PRIVATE (GUPNP_DLNA_DISCOVERER (object));
+
+        /* Drop the references held on cached results */
+        cache_clear (priv);
+
         G_OBJECT_CLASS (gupnp_dlna_discoverer_parent_class)->dispose (object);
 }
 
 static void
 gupnp_dlna_discoverer_finalize (GObject *object)
 {
+        GUPnPDLNADiscovererPrivate *priv =
+                GET_PRIVATE (GUPNP_DLNA_DISCOVERER (object));
+
+        g_hash_table_unref (priv->cache);
+        g_hash_table_unref (priv->sniffed);
+        if (priv->stats)
+                gupnp_dlna_match_stats_free (priv->stats);
+        gupnp_dlna_profile_order_free (priv->order);
+
         G_OBJECT_CLASS (gupnp_dlna_discoverer_parent_class)->finalize (object);
 }
 
+/* Returns the profile order of @priv, creating it if needed, or NULL if
+ * there are no profiles */
+static GUPnPDLNAProfileOrder *
+get_profile_order (GUPnPDLNADiscovererPrivate *priv)
+{
+        GUPnPDLNAProfileRegistry *registry;
+
+        registry = registries [priv->relaxed_mode][priv->extended_mode];
+
+        if (!priv->order && registry)
+                priv->order = gupnp_dlna_profile_order_new (registry);
+
+        return priv->order;
+}
+
+static const GUPnPDLNAProfileTable *
+get_candidate_profiles (GUPnPDLNADiscovererPrivate *priv,
+                        GUPnPDLNASniffClass        sniff_class)
+{
+        gboolean relaxed = priv->relaxed_mode;
+        gboolean extended = priv->extended_mode;
+
+        if (!registries [relaxed][extended])
+                return NULL;
+
+        if (priv->adaptive_order)
+                return gupnp_dlna_profile_order_get_candidates
+                                (get_profile_order (priv), sniff_class);
+
+        return gupnp_dlna_profile_registry_get_candidates
+                                (registries [relaxed][extended],
+                                 sniff_class);
+}
+
+static void
+record_match (GUPnPDLNADiscovererPrivate *priv, GUPnPDLNAInformation *dlna)
+{
+        const gchar *name;
+
+        if (!priv->adaptive_order || !dlna)
+                return;
+
+        name = gupnp_dlna_information_get_name (dlna);
+        if (name && get_profile_order (priv))
+                gupnp_dlna_profile_order_record_match (priv->order, name);
+}
+
+/* The statistics to update, if they are being collected */
+static GUPnPDLNAMatchStats *
+get_stats (GUPnPDLNADiscovererPrivate *priv)
+{
+        return priv->collect_stats ? priv->stats : NULL;
+}
+
+/* A result served from the cache still gives the file its profile, so it
+ * counts towards the profile order and the per-profile match count, though
+ * nothing was evaluated */
+static void
+record_cached_match (GUPnPDLNADiscovererPrivate *priv,
+                     GUPnPDLNAInformation       *dlna)
+{
+        GUPnPDLNAMatchStats *stats = get_stats (priv);
+        const gchar *name = gupnp_dlna_information_get_name (dlna);
+
+        if (stats && name)
+                gupnp_dlna_match_stats_matched (stats, name);
+
+        record_match (priv, dlna);
+}
+
 static void
 gupnp_dlna_discovered_cb (GstDiscoverer     *discoverer,
                           GstDiscovererInfo *info,
                           GError            *err)
 {
         GUPnPDLNAInformation *dlna = NULL;
-        GUPnPDLNADiscovererClass *klass =
-                GUPNP_DLNA_DISCOVERER_GET_CLASS (discoverer);
         GUPnPDLNADiscovererPrivate *priv =
                 GET_PRIVATE (GUPNP_DLNA_DISCOVERER (discoverer));
-        gboolean relaxed = priv->relaxed_mode;
-        gboolean extended = priv->extended_mode;
+        GUPnPDLNASniffClass sniff_class;
+
+        if (info) {
+                const gchar *uri = gst_discoverer_info_get_uri (info);
+                gpointer value;
+
+                /* URIs queued with the GstDiscoverer API were not sniffed */
+                if (g_hash_table_lookup_extended (priv->sniffed,
+                                                  uri,
+                                                  NULL,
+                                                  &value)) {
+                        sniff_class = GPOINTER_TO_UINT (value);
+                        g_hash_table_remove (priv->sniffed, uri);
+                } else
+                        sniff_class = gupnp_dlna_sniff_uri (uri);
 
-        if (info)
                 dlna = gupnp_dlna_information_new_from_discoverer_info
                                         (info,
-                                         klass->profiles_list
-                                                  [relaxed][extended]);
+                                         get_candidate_profiles (priv,
+                                                                 sniff_class),
+                                         get_stats (priv),
+                                         !priv->compact_results);
+                record_match (priv, dlna);
+        }
 
         g_signal_emit (GUPNP_DLNA_DISCOVERER (discoverer),
                        signals[DONE], 0, dlna, err);
@@ -164,11 +733,13 @@ gupnp_dlna_discoverer_class_init (GUPnPDLNADiscovererClass *klass)
 {
         GObjectClass *object_class = G_OBJECT_CLASS (klass);
         GParamSpec *pspec;
+        guint i, j;
 
         g_type_class_add_private (klass, sizeof (GUPnPDLNADiscovererPrivate));
 
         object_class->get_property = gupnp_dlna_discoverer_get_property;
         object_class->set_property = gupnp_dlna_discoverer_set_property;
+        object_class->constructed = gupnp_dlna_discoverer_constructed;
         object_class->dispose = gupnp_dlna_discoverer_dispose;
         object_class->finalize = gupnp_dlna_discoverer_finalize;
 
@@ -207,6 +778,198 @@ gupnp_dlna_discoverer_class_init (GUPnPDLNADiscovererClass *klass)
                                          PROP_DLNA_EXTENDED_MODE,
                                          pspec);
 
+        /**
+         * GUPnPDLNADiscoverer::cache-size:
+         *
+         * Memory budget, in bytes, for caching the results of synchronous
+         * discovery of local files. The least recently used results are
+         * evicted once the budget is exceeded. 0 disables the cache.
+         */
+        pspec = g_param_spec_uint ("cache-size",
+                                   "Cache size",
+                                   "Memory budget in bytes for cached "
+                                   "discovery results (0 to disable)",
+                                   0,
+                                   G_MAXUINT,
+                                   0,
+                                   G_PARAM_READWRITE);
+        g_object_class_install_property (object_class,
+                                         PROP_CACHE_SIZE,
+                                         pspec);
+
+        /**
+         * GUPnPDLNADiscoverer::cache-hits:
+         *
+         * Number of synchronous discoveries that were served from the cache.
+         */
+        pspec = g_param_spec_uint ("cache-hits",
+                                   "Cache hits",
+                                   "Number of discoveries served from the "
+                                   "cache",
+                                   0,
+                                   G_MAXUINT,
+                                   0,
+                                   G_PARAM_READABLE);
+        g_object_class_install_property (object_class,
+                                         PROP_CACHE_HITS,
+                                         pspec);
+
+        /**
+         * GUPnPDLNADiscoverer::cache-misses:
+         *
+         * Number of synchronous discoveries of local files that could not be
+         * served from the cache, either because the file was not cached or
+         * because it changed since it was cached.
+         */
+        pspec = g_param_spec_uint ("cache-misses",
+                                   "Cache misses",
+                                   "Number of cacheable discoveries not "
+                                   "found in the cache",
+                                   0,
+                                   G_MAXUINT,
+                                   0,
+                                   G_PARAM_READABLE);
+        g_object_class_install_property (object_class,
+                                         PROP_CACHE_MISSES,
+                                         pspec);
+
+        /**
+         * GUPnPDLNADiscoverer::cache-evictions:
+         *
+         * Number of cached results dropped to stay within the
+         * #GUPnPDLNADiscoverer::cache-size budget.
+         */
+        pspec = g_param_spec_uint ("cache-evictions",
+                                   "Cache evictions",
+                                   "Number of results evicted from the cache",
+                                   0,
+                                   G_MAXUINT,
+                                   0,
+                                   G_PARAM_READABLE);
+        g_object_class_install_property (object_class,
+                                         PROP_CACHE_EVICTIONS,
+                                         pspec);
+
+        /**
+         * GUPnPDLNADiscoverer::fast-probe:
+         *
+         * Whether synchronous discovery of local still images (JPEG, PNG)
+         * and audio files (MP3, AAC ADTS) should parse the file headers
+         * directly rather than use GStreamer. Files that cannot be handled
+         * this way are still discovered with GStreamer. The
+         * #GUPnPDLNAInformation of files handled this way carries no
+         * #GstDiscovererInfo.
+         */
+        pspec = g_param_spec_boolean ("fast-probe",
+                                      "Fast probe",
+                                      "Parse the headers of local images "
+                                      "and MP3/ADTS files instead of running "
+                                      "a pipeline",
+                                      FALSE,
+                                      G_PARAM_READWRITE);
+        g_object_class_install_property (object_class,
+                                         PROP_FAST_PROBE,
+                                         pspec);
+
+        /**
+         * GUPnPDLNADiscoverer::skip-non-media:
+         *
+         * Whether local files that do not look like media at all, going by
+         * their first few bytes and their extension, should be left alone
+         * rather than discovered with GStreamer. Synchronous discovery of
+         * such files fails right away, and
+         * gupnp_dlna_discoverer_discover_uri() does not queue them.
+         */
+        pspec = g_param_spec_boolean ("skip-non-media",
+                                      "Skip non-media",
+                                      "Do not discover local files that do "
+                                      "not look like media",
+                                      FALSE,
+                                      G_PARAM_READWRITE);
+        g_object_class_install_property (object_class,
+                                         PROP_SKIP_NON_MEDIA,
+                                         pspec);
+
+        /**
+         * GUPnPDLNADiscoverer::adaptive-timeout:
+         *
+         * Whether synchronous discovery should use a timeout derived from
+         * the latencies previously seen for the same kind of file, rather
+         * than always using the #GstDiscoverer:timeout. The latter remains
+         * the upper bound, and a discovery that times out with a shorter
+         * timeout is retried once with it.
+         *
+         * The shorter timeout is applied by setting #GstDiscoverer:timeout
+         * for the length of the discovery, so while a synchronous discovery
+         * is running, that property may hold the adaptive value, and
+         * notify::timeout is emitted when it is set and when the original
+         * value is put back.
+         */
+        pspec = g_param_spec_boolean ("adaptive-timeout",
+                                      "Adaptive timeout",
+                                      "Derive the discovery timeout of each "
+                                      "kind of file from past latencies",
+                                      FALSE,
+                                      G_PARAM_READWRITE);
+        g_object_class_install_property (object_class,
+                                         PROP_ADAPTIVE_TIMEOUT,
+                                         pspec);
+
+        /**
+         * GUPnPDLNADiscoverer::compact-results:
+         *
+         * Whether the #GUPnPDLNAInformation of discovered files should only
+         * carry the profile name, MIME type and a summary of the stream,
+         * rather than also holding on to the complete #GstDiscovererInfo
+         * (stream topology, tags, caps, ...).
+         */
+        pspec = g_param_spec_boolean ("compact-results",
+                                      "Compact results",
+                                      "Drop the GstDiscovererInfo of "
+                                      "discovered files once the profile "
+                                      "has been matched",
+                                      FALSE,
+                                      G_PARAM_READWRITE);
+        g_object_class_install_property (object_class,
+                                         PROP_COMPACT_RESULTS,
+                                         pspec);
+
+        /**
+         * GUPnPDLNADiscoverer::collect-stats:
+         *
+         * Whether statistics about profile matching should be collected,
+         * see gupnp_dlna_discoverer_get_stats(). Statistics collected so far
+         * are kept when this is turned off and on again.
+         */
+        pspec = g_param_spec_boolean ("collect-stats",
+                                      "Collect statistics",
+                                      "Count profile checks, matches and "
+                                      "rejections, and time discovery and "
+                                      "matching",
+                                      FALSE,
+                                      G_PARAM_READWRITE);
+        g_object_class_install_property (object_class,
+                                         PROP_COLLECT_STATS,
+                                         pspec);
+
+        /**
+         * GUPnPDLNADiscoverer::adaptive-order:
+         *
+         * Whether the profiles that were matched most often should be
+         * checked first. This does not change which profile a file is
+         * given, only how fast it is found. Results served from the result
+         * cache count as matches too.
+         */
+        pspec = g_param_spec_boolean ("adaptive-order",
+                                      "Adaptive order",
+                                      "Check frequently matched profiles "
+                                      "first",
+                                      FALSE,
+                                      G_PARAM_READWRITE);
+        g_object_class_install_property (object_class,
+                                         PROP_ADAPTIVE_ORDER,
+                                         pspec);
+
         /**
          * GUPnPDLNADiscoverer::done:
          * @discoverer: the #GUPnPDLNADiscoverer
@@ -227,33 +990,44 @@ gupnp_dlna_discoverer_class_init (GUPnPDLNADiscovererClass *klass)
                               GST_TYPE_G_ERROR);
 
         /* Load DLNA profiles from disk */
-        if (g_type_from_name ("GstElement")) {
-                klass->profiles_list [0][0]
-                        = gupnp_dlna_load_profiles_from_disk (FALSE,
-                                                              FALSE);
-                klass->profiles_list [0][1]
-                        = gupnp_dlna_load_profiles_from_disk (FALSE,
-                                                              TRUE);
-                klass->profiles_list [1][0]
-                        = gupnp_dlna_load_profiles_from_disk (TRUE,
-                                                              FALSE);
-                klass->profiles_list [1][1]
-                        = gupnp_dlna_load_profiles_from_disk (TRUE,
-                                                              TRUE);
-        } else {
-                klass->profiles_list [0][0] = NULL;
-                klass->profiles_list [0][1] = NULL;
-                klass->profiles_list [1][0] = NULL;
-                klass->profiles_list [1][1] = NULL;
+        if (!g_type_from_name ("GstElement"))
                 g_warning ("GStreamer has not yet been initialised. You need "
                            "to call gst_init()/gst_init_check() for discovery "
                            "to work.");
-        }
-}
+
+        for (i = 0; i < 2; i++) {
+                for (j = 0; j < 2; j++) {
+                        if (g_type_from_name ("GstElement"))
+                                registries [i][j] =
+                                        gupnp_dlna_profile_registry_get_default
+                                                                (i, j);
+
+                        if (registries [i][j])
+                                klass->profiles_list [i][j] = (GList *)
+                                        gupnp_dlna_profile_registry_get_profiles
+                                                        (registries [i][j]);
+                        else
+                                klass->profiles_list [i][j] = NULL;
+                }
+        }
+}
 
 static void
 gupnp_dlna_discoverer_init (GUPnPDLNADiscoverer *self)
 {
+        GUPnPDLNADiscovererPrivate *priv = GET_PRIVATE (self);
+
+        priv->cache = g_hash_table_new_full (g_str_hash,
+                                             g_str_equal,
+                                             NULL,
+                                             (GDestroyNotify)
+                                             cache_entry_free);
+        g_queue_init (&priv->cache_lru);
+        priv->sniffed = g_hash_table_new_full (g_str_hash,
+                                               g_str_equal,
+                                               g_free,
+                                               NULL);
+
         g_signal_connect (&self->parent,
                           "discovered",
                           G_CALLBACK (gupnp_dlna_discovered_cb),
@@ -307,25 +1081,148 @@ gupnp_dlna_discoverer_new (GstClockTime timeout,
  * Queues @uri for metadata discovery. When discovery is completed, the
  * "discovered" signal is emitted on @discoverer.
  *
+ * If #GUPnPDLNADiscoverer:skip-non-media is set and @uri is a local file that
+ * does not look like a media file, it is not queued.
+ *
  * Returns: TRUE if @uri was successfully queued, FALSE otherwise.
  */
 gboolean
 gupnp_dlna_discoverer_discover_uri (GUPnPDLNADiscoverer *discoverer,
                                     const gchar         *uri)
 {
-        return gst_discoverer_discover_uri_async (GST_DISCOVERER (discoverer),
-                                                  uri);
+        GUPnPDLNADiscovererPrivate *priv = GET_PRIVATE (discoverer);
+        GUPnPDLNASniffClass sniff_class;
+
+        sniff_class = gupnp_dlna_sniff_uri (uri);
+        if (priv->skip_non_media && sniff_class == GUPNP_DLNA_SNIFF_NOT_MEDIA)
+                return FALSE;
+
+        if (!gst_discoverer_discover_uri_async (GST_DISCOVERER (discoverer),
+                                                uri))
+                return FALSE;
+
+        g_hash_table_insert (priv->sniffed,
+                             g_strdup (uri),
+                             GUINT_TO_POINTER (sniff_class));
+
+        return TRUE;
 }
 
 /* Synchronous API */
 
+static GUPnPDLNAInformation *
+discover_uri_fast (const GUPnPDLNAProfileTable *profiles,
+                   GUPnPDLNAMatchStats         *stats,
+                   const gchar                 *uri)
+{
+        GUPnPDLNAStreamDescription *desc;
+        GUPnPDLNAInformation *dlna;
+        GstStructure *summary;
+        GstClockTime start, match_time;
+        gchar *name = NULL, *mime = NULL;
+
+        start = gst_util_get_timestamp ();
+        desc = gupnp_dlna_fast_probe_uri (uri);
+        if (!desc)
+                return NULL;
+
+        if (stats) {
+                stats->discovery_time += gst_util_get_timestamp () - start;
+                stats->discoveries++;
+        }
+
+        match_time = gupnp_dlna_stream_description_guess_profile (desc,
+                                                                  profiles,
+                                                                  stats,
+                                                                  &name,
+                                                                  &mime);
+        summary = gupnp_dlna_stream_description_summarize
+                                                (desc,
+                                                 uri,
+                                                 GST_CLOCK_TIME_NONE,
+                                                 match_time);
+        gupnp_dlna_stream_description_free (desc);
+
+        dlna = g_object_new (GUPNP_TYPE_DLNA_INFORMATION,
+                             "name", name,
+                             "mime", mime,
+                             "summary", summary,
+                             NULL);
+
+        gst_structure_free (summary);
+        g_free (name);
+        g_free (mime);
+
+        return dlna;
+}
+
+static void
+apply_timeout (GUPnPDLNADiscoverer        *discoverer,
+               GUPnPDLNADiscovererPrivate *priv,
+               GstClockTime               timeout)
+{
+        priv->applying_timeout = TRUE;
+        g_object_set (discoverer, "timeout", timeout, NULL);
+        priv->applying_timeout = FALSE;
+}
+
+/* Discovers @uri with @timeout, recording how long it took in @histogram
+ * and @stats */
+static GstDiscovererInfo *
+discover_uri_timed (GUPnPDLNADiscoverer *discoverer,
+                    const gchar         *uri,
+                    GstClockTime        timeout,
+                    LatencyHistogram    *histogram,
+                    GUPnPDLNAMatchStats *stats,
+                    GError              **error)
+{
+        GUPnPDLNADiscovererPrivate *priv = GET_PRIVATE (discoverer);
+        GstDiscovererInfo *info;
+        GstClockTime start, elapsed;
+
+        if (timeout != priv->timeout)
+                apply_timeout (discoverer, priv, timeout);
+
+        start = gst_util_get_timestamp ();
+        info = gst_discoverer_discover_uri (GST_DISCOVERER (discoverer),
+                                            uri,
+                                            error);
+        elapsed = gst_util_get_timestamp () - start;
+
+        if (timeout != priv->timeout)
+                apply_timeout (discoverer, priv, priv->timeout);
+
+        /* Timed out discoveries would skew the histogram towards the
+         * timeout, so they are only counted */
+        if (info &&
+            gst_discoverer_info_get_result (info) == GST_DISCOVERER_TIMEOUT)
+                histogram->timeouts++;
+        else
+                latency_record (histogram, elapsed);
+
+        if (stats) {
+                stats->discovery_time += elapsed;
+                stats->discoveries++;
+        }
+
+        return info;
+}
+
 /**
  * gupnp_dlna_discoverer_discover_uri_sync:
  * @discoverer: #GUPnPDLNADiscoverer object to use for discovery
  * @uri: URI to gather metadata for
  * @err: contains details of the error if discovery fails, else is NULL
  *
- * Synchronously gathers metadata for @uri.
+ * Synchronously gathers metadata for @uri. If caching is enabled and @uri is
+ * a local file that has not changed since it was last discovered, the cached
+ * result is returned instead.
+ *
+ * If #GUPnPDLNADiscoverer:fast-probe is set and @uri is a local file with
+ * headers that can be parsed directly, the returned #GUPnPDLNAInformation has
+ * no #GstDiscovererInfo. If #GUPnPDLNADiscoverer:skip-non-media is set and
+ * @uri does not look like a media file at all, NULL is returned and @err is
+ * set without attempting discovery.
  *
  * Returns: (transfer full): a #GUPnPDLNAInformation with the metadata for @uri
  *          on success, NULL otherwise
@@ -336,21 +1233,309 @@ gupnp_dlna_discoverer_discover_uri_sync (GUPnPDLNADiscoverer *discoverer,
                                          GError              **err)
 {
         GstDiscovererInfo *info;
-        GUPnPDLNADiscovererClass *klass =
-                GUPNP_DLNA_DISCOVERER_GET_CLASS (discoverer);
+        GUPnPDLNAInformation *dlna = NULL;
         GUPnPDLNADiscovererPrivate *priv = GET_PRIVATE (discoverer);
-        gboolean relaxed = priv->relaxed_mode;
-        gboolean extended = priv->extended_mode;
+        GUPnPDLNASniffClass sniff_class;
+        const GUPnPDLNAProfileTable *profiles;
+        gboolean cacheable = FALSE, complete = FALSE;
+        GError *error = NULL;
+        time_t mtime;
+        goffset size;
 
-        info = gst_discoverer_discover_uri (GST_DISCOVERER (discoverer),
-                                            uri,
-                                            err);
+        /* The file is stat()ed before discovery so that a change made while
+         * it is being discovered invalidates the cached result */
+        if (priv->cache_size && cache_stat_uri (uri, &mtime, &size)) {
+                dlna = cache_lookup (priv, uri, mtime, size);
+                if (dlna) {
+                        record_cached_match (priv, dlna);
 
-        if (info)
-                return gupnp_dlna_information_new_from_discoverer_info
-                        (info, klass->profiles_list [relaxed][extended]);
+                        return dlna;
+                }
 
-        return NULL;
+                cacheable = TRUE;
+        }
+
+        sniff_class = gupnp_dlna_sniff_uri (uri);
+        profiles = get_candidate_profiles (priv, sniff_class);
+
+        if (priv->skip_non_media && sniff_class == GUPNP_DLNA_SNIFF_NOT_MEDIA) {
+                g_set_error (err,
+                             GST_STREAM_ERROR,
+                             GST_STREAM_ERROR_WRONG_TYPE,
+                             "%s does not look like a media file",
+                             uri);
+
+                return NULL;
+        }
+
+        if (priv->fast_probe) {
+                if (sniff_class == GUPNP_DLNA_SNIFF_IMAGE ||
+                    sniff_class == GUPNP_DLNA_SNIFF_AUDIO)
+                        dlna = discover_uri_fast (profiles,
+                                                  get_stats (priv),
+                                                  uri);
+
+                complete = (dlna != NULL);
+        }
+
+        if (!dlna) {
+                LatencyHistogram *histogram = &priv->latency[sniff_class];
+                GUPnPDLNAMatchStats *stats = get_stats (priv);
+                GstClockTime timeout = priv->timeout;
+
+                if (priv->adaptive_timeout)
+                        timeout = latency_adaptive_timeout (histogram,
+                                                            priv->timeout);
+
+                info = discover_uri_timed (discoverer,
+                                           uri,
+                                           timeout,
+                                           histogram,
+                                           stats,
+                                           &error);
+
+                /* The adaptive timeout only comes from the files seen so
+                 * far, and a slower one would otherwise time out every time
+                 * it is discovered */
+                if (info &&
+                    timeout < priv->timeout &&
+                    gst_discoverer_info_get_result (info) ==
+                    GST_DISCOVERER_TIMEOUT) {
+                        gst_discoverer_info_unref (info);
+                        g_clear_error (&error);
+
+                        info = discover_uri_timed (discoverer,
+                                                   uri,
+                                                   priv->timeout,
+                                                   histogram,
+                                                   stats,
+                                                   &error);
+                }
+
+                if (info) {
+                        complete = (gst_discoverer_info_get_result (info) ==
+                                    GST_DISCOVERER_OK);
+                        dlna = gupnp_dlna_information_new_from_discoverer_info
+                                (info,
+                                 profiles,
+                                 stats,
+                                 !priv->compact_results);
+                        gst_discoverer_info_unref (info);
+                }
+        }
+
+        record_match (priv, dlna);
+
+        /* Failed discoveries (timeouts, missing plugins, ...) are not cached
+         * so that they are retried the next time around. GstDiscoverer does
+         * not set an error for all of them, so its result is checked. */
+        if (dlna && cacheable && complete && !error)
+                cache_insert (priv, uri, dlna, mtime, size);
+
+        if (error)
+                g_propagate_error (err, error);
+
+        return dlna;
+}
+
+/**
+ * gupnp_dlna_discoverer_get_latency_histograms:
+ * @self: The #GUPnPDLNADiscoverer object
+ *
+ * Retrieves the latencies of the synchronous discoveries made with @self so
+ * far, grouped by the kind of file discovered. Each kind of file that was
+ * seen is described by a #GstStructure named "latency-histogram" with the
+ * following fields:
+ *
+ *   "format" (string): the kind of file ("image", "audio", "mp4",
+ *     "mpeg-ts", "mpeg-ps", "asf", "not-media" or "unknown")
+ *   "count" (uint): number of discoveries that completed
+ *   "timeouts" (uint): number of discoveries that timed out, which are not
+ *     part of the histogram. Discoveries that timed out with an adaptive
+ *     timeout and were retried with the full one are counted here too.
+ *   "total" (guint64): total time taken by the completed discoveries, in
+ *     nanoseconds
+ *   "p50", "p99" (guint64): upper bounds of the median and 99th percentile
+ *     latencies, in nanoseconds
+ *   "timeout" (guint64): the timeout that would be used for the next
+ *     discovery of this kind of file, in nanoseconds
+ *   "buckets" (GstValueArray of uint): bucket i holds the number of
+ *     discoveries that took between 2^i and 2^(i+1) microseconds
+ *
+ * Returns: (transfer full) (element-type GstStructure): a #GList of
+ *          #GstStructure. Free the structures with gst_structure_free() and
+ *          the list with g_list_free().
+ **/
+GList *
+gupnp_dlna_discoverer_get_latency_histograms (GUPnPDLNADiscoverer *self)
+{
+        GUPnPDLNADiscovererPrivate *priv;
+        GList *ret = NULL;
+        guint i, j;
+
+        g_return_val_if_fail (GUPNP_IS_DLNA_DISCOVERER (self), NULL);
+
+        priv = GET_PRIVATE (self);
+
+        for (i = 0; i < GUPNP_DLNA_SNIFF_LAST; i++) {
+                const LatencyHistogram *histogram = &priv->latency[i];
+                GstStructure *st;
+                GValue buckets = { 0, };
+                GValue bucket = { 0, };
+
+                if (histogram->count == 0 && histogram->timeouts == 0)
+                        continue;
+
+                g_value_init (&buckets, GST_TYPE_ARRAY);
+                g_value_init (&bucket, G_TYPE_UINT);
+                for (j = 0; j < LATENCY_BUCKETS; j++) {
+                        g_value_set_uint (&bucket, histogram->buckets[j]);
+                        gst_value_array_append_value (&buckets, &bucket);
+                }
+
+                st = gst_structure_new
+                        ("latency-histogram",
+                         "format", G_TYPE_STRING,
+                         gupnp_dlna_sniff_class_get_name (i),
+                         "count", G_TYPE_UINT, histogram->count,
+                         "timeouts", G_TYPE_UINT, histogram->timeouts,
+                         "total", G_TYPE_UINT64, histogram->total,
+                         "p50", G_TYPE_UINT64,
+                         latency_percentile (histogram, 50),
+                         "p99", G_TYPE_UINT64,
+                         latency_percentile (histogram, 99),
+                         "timeout", G_TYPE_UINT64,
+                         priv->adaptive_timeout ?
+                                latency_adaptive_timeout (histogram,
+                                                          priv->timeout) :
+                                priv->timeout,
+                         NULL);
+                gst_structure_set_value (st, "buckets", &buckets);
+
+                g_value_unset (&bucket);
+                g_value_unset (&buckets);
+
+                ret = g_list_prepend (ret, st);
+        }
+
+        return g_list_reverse (ret);
+}
+
+/**
+ * gupnp_dlna_discoverer_get_stats:
+ * @self: The #GUPnPDLNADiscoverer object
+ *
+ * Retrieves the statistics collected while #GUPnPDLNADiscoverer:collect-stats
+ * was set. The first #GstStructure of the list is named "match-stats" and
+ * has the following fields:
+ *
+ *   "discoveries" (uint): number of synchronous discoveries (the time
+ *     taken by asynchronous ones is not known)
+ *   "discovery-time" (guint64): total time taken by those, in nanoseconds
+ *   "matches" (uint): number of discovered files matched against profiles
+ *   "matched" (uint): number of those that were given a profile
+ *   "match-time" (guint64): total time taken by matching, in nanoseconds
+ *
+ * Results served from the result cache (see
+ * #GUPnPDLNADiscoverer:cache-size) are not matched again, so they only
+ * count in the "matches" field of the profile they were given.
+ *
+ * It is followed by a "profile-stats" structure for each profile that was
+ * checked, sorted by name, with the following fields:
+ *
+ *   "name" (string): the name of the profile
+ *   "evaluations" (uint): number of files the profile was checked against
+ *   "matches" (uint): number of files that were given this profile,
+ *     including those served from the result cache
+ *
+ * and a uint field for each reason the profile was rejected, counting how
+ * many times it was. Those are named "video.<!-- -->field",
+ * "audio.<!-- -->field", "image.<!-- -->field" or
+ * "container.<!-- -->field", with field being the caps field that did not
+ * match (or "media-type" if the media types differ, "other" if no single
+ * field is to blame). "missing" stands for a stream the profile requires
+ * but the file lacks, and "unexpected" for a stream the profile does not
+ * allow for.
+ *
+ * Returns: (transfer full) (element-type GstStructure): a #GList of
+ *          #GstStructure, or NULL if no statistics were collected. Free the
+ *          structures with gst_structure_free() and the list with
+ *          g_list_free().
+ **/
+GList *
+gupnp_dlna_discoverer_get_stats (GUPnPDLNADiscoverer *self)
+{
+        GUPnPDLNADiscovererPrivate *priv;
+
+        g_return_val_if_fail (GUPNP_IS_DLNA_DISCOVERER (self), NULL);
+
+        priv = GET_PRIVATE (self);
+        if (!priv->stats)
+                return NULL;
+
+        return gupnp_dlna_match_stats_to_structures (priv->stats);
+}
+
+/**
+ * gupnp_dlna_discoverer_load_profile_order:
+ * @self: The #GUPnPDLNADiscoverer object
+ * @filename: the file to load the profile order from
+ * @error: return location for a #GError, or NULL
+ *
+ * Loads the profile match counts saved with
+ * gupnp_dlna_discoverer_save_profile_order(), so that
+ * #GUPnPDLNADiscoverer:adaptive-order does not have to learn them again.
+ * They are added to the counts @self already has. Counts of profiles that
+ * do not exist any more are kept, but have no effect.
+ *
+ * Returns: TRUE on success, FALSE if @filename could not be read or parsed.
+ **/
+gboolean
+gupnp_dlna_discoverer_load_profile_order (GUPnPDLNADiscoverer *self,
+                                          const gchar         *filename,
+                                          GError              **error)
+{
+        GUPnPDLNAProfileOrder *order;
+
+        g_return_val_if_fail (GUPNP_IS_DLNA_DISCOVERER (self), FALSE);
+        g_return_val_if_fail (filename != NULL, FALSE);
+
+        order = get_profile_order (GET_PRIVATE (self));
+
+        /* Without profiles, there is nothing to order */
+        if (!order)
+                return TRUE;
+
+        return gupnp_dlna_profile_order_load (order, filename, error);
+}
+
+/**
+ * gupnp_dlna_discoverer_save_profile_order:
+ * @self: The #GUPnPDLNADiscoverer object
+ * @filename: the file to save the profile order to
+ * @error: return location for a #GError, or NULL
+ *
+ * Saves how often each profile was matched by @self while
+ * #GUPnPDLNADiscoverer:adaptive-order was set, which is what the order of the
+ * profiles is derived from. The file is replaced atomically.
+ *
+ * Returns: TRUE on success, FALSE if @filename could not be written.
+ **/
+gboolean
+gupnp_dlna_discoverer_save_profile_order (GUPnPDLNADiscoverer *self,
+                                          const gchar         *filename,
+                                          GError              **error)
+{
+        GUPnPDLNAProfileOrder *order;
+
+        g_return_val_if_fail (GUPNP_IS_DLNA_DISCOVERER (self), FALSE);
+        g_return_val_if_fail (filename != NULL, FALSE);
+
+        order = get_profile_order (GET_PRIVATE (self));
+        if (!order)
+                return g_file_set_contents (filename, "", 0, error);
+
+        return gupnp_dlna_profile_order_save (order, filename, error);
 }
 
 /**
@@ -367,29 +1552,545 @@ GUPnPDLNAProfile *
 gupnp_dlna_discoverer_get_profile (GUPnPDLNADiscoverer *self,
                                    const gchar         *name)
 {
-        GList *i;
-        GUPnPDLNADiscovererClass *klass;
+        GUPnPDLNAProfile *profile;
+        GUPnPDLNADiscovererPrivate *priv;
+        gboolean relaxed, extended;
+
+        g_return_val_if_fail (self != NULL, NULL);
+        g_return_val_if_fail (name != NULL, NULL);
+
+        priv = GET_PRIVATE (self);
+        relaxed = priv->relaxed_mode;
+        extended = priv->extended_mode;
+
+        if (!registries [relaxed][extended])
+                return NULL;
+
+        profile = gupnp_dlna_profile_registry_lookup
+                                (registries [relaxed][extended], name);
+        if (profile)
+                g_object_ref (profile);
+
+        return profile;
+}
+
+/**
+ * gupnp_dlna_discoverer_get_profiles:
+ * @self: The #GUPnPDLNADiscoverer object
+ * @names: (array zero-terminated=1): A %NULL-terminated array of DLNA profile
+ *         names
+ *
+ * Looks up all of @names at once, for instance to filter a list of profiles
+ * that a client says it supports down to those that @self knows about.
+ * Names that do not correspond to any profile are skipped.
+ *
+ * Returns: (transfer full) (element-type GUPnPDLNAProfile*): a #GList of
+ *          the #GUPnPDLNAProfile<!-- -->s that were found, in the order of
+ *          @names. Unref each profile and free the list when done.
+ **/
+GList *
+gupnp_dlna_discoverer_get_profiles (GUPnPDLNADiscoverer *self,
+                                    const gchar * const *names)
+{
+        GList *ret = NULL;
+        GUPnPDLNAProfileRegistry *registry;
+        GUPnPDLNADiscovererPrivate *priv;
+        guint i;
+
+        g_return_val_if_fail (self != NULL, NULL);
+        g_return_val_if_fail (names != NULL, NULL);
+
+        priv = GET_PRIVATE (self);
+        registry = registries [priv->relaxed_mode][priv->extended_mode];
+
+        if (!registry)
+                return NULL;
+
+        for (i = 0; names[i]; i++) {
+                GUPnPDLNAProfile *profile;
+
+                profile = gupnp_dlna_profile_registry_lookup (registry,
+                                                              names[i]);
+                if (profile)
+                        ret = g_list_prepend (ret, g_object_ref (profile));
+        }
+
+        return g_list_reverse (ret);
+}
+
+/*
+ * What is known about how a result fits the profiles of a table: the stream
+ * description of the result, and the transcode flags of each profile,
+ * worked out the first time they are asked for. The cache is attached to the
+ * GUPnPDLNAInformation and is only valid for the table it was made for.
+ */
+typedef struct {
+        const GUPnPDLNAProfileTable *table;
+        GUPnPDLNAStreamDescription  *desc;
+        guint8                      *flags;
+} TranscodeCache;
+
+/* Set in TranscodeCache.flags for profiles that have not been looked at */
+#define TRANSCODE_UNKNOWN 0xff
+
+/* Results can be shared between threads, so their caches are only looked at
+ * with this held */
+G_LOCK_DEFINE_STATIC (transcode_cache);
+
+static void
+transcode_cache_free (TranscodeCache *cache)
+{
+        gupnp_dlna_stream_description_free (cache->desc);
+        g_free (cache->flags);
+        g_slice_free (TranscodeCache, cache);
+}
+
+static GQuark
+transcode_cache_quark (void)
+{
+        return g_quark_from_static_string ("gupnp-dlna-transcode-cache");
+}
+
+/* Results made in compact-results mode only have their summary left to go
+ * by, which leads to overestimating what has to be transcoded */
+static GUPnPDLNAStreamDescription *
+describe_result (GUPnPDLNAInformation *dlna)
+{
+        GstDiscovererInfo *info;
+        const gchar *mime;
+
+        info = (GstDiscovererInfo *) gupnp_dlna_information_get_info (dlna);
+        if (info)
+                return gupnp_dlna_stream_description_new_from_discoverer_info
+                                                                        (info);
+
+        mime = gupnp_dlna_information_get_mime (dlna);
+
+        return gupnp_dlna_stream_description_new_from_summary
+                                (gupnp_dlna_information_get_summary (dlna),
+                                 mime && g_str_has_prefix (mime, "image/"));
+}
+
+/* Must be called with the transcode_cache lock held */
+static TranscodeCache *
+get_transcode_cache (GUPnPDLNAInformation        *dlna,
+                     const GUPnPDLNAProfileTable *table)
+{
+        TranscodeCache *cache;
+
+        cache = g_object_get_qdata (G_OBJECT (dlna), transcode_cache_quark ());
+
+        if (!cache) {
+                cache = g_slice_new0 (TranscodeCache);
+                cache->desc = describe_result (dlna);
+                g_object_set_qdata_full (G_OBJECT (dlna),
+                                         transcode_cache_quark (),
+                                         cache,
+                                         (GDestroyNotify) transcode_cache_free);
+        }
+
+        if (table && cache->table != table) {
+                g_free (cache->flags);
+                cache->table = table;
+                cache->flags = g_new (guint8, table->n_profiles);
+                memset (cache->flags, TRANSCODE_UNKNOWN, table->n_profiles);
+        }
+
+        return cache;
+}
+
+/* Returns the index of @target in the table it is to be checked with, which
+ * is that of @cache if @target is one of the profiles of @registry. Other
+ * profiles get a table of their own in @one_off, for the caller to free. */
+static guint
+find_target (GUPnPDLNAProfileRegistry    *registry,
+             TranscodeCache              *cache,
+             GUPnPDLNAProfile            *target,
+             const GUPnPDLNAProfileTable **table,
+             GUPnPDLNAProfileTable       **one_off)
+{
+        GList list = { target, NULL, NULL };
+        gint i = -1;
+
+        *one_off = NULL;
+
+        if (registry)
+                i = gupnp_dlna_profile_registry_get_index (registry, target);
+
+        if (i >= 0) {
+                *table = cache->table;
+                return i;
+        }
+
+        *one_off = gupnp_dlna_profile_table_new (&list);
+        *table = *one_off;
+
+        return 0;
+}
+
+/* Must be called with the transcode_cache lock held. Profiles that are not
+ * in the table of @registry are checked on their own and not remembered. */
+static GUPnPDLNATranscodeFlags
+get_transcode_flags (GUPnPDLNAProfileRegistry *registry,
+                     TranscodeCache           *cache,
+                     GUPnPDLNAProfile         *target)
+{
+        const GUPnPDLNAProfileTable *table;
+        GUPnPDLNAProfileTable *one_off;
+        GUPnPDLNATranscodeFlags flags;
+        guint i;
+
+        i = find_target (registry, cache, target, &table, &one_off);
+
+        if (one_off) {
+                flags = gupnp_dlna_stream_description_get_transcode_flags
+                                                (cache->desc, table, i);
+                gupnp_dlna_profile_table_free (one_off);
+
+                return flags;
+        }
+
+        if (cache->flags[i] == TRANSCODE_UNKNOWN)
+                cache->flags[i] =
+                        gupnp_dlna_stream_description_get_transcode_flags
+                                                (cache->desc, table, i);
+
+        return cache->flags[i];
+}
+
+static GUPnPDLNAProfileRegistry *
+get_registry (GUPnPDLNADiscoverer *self)
+{
         GUPnPDLNADiscovererPrivate *priv = GET_PRIVATE (self);
-        gboolean relaxed = priv->relaxed_mode;
-        gboolean extended = priv->extended_mode;
+
+        return registries [priv->relaxed_mode][priv->extended_mode];
+}
+
+/**
+ * gupnp_dlna_discoverer_get_transcode_flags:
+ * @self: The #GUPnPDLNADiscoverer object
+ * @dlna: A #GUPnPDLNAInformation, as returned by @self
+ * @target: The #GUPnPDLNAProfile that the media would be transcoded to
+ *
+ * Works out what would have to be done to the media described by @dlna for
+ * it to fit @target: each stream is checked against the restrictions of
+ * @target on its own, so the result tells the streams that can be passed
+ * through from those that have to be re-encoded.
+ *
+ * The result is remembered by @dlna for each profile of @self, so asking
+ * again, or ranking targets with gupnp_dlna_discoverer_rank_targets(), does
+ * not check the streams again. Results made with
+ * #GUPnPDLNADiscoverer:compact-results set only have their summary to go by,
+ * which lacks most of the fields that profiles restrict, so the flags of
+ * such results err on the side of re-encoding.
+ *
+ * Returns: the #GUPnPDLNATranscodeFlags for @target.
+ **/
+GUPnPDLNATranscodeFlags
+gupnp_dlna_discoverer_get_transcode_flags (GUPnPDLNADiscoverer  *self,
+                                           GUPnPDLNAInformation *dlna,
+                                           GUPnPDLNAProfile     *target)
+{
+        GUPnPDLNAProfileRegistry *registry;
+        GUPnPDLNATranscodeFlags flags;
+        TranscodeCache *cache;
+
+        g_return_val_if_fail (self != NULL, GUPNP_DLNA_TRANSCODE_IMPOSSIBLE);
+        g_return_val_if_fail (dlna != NULL, GUPNP_DLNA_TRANSCODE_IMPOSSIBLE);
+        g_return_val_if_fail (target != NULL, GUPNP_DLNA_TRANSCODE_IMPOSSIBLE);
+
+        registry = get_registry (self);
+
+        G_LOCK (transcode_cache);
+
+        cache = get_transcode_cache
+                        (dlna,
+                         registry ?
+                         gupnp_dlna_profile_registry_get_table (registry) :
+                         NULL);
+        flags = get_transcode_flags (registry, cache, target);
+
+        G_UNLOCK (transcode_cache);
+
+        return flags;
+}
+
+/**
+ * gupnp_dlna_discoverer_rank_targets:
+ * @self: The #GUPnPDLNADiscoverer object
+ * @dlna: A #GUPnPDLNAInformation, as returned by @self
+ * @targets: (element-type GUPnPDLNAProfile*): The profiles that the media
+ *           could be transcoded to, such as those that a client supports
+ *
+ * Sorts @targets by how much work it would take to transcode the media
+ * described by @dlna to them, as given by
+ * gupnp_dlna_discoverer_get_transcode_flags(): the profiles that the media
+ * already fits come first, then those that only need transmuxing, then those
+ * that need the audio re-encoded, and so on. Profiles that need the same
+ * work keep their order from @targets, and those that the media cannot be
+ * transcoded to are left out.
+ *
+ * Returns: (transfer container) (element-type GUPnPDLNAProfile*): a #GList
+ *          of the profiles of @targets that the media can be transcoded to.
+ *          Free the list with g_list_free() when done.
+ **/
+GList *
+gupnp_dlna_discoverer_rank_targets (GUPnPDLNADiscoverer  *self,
+                                    GUPnPDLNAInformation *dlna,
+                                    const GList          *targets)
+{
+        GList *ranks[GUPNP_DLNA_TRANSCODE_IMPOSSIBLE] = { NULL, };
+        GList *ret = NULL;
+        GUPnPDLNAProfileRegistry *registry;
+        TranscodeCache *cache;
+        const GList *l;
+        gint rank;
 
         g_return_val_if_fail (self != NULL, NULL);
-        klass = GUPNP_DLNA_DISCOVERER_GET_CLASS (self);
+        g_return_val_if_fail (dlna != NULL, NULL);
 
-        for (i = klass->profiles_list [relaxed][extended];
-             i != NULL;
-             i = i->next) {
-                GUPnPDLNAProfile *profile = (GUPnPDLNAProfile *) i->data;
+        registry = get_registry (self);
 
-                if (g_str_equal (gupnp_dlna_profile_get_name (profile), name)) {
-                        g_object_ref (profile);
-                        return profile;
-                }
+        G_LOCK (transcode_cache);
+
+        cache = get_transcode_cache
+                        (dlna,
+                         registry ?
+                         gupnp_dlna_profile_registry_get_table (registry) :
+                         NULL);
+
+        /* The flags are ranks already, so this is a bucket sort */
+        for (l = targets; l; l = l->next) {
+                GUPnPDLNATranscodeFlags flags;
+
+                flags = get_transcode_flags (registry,
+                                             cache,
+                                             GUPNP_DLNA_PROFILE (l->data));
+                if (flags < GUPNP_DLNA_TRANSCODE_IMPOSSIBLE)
+                        ranks[flags] = g_list_prepend (ranks[flags], l->data);
+        }
+
+        G_UNLOCK (transcode_cache);
+
+        for (rank = GUPNP_DLNA_TRANSCODE_IMPOSSIBLE - 1; rank >= 0; rank--)
+                ret = g_list_concat (g_list_reverse (ranks[rank]), ret);
+
+        return ret;
+}
+
+/* The streams of @streams (GstDiscovererStreamInfo) that fit profile i of
+ * @table, @descs holding the caps of each of them in the same order */
+static GList *
+fitting_streams (GList                       *streams,
+                 GList                       *descs,
+                 const GUPnPDLNAProfileTable *table,
+                 guint                       i,
+                 gboolean                    video)
+{
+        GList *ret = NULL;
+
+        for (; streams && descs; streams = streams->next, descs = descs->next)
+                if (gupnp_dlna_stream_description_stream_fits
+                                        (GST_CAPS (descs->data),
+                                         table,
+                                         i,
+                                         video))
+                        ret = g_list_prepend (ret,
+                                              gst_discoverer_stream_info_ref
+                                                        (streams->data));
+
+        return g_list_reverse (ret);
+}
+
+/**
+ * gupnp_dlna_discoverer_get_passthrough_streams:
+ * @self: The #GUPnPDLNADiscoverer object
+ * @dlna: A #GUPnPDLNAInformation, as returned by @self
+ * @target: The #GUPnPDLNAProfile that the media would be transcoded to
+ *
+ * Finds the audio and video streams of the media described by @dlna that
+ * already fit the restrictions of @target, and so do not have to be
+ * re-encoded when transcoding to it. For instance, all the streams of an
+ * MP4 file with AVC video and AAC audio fit an MPEG-TS profile with the same
+ * codecs, and only have to be put into another container.
+ *
+ * The streams are only known for results that still have their
+ * #GstDiscovererInfo, so nothing is found for results made with
+ * #GUPnPDLNADiscoverer:compact-results set.
+ *
+ * Returns: (transfer full) (element-type GstDiscovererStreamInfo*): a #GList
+ *          of the video streams, then the audio streams, that fit @target.
+ *          Free it with gst_discoverer_stream_info_list_free() when done.
+ **/
+GList *
+gupnp_dlna_discoverer_get_passthrough_streams (GUPnPDLNADiscoverer  *self,
+                                               GUPnPDLNAInformation *dlna,
+                                               GUPnPDLNAProfile     *target)
+{
+        GUPnPDLNAProfileRegistry *registry;
+        const GUPnPDLNAProfileTable *table;
+        GUPnPDLNAProfileTable *one_off;
+        GstDiscovererInfo *info;
+        TranscodeCache *cache;
+        GList *video, *audio, *ret;
+        guint i;
+
+        g_return_val_if_fail (self != NULL, NULL);
+        g_return_val_if_fail (dlna != NULL, NULL);
+        g_return_val_if_fail (target != NULL, NULL);
+
+        info = (GstDiscovererInfo *) gupnp_dlna_information_get_info (dlna);
+        if (!info)
+                return NULL;
+
+        registry = get_registry (self);
+        video = gst_discoverer_info_get_video_streams (info);
+        audio = gst_discoverer_info_get_audio_streams (info);
+
+        G_LOCK (transcode_cache);
+
+        cache = get_transcode_cache
+                        (dlna,
+                         registry ?
+                         gupnp_dlna_profile_registry_get_table (registry) :
+                         NULL);
+        i = find_target (registry, cache, target, &table, &one_off);
+
+        /* The description lists the streams of each kind in the same order
+         * as the GstDiscovererInfo */
+        ret = g_list_concat (fitting_streams (video,
+                                              cache->desc->video,
+                                              table,
+                                              i,
+                                              TRUE),
+                             fitting_streams (audio,
+                                              cache->desc->audio,
+                                              table,
+                                              i,
+                                              FALSE));
+
+        G_UNLOCK (transcode_cache);
+
+        gupnp_dlna_profile_table_free (one_off);
+        gst_discoverer_stream_info_list_free (audio);
+        gst_discoverer_stream_info_list_free (video);
+
+        return ret;
+}
+
+/* The caps of the first stream of @streams that is of the same kind as
+ * @profile, or NULL */
+static GstCaps *
+get_passthrough_caps (GList *streams, GstEncodingProfile *profile)
+{
+        for (; streams; streams = streams->next) {
+                GstDiscovererStreamInfo *stream = streams->data;
+
+                if ((GST_IS_ENCODING_VIDEO_PROFILE (profile) &&
+                     GST_IS_DISCOVERER_VIDEO_INFO (stream)) ||
+                    (GST_IS_ENCODING_AUDIO_PROFILE (profile) &&
+                     GST_IS_DISCOVERER_AUDIO_INFO (stream)))
+                        return gst_discoverer_stream_info_get_caps (stream);
         }
 
         return NULL;
 }
 
+/**
+ * gupnp_dlna_discoverer_get_passthrough_profile:
+ * @self: The #GUPnPDLNADiscoverer object
+ * @dlna: A #GUPnPDLNAInformation, as returned by @self
+ * @target: The #GUPnPDLNAProfile that the media would be transcoded to
+ *
+ * Makes an encoding profile for transcoding the media described by @dlna to
+ * @target that only re-encodes what has to be. It is the encoding profile of
+ * @target, except that the format of each of its streams that can be taken
+ * from one of those found by gupnp_dlna_discoverer_get_passthrough_streams()
+ * is set to the caps of that stream, with no restriction. Given such a
+ * profile, encodebin links the stream to the muxer without decoding and
+ * encoding it again, so that when all the streams fit, the media is only
+ * remuxed.
+ *
+ * Returns: (transfer full): a #GstEncodingProfile, or %NULL if the media
+ *          cannot be transcoded to @target at all. Unref it with
+ *          gst_encoding_profile_unref() when done.
+ **/
+GstEncodingProfile *
+gupnp_dlna_discoverer_get_passthrough_profile (GUPnPDLNADiscoverer  *self,
+                                               GUPnPDLNAInformation *dlna,
+                                               GUPnPDLNAProfile     *target)
+{
+        GstEncodingProfile *enc_profile;
+        GstEncodingContainerProfile *container;
+        GList *streams;
+        const GList *l;
+
+        g_return_val_if_fail (self != NULL, NULL);
+        g_return_val_if_fail (dlna != NULL, NULL);
+        g_return_val_if_fail (target != NULL, NULL);
+
+        if (gupnp_dlna_discoverer_get_transcode_flags (self, dlna, target) &
+            GUPNP_DLNA_TRANSCODE_IMPOSSIBLE)
+                return NULL;
+
+        enc_profile = gupnp_dlna_profile_get_encoding_profile (target);
+        streams = gupnp_dlna_discoverer_get_passthrough_streams (self,
+                                                                 dlna,
+                                                                 target);
+
+        if (!streams || !GST_IS_ENCODING_CONTAINER_PROFILE (enc_profile)) {
+                gst_discoverer_stream_info_list_free (streams);
+                return enc_profile;
+        }
+
+        container = gst_encoding_container_profile_new
+                        (gst_encoding_profile_get_name (enc_profile),
+                         gst_encoding_profile_get_description (enc_profile),
+                         (GstCaps *) gst_encoding_profile_get_format
+                                                        (enc_profile),
+                         gst_encoding_profile_get_preset (enc_profile));
+
+        for (l = gst_encoding_container_profile_get_profiles
+                        (GST_ENCODING_CONTAINER_PROFILE (enc_profile));
+             l;
+             l = l->next) {
+                GstEncodingProfile *profile = l->data;
+                GstCaps *caps;
+
+                caps = get_passthrough_caps (streams, profile);
+
+                if (!caps)
+                        gst_encoding_profile_ref (profile);
+                else if (GST_IS_ENCODING_VIDEO_PROFILE (profile))
+                        profile = (GstEncodingProfile *)
+                                gst_encoding_video_profile_new
+                                        (caps,
+                                         NULL,
+                                         NULL,
+                                         gst_encoding_profile_get_presence
+                                                                (profile));
+                else
+                        profile = (GstEncodingProfile *)
+                                gst_encoding_audio_profile_new
+                                        (caps,
+                                         NULL,
+                                         NULL,
+                                         gst_encoding_profile_get_presence
+                                                                (profile));
+
+                if (caps)
+                        gst_caps_unref (caps);
+
+                gst_encoding_container_profile_add_profile (container,
+                                                            profile);
+        }
+
+        gst_discoverer_stream_info_list_free (streams);
+        gst_encoding_profile_unref (enc_profile);
+
+        return (GstEncodingProfile *) container;
+}
+
 /**
  * gupnp_dlna_discoverer_list_profiles:
  * @self: The #GUPnPDLNADiscoverer whose profile list is required
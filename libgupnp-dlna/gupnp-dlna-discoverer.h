@@ -76,6 +76,31 @@ typedef struct {
 
 } GUPnPDLNADiscovererClass;
 
+/**
+ * GUPnPDLNATranscodeFlags:
+ * @GUPNP_DLNA_TRANSCODE_NONE: The streams already fit the profile as they are
+ * @GUPNP_DLNA_TRANSCODE_TRANSMUX: The streams have to be put into another
+ * container, or taken out of theirs
+ * @GUPNP_DLNA_TRANSCODE_AUDIO: The audio has to be re-encoded, or dropped if
+ * the profile has no audio
+ * @GUPNP_DLNA_TRANSCODE_VIDEO: The video (or the image) has to be re-encoded
+ * @GUPNP_DLNA_TRANSCODE_IMPOSSIBLE: The media cannot be made to fit the
+ * profile, because the profile needs a stream that the media does not have
+ * or the other way around
+ *
+ * What has to be done to media for it to fit a given DLNA profile. The flags
+ * are valued so that comparing them as numbers orders the profiles by how
+ * much work it takes to produce them: transmuxing is cheaper than
+ * re-encoding the audio, which is cheaper than re-encoding the video.
+ */
+typedef enum {
+        GUPNP_DLNA_TRANSCODE_NONE       = 0,
+        GUPNP_DLNA_TRANSCODE_TRANSMUX   = 1 << 0,
+        GUPNP_DLNA_TRANSCODE_AUDIO      = 1 << 1,
+        GUPNP_DLNA_TRANSCODE_VIDEO      = 1 << 2,
+        GUPNP_DLNA_TRANSCODE_IMPOSSIBLE = 1 << 3
+} GUPnPDLNATranscodeFlags;
+
 GType gupnp_dlna_discoverer_get_type (void);
 
 GUPnPDLNADiscoverer *
@@ -98,11 +123,53 @@ gupnp_dlna_discoverer_discover_uri_sync (GUPnPDLNADiscoverer *discoverer,
                                          const gchar         *uri,
                                          GError              **err);
 
+GList *
+gupnp_dlna_discoverer_get_latency_histograms (GUPnPDLNADiscoverer *self);
+
+GList *
+gupnp_dlna_discoverer_get_stats (GUPnPDLNADiscoverer *self);
+
+gboolean
+gupnp_dlna_discoverer_load_profile_order (GUPnPDLNADiscoverer *self,
+                                          const gchar         *filename,
+                                          GError              **error);
+
+gboolean
+gupnp_dlna_discoverer_save_profile_order (GUPnPDLNADiscoverer *self,
+                                          const gchar         *filename,
+                                          GError              **error);
+
 /* Get a GUPnPDLNAProfile by name */
 GUPnPDLNAProfile *
 gupnp_dlna_discoverer_get_profile (GUPnPDLNADiscoverer *self,
                                    const gchar         *name);
 
+/* Get several GUPnPDLNAProfiles by name at once */
+GList *
+gupnp_dlna_discoverer_get_profiles (GUPnPDLNADiscoverer *self,
+                                    const gchar * const *names);
+
+/* Rank target profiles by what it takes to transcode to them */
+GUPnPDLNATranscodeFlags
+gupnp_dlna_discoverer_get_transcode_flags (GUPnPDLNADiscoverer  *self,
+                                           GUPnPDLNAInformation *dlna,
+                                           GUPnPDLNAProfile     *target);
+
+GList *
+gupnp_dlna_discoverer_rank_targets (GUPnPDLNADiscoverer  *self,
+                                    GUPnPDLNAInformation *dlna,
+                                    const GList          *targets);
+
+GList *
+gupnp_dlna_discoverer_get_passthrough_streams (GUPnPDLNADiscoverer  *self,
+                                               GUPnPDLNAInformation *dlna,
+                                               GUPnPDLNAProfile     *target);
+
+GstEncodingProfile *
+gupnp_dlna_discoverer_get_passthrough_profile (GUPnPDLNADiscoverer  *self,
+                                               GUPnPDLNAInformation *dlna,
+                                               GUPnPDLNAProfile     *target);
+
 /* API to list all available profiles */
 const GList *
 gupnp_dlna_discoverer_list_profiles (GUPnPDLNADiscoverer *self);
@@ -31,6 +31,12 @@
  * GUPnPDiscoverer API. The DLNA profile name and MIME type have their own
  * fields, and other metadata is held in a GstDiscovererInfo structure.
  * All fields are read-only.
+ *
+ * The most commonly needed metadata (duration, media types, picture size,
+ * sample rate, ...) is also summarised in a small #GstStructure, see
+ * gupnp_dlna_information_get_summary(). Results that only carry the summary
+ * and no #GstDiscovererInfo take a lot less memory to keep around (see
+ * #GUPnPDLNADiscoverer:compact-results).
  */
 
 G_DEFINE_TYPE (GUPnPDLNAInformation, gupnp_dlna_information, G_TYPE_OBJECT)
@@ -46,6 +52,7 @@ struct _GUPnPDLNAInformationPrivate {
         GstDiscovererInfo *info;
         gchar             *name;
         gchar             *mime;
+        GstStructure      *summary;
 };
 
 enum {
@@ -53,6 +60,7 @@ enum {
         PROP_DLNA_NAME,
         PROP_DLNA_MIME,
         PROP_DISCOVERER_INFO,
+        PROP_SUMMARY,
 };
 
 static void
@@ -81,6 +89,11 @@ gupnp_dlna_information_get_property (GObject    *object,
 
                         break;
 
+                case PROP_SUMMARY:
+                        g_value_set_boxed (value, priv->summary);
+
+                        break;
+
                 default:
                         G_OBJECT_WARN_INVALID_PROPERTY_ID (object,
                                                            property_id,
@@ -120,6 +133,13 @@ gupnp_dlna_information_set_property (GObject      *object,
 
                         break;
 
+                case PROP_SUMMARY:
+                        if (priv->summary)
+                                gst_structure_free (priv->summary);
+                        priv->summary = g_value_dup_boxed (value);
+
+                        break;
+
                 default:
                         G_OBJECT_WARN_INVALID_PROPERTY_ID (object,
                                                            property_id,
@@ -140,6 +160,8 @@ gupnp_dlna_information_finalize (GObject *object)
         g_free (priv->mime);
         if (priv->info)
                 gst_discoverer_info_unref (priv->info);
+        if (priv->summary)
+                gst_structure_free (priv->summary);
 
         G_OBJECT_CLASS (gupnp_dlna_information_parent_class)->finalize (object);
 }
@@ -184,6 +206,15 @@ gupnp_dlna_information_class_init (GUPnPDLNAInformationClass *klass)
         g_object_class_install_property (object_class,
                                          PROP_DISCOVERER_INFO,
                                          pspec);
+
+        pspec = g_param_spec_boxed ("summary",
+                                    "Stream summary",
+                                    "The main properties of the stream in "
+                                    "a GstStructure",
+                                    GST_TYPE_STRUCTURE,
+                                    G_PARAM_READWRITE |
+                                    G_PARAM_CONSTRUCT_ONLY);
+        g_object_class_install_property (object_class, PROP_SUMMARY, pspec);
 }
 
 static void
@@ -194,6 +225,7 @@ gupnp_dlna_information_init (GUPnPDLNAInformation *self)
         priv->name = NULL;
         priv->mime = NULL;
         priv->info = NULL;
+        priv->summary = NULL;
 }
 
 /**
@@ -254,7 +286,11 @@ gupnp_dlna_information_get_mime (GUPnPDLNAInformation *self)
  * @self: The #GUPnPDLNAInformation object
  *
  * Returns: additional stream metadata for @self in the form of a
- *          #GstDiscovererInfo structure. Do not free this structure.
+ *          #GstDiscovererInfo structure, or NULL if the stream was not
+ *          discovered with GStreamer (see #GUPnPDLNADiscoverer:fast-probe)
+ *          or the information was dropped after matching (see
+ *          #GUPnPDLNADiscoverer:compact-results). Do not free this
+ *          structure.
  */
 const GstDiscovererInfo *
 gupnp_dlna_information_get_info (GUPnPDLNAInformation *self)
@@ -263,3 +299,62 @@ gupnp_dlna_information_get_info (GUPnPDLNAInformation *self)
 
         return priv->info;
 }
+
+/**
+ * gupnp_dlna_information_get_summary:
+ * @self: The #GUPnPDLNAInformation object
+ *
+ * Returns the main properties of the stream represented by @self as a
+ * #GstStructure named "gupnp-dlna-summary". Each of the following fields is
+ * only present if it is known:
+ *
+ *   "uri" (string): the URI of the stream
+ *   "duration" (guint64): the duration of the stream, in nanoseconds
+ *   "container-format" (string): the media type of the container
+ *   "video-format" (string): the media type of the first video stream (or
+ *     of the image)
+ *   "width", "height" (int), "framerate" (fraction), "video-bitrate": the
+ *     properties of the first video stream
+ *   "audio-format" (string): the media type of the first audio stream
+ *   "rate", "channels" (int), "audio-bitrate": the properties of the first
+ *     audio stream
+ *   "match-time" (guint64): the time taken to find the DLNA profile, in
+ *     nanoseconds
+ *
+ * The summary is available whether or not @self carries a
+ * #GstDiscovererInfo, and can be turned into a string with
+ * gst_structure_to_string().
+ *
+ * Returns: the summary of @self, or NULL if there is none. Do not free this
+ *          structure.
+ */
+const GstStructure *
+gupnp_dlna_information_get_summary (GUPnPDLNAInformation *self)
+{
+        GUPnPDLNAInformationPrivate *priv = GET_PRIVATE (self);
+
+        return priv->summary;
+}
+
+/**
+ * gupnp_dlna_information_get_duration:
+ * @self: The #GUPnPDLNAInformation object
+ *
+ * Returns: the duration of the stream represented by @self, or
+ *          #GST_CLOCK_TIME_NONE if it is not known.
+ */
+GstClockTime
+gupnp_dlna_information_get_duration (GUPnPDLNAInformation *self)
+{
+        GUPnPDLNAInformationPrivate *priv = GET_PRIVATE (self);
+        guint64 duration;
+
+        if (priv->summary &&
+            gst_structure_get_uint64 (priv->summary, "duration", &duration))
+                return duration;
+
+        if (priv->info)
+                return gst_discoverer_info_get_duration (priv->info);
+
+        return GST_CLOCK_TIME_NONE;
+}
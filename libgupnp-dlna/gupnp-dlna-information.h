@@ -70,10 +70,11 @@ const gchar * gupnp_dlna_information_get_mime (GUPnPDLNAInformation *self);
 const GstDiscovererInfo *
 gupnp_dlna_information_get_info (GUPnPDLNAInformation *self);
 
-G_GNUC_INTERNAL GUPnPDLNAInformation *
-gupnp_dlna_information_new_from_discoverer_info (GstDiscovererInfo *info,
-                                                 GList             *profiles);
+const GstStructure *
+gupnp_dlna_information_get_summary (GUPnPDLNAInformation *self);
 
+GstClockTime
+gupnp_dlna_information_get_duration (GUPnPDLNAInformation *self);
 
 G_END_DECLS
 
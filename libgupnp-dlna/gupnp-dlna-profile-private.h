@@ -39,6 +39,10 @@ void gupnp_dlna_profile_set_container_caps (GUPnPDLNAProfile *self, GstCaps *cap
 void gupnp_dlna_profile_set_video_caps (GUPnPDLNAProfile *self, GstCaps *caps);
 void gupnp_dlna_profile_set_audio_caps (GUPnPDLNAProfile *self, GstCaps *caps);
 
+/* Profiles with a higher priority are checked first when matching */
+gint gupnp_dlna_profile_get_priority (GUPnPDLNAProfile *self);
+void gupnp_dlna_profile_set_priority (GUPnPDLNAProfile *self, gint priority);
+
 G_END_DECLS
 
 #endif /* __GUPNP_DLNA_PROFILE_PRIVATE_H__ */
@@ -49,9 +49,14 @@ struct _GUPnPDLNAProfilePrivate {
         GstCaps            *video_caps;
         GstCaps            *audio_caps;
         gboolean           extended;
+        gint               priority;
         GstEncodingProfile *enc_profile;
+        volatile gsize     enc_profile_built;
 };
 
+static GstEncodingProfile *
+ensure_encoding_profile (GUPnPDLNAProfilePrivate *priv);
+
 enum {
         PROP_0,
         PROP_DLNA_NAME,
@@ -79,8 +84,10 @@ gupnp_dlna_profile_get_property (GObject    *object,
                         break;
 
                 case PROP_ENCODING_PROFILE:
-                        gst_value_set_mini_object (value,
-                                        GST_MINI_OBJECT (priv->enc_profile));
+                        gst_value_set_mini_object
+                                (value,
+                                 GST_MINI_OBJECT
+                                        (ensure_encoding_profile (priv)));
                         break;
 
                 case PROP_DLNA_EXTENDED:
@@ -200,6 +207,65 @@ gupnp_dlna_profile_class_init (GUPnPDLNAProfileClass *klass)
 
 }
 
+static GstEncodingProfile *
+build_encoding_profile (GUPnPDLNAProfilePrivate *priv)
+{
+        GstEncodingContainerProfile *container = NULL;
+        GstEncodingAudioProfile *audio_profile = NULL;
+        GstEncodingVideoProfile *video_profile = NULL;
+
+        if (GST_IS_CAPS (priv->video_caps) &&
+            !gst_caps_is_empty (priv->video_caps))
+                video_profile = gst_encoding_video_profile_new
+                                (priv->video_caps,NULL, NULL, 0);
+
+        if (GST_IS_CAPS (priv->audio_caps) &&
+            !gst_caps_is_empty (priv->audio_caps))
+                audio_profile = gst_encoding_audio_profile_new
+                                (priv->audio_caps,NULL, NULL, 0);
+
+        if (GST_IS_CAPS (priv->container_caps)) {
+                container = gst_encoding_container_profile_new
+                                (priv->name,
+                                 priv->mime,
+                                 priv->container_caps,
+                                 NULL);
+
+                if (video_profile)
+                        gst_encoding_container_profile_add_profile
+                                (container,
+                                 (GstEncodingProfile *)video_profile);
+
+                if (audio_profile)
+                        gst_encoding_container_profile_add_profile
+                                (container,
+                                 (GstEncodingProfile *) audio_profile);
+
+                return (GstEncodingProfile *)container;
+        }
+
+        if (video_profile)
+                /* Container-less video isn't a possibility yet */
+                g_assert_not_reached ();
+
+        /* Container-less audio */
+        return (GstEncodingProfile *)audio_profile;
+}
+
+/* The encoding profile is only built once, by whichever thread asks for it
+ * first, so that profiles can be shared between threads. The caps must not
+ * be changed after that. */
+static GstEncodingProfile *
+ensure_encoding_profile (GUPnPDLNAProfilePrivate *priv)
+{
+        if (g_once_init_enter (&priv->enc_profile_built)) {
+                priv->enc_profile = build_encoding_profile (priv);
+                g_once_init_leave (&priv->enc_profile_built, 1);
+        }
+
+        return priv->enc_profile;
+}
+
 static void
 gupnp_dlna_profile_init (GUPnPDLNAProfile *self)
 {
@@ -226,6 +292,20 @@ gupnp_dlna_profile_get_audio_caps (GUPnPDLNAProfile *self)
         return priv->audio_caps;
 }
 
+gint
+gupnp_dlna_profile_get_priority (GUPnPDLNAProfile *self)
+{
+        GUPnPDLNAProfilePrivate *priv = GET_PRIVATE (self);
+        return priv->priority;
+}
+
+void
+gupnp_dlna_profile_set_priority (GUPnPDLNAProfile *self, gint priority)
+{
+        GUPnPDLNAProfilePrivate *priv = GET_PRIVATE (self);
+        priv->priority = priority;
+}
+
 void
 gupnp_dlna_profile_set_container_caps (GUPnPDLNAProfile *self, GstCaps *caps)
 {
@@ -319,57 +399,11 @@ GstEncodingProfile *
 gupnp_dlna_profile_get_encoding_profile (GUPnPDLNAProfile *self)
 {
         GUPnPDLNAProfilePrivate *priv = GET_PRIVATE (self);
+        GstEncodingProfile *enc_profile = ensure_encoding_profile (priv);
 
-        /* create an encoding-profile if we don't have one */
-        if (!priv->enc_profile) {
-                GstEncodingContainerProfile *container = NULL;
-                GstEncodingAudioProfile *audio_profile = NULL;
-                GstEncodingVideoProfile *video_profile = NULL;
-
-                if (GST_IS_CAPS (priv->video_caps) &&
-                    !gst_caps_is_empty (priv->video_caps))
-                        video_profile = gst_encoding_video_profile_new
-                                        (priv->video_caps,NULL, NULL, 0);
-
-                if (GST_IS_CAPS (priv->audio_caps) &&
-                    !gst_caps_is_empty (priv->audio_caps))
-                        audio_profile = gst_encoding_audio_profile_new
-                                        (priv->audio_caps,NULL, NULL, 0);
-
-                if (GST_IS_CAPS (priv->container_caps)) {
-                        container = gst_encoding_container_profile_new
-                                        (priv->name,
-                                         priv->mime,
-                                         priv->container_caps,
-                                         NULL);
-
-                        if (video_profile)
-                                gst_encoding_container_profile_add_profile
-                                        (container,
-                                         (GstEncodingProfile *)video_profile);
-
-                        if (audio_profile)
-                                gst_encoding_container_profile_add_profile
-                                        (container,
-                                         (GstEncodingProfile *) audio_profile);
-
-                        priv->enc_profile = (GstEncodingProfile *)container;
-                } else {
-                        if(audio_profile)
-                                /* Container-less audio */
-                                priv->enc_profile =
-                                        (GstEncodingProfile *)audio_profile;
-
-                        if (video_profile)
-                                /* Container-less video isn't a possibility
-                                   yet */
-                                g_assert_not_reached ();
-                }
-        }
-
-        gst_encoding_profile_ref (priv->enc_profile);
+        gst_encoding_profile_ref (enc_profile);
 
-        return priv->enc_profile;
+        return enc_profile;
 }
 
 /**
@@ -23,6 +23,8 @@
 #include <gst/pbutils/pbutils.h>
 #include "gupnp-dlna-discoverer.h"
 #include "gupnp-dlna-profile.h"
+#include "stream-description.h"
+#include "profile-table.h"
 
 /*
  * This file provides the infrastructure to load DLNA profiles and the
@@ -64,52 +66,179 @@
 
 /* New profile guessing API */
 
+/* Matching is logged to the "gupnp-dlna" debug category, set up the first time
+ * a profile is guessed. Setting GUPNP_DLNA_DEBUG (to anything but "0") turns
+ * it on without having to go through GST_DEBUG. Every profile that is
+ * checked is logged at the LOG level, and the reason why it was rejected at
+ * the DEBUG level. All of this is compiled out with GST_DISABLE_GST_DEBUG. */
+
 #define GUPNP_DLNA_DEBUG_ENV "GUPNP_DLNA_DEBUG"
 
-#define gupnp_dlna_debug(args...)                               \
-do {                                                            \
-        const gchar *_e = g_getenv (GUPNP_DLNA_DEBUG_ENV);      \
-        if (_e && !g_str_equal (_e, "0"))                       \
-                g_debug (args);                                 \
-} while (0)
+GST_DEBUG_CATEGORY_STATIC (gupnp_dlna_debug);
+#define GST_CAT_DEFAULT gupnp_dlna_debug
 
-static gboolean
-is_video_profile (const GstEncodingProfile *profile)
+static void
+debug_init (void)
 {
-        const GList *i, *profiles_list;
+#ifndef GST_DISABLE_GST_DEBUG
+        static volatile gsize initialized = 0;
 
-        if (GST_IS_ENCODING_CONTAINER_PROFILE (profile)) {
-                profiles_list = gst_encoding_container_profile_get_profiles
-                                     (GST_ENCODING_CONTAINER_PROFILE (profile));
+        if (g_once_init_enter (&initialized)) {
+                const gchar *env = g_getenv (GUPNP_DLNA_DEBUG_ENV);
 
-                for (i = profiles_list ; i; i = i->next)
-                        if (GST_IS_ENCODING_VIDEO_PROFILE (i->data))
-                                return TRUE;
-        }
+                GST_DEBUG_CATEGORY_INIT (gupnp_dlna_debug,
+                                         "gupnp-dlna",
+                                         0,
+                                         "GUPnP DLNA profile matching");
 
-        return FALSE;
+                if (env && !g_str_equal (env, "0")) {
+                        gst_debug_set_active (TRUE);
+                        gst_debug_category_set_threshold (gupnp_dlna_debug,
+                                                          GST_LEVEL_DEBUG);
+                }
+
+                g_once_init_leave (&initialized, 1);
+        }
+#endif
 }
 
-static gboolean
-structure_can_intersect (const GstStructure *st1, const GstStructure *st2)
+/* Reported instead of a field name when the media types differ */
+static const gchar media_type_field[] = "media-type";
+
+/* Returns the first field of restriction_st that stream_st fails, or NULL if
+ * the two match */
+static const gchar *
+mismatch_field (const GstStructure *stream_st,
+                const GstStructure *restriction_st)
 {
-        /* Since there is no API to intersect GstStructures, we cheat (thanks
-         * for the idea, tpm!) and make caps from the structuresa */
+        int i;
+
+        if (!gst_structure_has_name (stream_st,
+                                     gst_structure_get_name (restriction_st)))
+                return media_type_field;
+
+        for (i = 0; i < gst_structure_n_fields (restriction_st); i++) {
+                const gchar *name;
+                const GValue *value;
+                GValue intersection = { 0, };
 
-        GstCaps *caps1, *caps2;
-        gboolean ret;
+                name = gst_structure_nth_field_name (restriction_st, i);
+                value = gst_structure_get_value (stream_st, name);
 
-        caps1 = gst_caps_new_full (gst_structure_copy (st1), NULL);
-        caps2 = gst_caps_new_full (gst_structure_copy (st2), NULL);
+                if (!value)
+                        return name;
 
-        ret = gst_caps_can_intersect (caps1, caps2);
+                if (!gst_value_intersect (&intersection,
+                                          value,
+                                          gst_structure_get_value
+                                                (restriction_st, name)))
+                        return name;
+
+                g_value_unset (&intersection);
+        }
+
+        return NULL;
+}
 
-        gst_caps_unref (caps1);
-        gst_caps_unref (caps2);
+#ifndef GST_DISABLE_GST_DEBUG
+
+static gchar *
+describe_mismatch (const GstStructure *stream_st,
+                   const GstStructure *restriction_st,
+                   const gchar        *field)
+{
+        const GValue *value;
+        gchar *expected_str, *value_str, *ret;
+
+        if (!field)
+                return g_strdup ("no match");
+
+        if (field == media_type_field)
+                return g_strdup_printf ("format is %s, not %s",
+                                        gst_structure_get_name (stream_st),
+                                        gst_structure_get_name
+                                                (restriction_st));
+
+        value = gst_structure_get_value (stream_st, field);
+        if (!value)
+                return g_strdup_printf ("missing field %s", field);
+
+        value_str = gst_value_serialize (value);
+        expected_str = gst_value_serialize (gst_structure_get_value
+                                                (restriction_st, field));
+        ret = g_strdup_printf ("%s is %s, not %s",
+                               field,
+                               value_str,
+                               expected_str);
+        g_free (value_str);
+        g_free (expected_str);
 
         return ret;
 }
 
+#endif /* GST_DISABLE_GST_DEBUG */
+
+/* Logs and counts the rejection of one of the restrictions of profile i.
+ * Finding out which field failed is only done if someone is interested. */
+static void
+note_rejection (const GUPnPDLNAProfileTable *table,
+                guint                       i,
+                const gchar                 *what,
+                const GstStructure          *stream_st,
+                const GstStructure          *restriction_st,
+                GUPnPDLNAMatchStats         *stats)
+{
+        const gchar *field;
+        gboolean debug = FALSE;
+
+#ifndef GST_DISABLE_GST_DEBUG
+        debug = gst_debug_category_get_threshold (gupnp_dlna_debug) >=
+                GST_LEVEL_DEBUG;
+#endif
+
+        if (!stats && !debug)
+                return;
+
+        field = mismatch_field (stream_st, restriction_st);
+
+        if (stats)
+                gupnp_dlna_match_stats_rejected (stats,
+                                                 table->names[i],
+                                                 what,
+                                                 field ? field : "other");
+
+#ifndef GST_DISABLE_GST_DEBUG
+        if (debug) {
+                gchar *reason;
+
+                reason = describe_mismatch (stream_st, restriction_st, field);
+                GST_DEBUG ("%s: %s restriction rejected: %s",
+                           table->names[i],
+                           what,
+                           reason);
+                g_free (reason);
+        }
+#endif
+}
+
+/* Same as above, when a stream is missing ("missing"), or when the profile
+ * does not allow for a stream ("unexpected") */
+static void
+note_stream_rejection (const GUPnPDLNAProfileTable *table,
+                       guint                       i,
+                       const gchar                 *what,
+                       const gchar                 *reason,
+                       GUPnPDLNAMatchStats         *stats)
+{
+        GST_DEBUG ("%s: %s stream %s", table->names[i], what, reason);
+
+        if (stats)
+                gupnp_dlna_match_stats_rejected (stats,
+                                                 table->names[i],
+                                                 what,
+                                                 reason);
+}
+
 static gboolean
 structure_is_subset (const GstStructure *st1, const GstStructure *st2)
 {
@@ -118,68 +247,107 @@ structure_is_subset (const GstStructure *st1, const GstStructure *st2)
         for (i = 0; i < gst_structure_n_fields (st2); i++) {
                 const gchar *name = gst_structure_nth_field_name (st2, i);
 
-                if (!gst_structure_has_field(st1, name)) {
-                        gupnp_dlna_debug ("    missing field %s", name);
+                if (!gst_structure_has_field(st1, name))
                         return FALSE;
-                }
         }
 
         return TRUE;
 }
 
 /*
- * Returns TRUE if stream_caps and profile_caps can intersect, and the
- * intersecting structure from profile_caps is a subset of stream_caps. Put
- * simply, the condition being met is that stream_caps intersects with
- * profile_caps, and that intersection includes *all* fields specified by
- * profile_caps (viz. all the fields specified by the DLNA profile's
- * restrictions)
+ * Returns TRUE if stream_caps can intersect with one of the restrictions in
+ * [first, last), and that restriction is a subset of stream_caps. Put
+ * simply, the condition being met is that stream_caps intersects with the
+ * profile's caps, and that intersection includes *all* fields specified by
+ * the DLNA profile's restrictions. Each restriction holds a single
+ * structure, and so does stream_caps. profile and what are only used for
+ * debugging.
  */
 static gboolean
-caps_can_intersect_and_is_subset (GstCaps       *stream_caps,
-                                  const GstCaps *profile_caps)
+caps_can_intersect_and_is_subset (GstCaps                     *stream_caps,
+                                  const GUPnPDLNAProfileTable *table,
+                                  guint                       profile,
+                                  const gchar                 *what,
+                                  guint                       first,
+                                  guint                       last,
+                                  GUPnPDLNAMatchStats         *stats)
 {
-        int i;
-        GstStructure *stream_st, *profile_st;
+        GstStructure *stream_st;
+        guint i;
 
         stream_st = gst_caps_get_structure (stream_caps, 0);
 
-        for (i = 0; i < gst_caps_get_size (profile_caps); i++) {
-                profile_st = gst_caps_get_structure (profile_caps, i);
+        for (i = first; i < last; i++) {
+                GstCaps *restriction = table->restrictions[i];
+                GstStructure *restriction_st;
 
-                if (structure_can_intersect (stream_st, profile_st) &&
-                    structure_is_subset (stream_st, profile_st))
+                restriction_st = gst_caps_get_structure (restriction, 0);
+
+                if (gst_caps_can_intersect (stream_caps, restriction) &&
+                    structure_is_subset (stream_st, restriction_st))
                         return TRUE;
+
+                note_rejection (table,
+                                profile,
+                                what,
+                                stream_st,
+                                restriction_st,
+                                stats);
         }
 
         return FALSE;
 }
 
 static gboolean
-match_profile (GstEncodingProfile *profile,
-               GstCaps            *caps,
-               GType              type)
+match_any_stream (GList                       *streams,
+                  const GUPnPDLNAProfileTable *table,
+                  guint                       profile,
+                  const gchar                 *what,
+                  guint                       first,
+                  guint                       last,
+                  GUPnPDLNAMatchStats         *stats)
 {
-        const GList *i, *profiles_list;
-        const gchar *name;
+        GList *i;
 
-        /* Profiles with an empty name are used only for inheritance and should
-         * not be matched against. */
-        name = gst_encoding_profile_get_name (profile);
-        if (name[0] == '\0')
+        if (first == last) {
+                note_stream_rejection (table,
+                                       profile,
+                                       what,
+                                       "unexpected",
+                                       stats);
                 return FALSE;
+        }
 
-        profiles_list = gst_encoding_container_profile_get_profiles
-                                     (GST_ENCODING_CONTAINER_PROFILE (profile));
-
-        for (i = profiles_list; i; i = i->next){
-                GstEncodingProfile *enc_profile = GST_ENCODING_PROFILE
-                                        (i->data);
-                const GstCaps *format = gst_encoding_profile_get_format
-                                        (enc_profile);
+        if (!streams)
+                note_stream_rejection (table,
+                                       profile,
+                                       what,
+                                       "missing",
+                                       stats);
+
+        for (i = streams; i; i = i->next) {
+                GstCaps *caps = GST_CAPS (i->data);
+                gboolean ret;
+
+                /* Only the first structure of the stream caps is matched */
+                if (gst_caps_get_size (caps) > 1)
+                        caps = gst_caps_new_full
+                                (gst_structure_copy
+                                        (gst_caps_get_structure (caps, 0)),
+                                 NULL);
+                else
+                        gst_caps_ref (caps);
+
+                ret = caps_can_intersect_and_is_subset (caps,
+                                                        table,
+                                                        profile,
+                                                        what,
+                                                        first,
+                                                        last,
+                                                        stats);
+                gst_caps_unref (caps);
 
-                if (type == G_TYPE_FROM_INSTANCE (enc_profile) &&
-                    caps_can_intersect_and_is_subset (caps, format))
+                if (ret)
                         return TRUE;
         }
 
@@ -187,357 +355,384 @@ match_profile (GstEncodingProfile *profile,
 }
 
 static gboolean
-check_container (GstDiscovererInfo  *info,
-                 GstEncodingProfile *profile)
+match_video (const GUPnPDLNAStreamDescription *desc,
+             const GUPnPDLNAProfileTable      *table,
+             guint                            i,
+             GUPnPDLNAMatchStats              *stats)
+{
+        return match_any_stream (desc->video,
+                                 table,
+                                 i,
+                                 "video",
+                                 table->video_offsets[i],
+                                 table->audio_offsets[i],
+                                 stats);
+}
+
+static gboolean
+match_audio (const GUPnPDLNAStreamDescription *desc,
+             const GUPnPDLNAProfileTable      *table,
+             guint                            i,
+             GUPnPDLNAMatchStats              *stats)
 {
-        GstDiscovererStreamInfo *stream_info;
-        GType stream_type;
-        GstCaps *stream_caps;
-        gboolean ret = FALSE;
+        return match_any_stream (desc->audio,
+                                 table,
+                                 i,
+                                 "audio",
+                                 table->audio_offsets[i],
+                                 table->video_offsets[i + 1],
+                                 stats);
+}
 
-        const GstCaps *profile_caps = gst_encoding_profile_get_format (profile);
+static gboolean
+check_container (const GUPnPDLNAStreamDescription *desc,
+                 const GUPnPDLNAProfileTable      *table,
+                 guint                            i,
+                 GUPnPDLNAMatchStats              *stats)
+{
+        if (desc->container) {
+                /* The container caps of profiles without a container are
+                 * empty, and have no structure to report */
+                if (!(table->flags[i] & GUPNP_DLNA_PROFILE_TABLE_CONTAINER)) {
+                        note_stream_rejection (table,
+                                               i,
+                                               "container",
+                                               "unexpected",
+                                               stats);
+                        return FALSE;
+                }
 
-        /* Top-level GstStreamInformation in the topology will be
-         * the container */
-        stream_info = gst_discoverer_info_get_stream_info (info);
-        stream_caps = gst_discoverer_stream_info_get_caps (stream_info);
-        stream_type = G_TYPE_FROM_INSTANCE (stream_info);
+                if (gst_caps_can_intersect (desc->container,
+                                            table->container_caps[i]))
+                        return TRUE;
 
-        if (stream_type == GST_TYPE_DISCOVERER_CONTAINER_INFO &&
-            gst_caps_can_intersect (stream_caps, profile_caps))
-                ret = TRUE;
-        else if (stream_type != GST_TYPE_DISCOVERER_CONTAINER_INFO &&
-                 gst_caps_is_empty (profile_caps))
-                ret = TRUE;
+                note_rejection (table,
+                                i,
+                                "container",
+                                gst_caps_get_structure (desc->container, 0),
+                                gst_caps_get_structure
+                                        (table->container_caps[i], 0),
+                                stats);
+                return FALSE;
+        }
 
-        gst_discoverer_stream_info_unref (stream_info);
-        gst_caps_unref (stream_caps);
+        if (table->flags[i] & GUPNP_DLNA_PROFILE_TABLE_CONTAINER) {
+                note_stream_rejection (table,
+                                       i,
+                                       "container",
+                                       "missing",
+                                       stats);
+                return FALSE;
+        }
 
-        return ret;
+        return TRUE;
 }
 
-static GstCaps *
-caps_from_audio_stream_info (GstDiscovererStreamInfo *info)
+static void
+set_match (const GUPnPDLNAProfileTable *table,
+           guint                       i,
+           gchar                       **name,
+           gchar                       **mime,
+           GUPnPDLNAMatchStats         *stats)
 {
-        GstCaps *temp = gst_discoverer_stream_info_get_caps (info);
-        GstCaps *caps = gst_caps_copy (temp);
-        const GstDiscovererAudioInfo *audio_info =
-                GST_DISCOVERER_AUDIO_INFO(info);
-        guint data;
+        if (stats)
+                gupnp_dlna_match_stats_matched (stats, table->names[i]);
 
-        gst_caps_unref (temp);
+        *name = g_strdup (table->names[i]);
+        *mime = g_strdup (table->mimes[i]);
+}
 
-        data = gst_discoverer_audio_info_get_sample_rate (audio_info);
-        if (data)
-                gst_caps_set_simple (caps, "rate", G_TYPE_INT, data, NULL);
+static void
+note_evaluation (const GUPnPDLNAProfileTable *table,
+                 guint                       i,
+                 GUPnPDLNAMatchStats         *stats)
+{
+        GST_LOG ("Checking DLNA profile %s", table->names[i]);
 
-        data = gst_discoverer_audio_info_get_channels (audio_info);
-        if (data)
-                gst_caps_set_simple (caps, "channels", G_TYPE_INT, data, NULL);
+        if (stats)
+                gupnp_dlna_match_stats_evaluated (stats, table->names[i]);
+}
 
-        data = gst_discoverer_audio_info_get_bitrate (audio_info);
-        if (data)
-                gst_caps_set_simple (caps, "bitrate", G_TYPE_INT, data, NULL);
+static void
+guess_audio_profile (const GUPnPDLNAStreamDescription *desc,
+                     gchar                            **name,
+                     gchar                            **mime,
+                     const GUPnPDLNAProfileTable      *table,
+                     GUPnPDLNAMatchStats              *stats)
+{
+        guint i;
 
-        data = gst_discoverer_audio_info_get_max_bitrate (audio_info);
-        if (data)
-                gst_caps_set_simple
-                        (caps, "maximum-bitrate", G_TYPE_INT, data, NULL);
+        for (i = 0; i < table->n_profiles; i++) {
+                guint8 flags = table->flags[i];
 
-        data = gst_discoverer_audio_info_get_depth (audio_info);
-        if (data)
-                gst_caps_set_simple (caps, "depth", G_TYPE_INT, data, NULL);
+                if (!(flags & GUPNP_DLNA_PROFILE_TABLE_MATCHABLE))
+                        continue;
 
-        return caps;
+                note_evaluation (table, i, stats);
+
+                if (flags & GUPNP_DLNA_PROFILE_TABLE_VIDEO)
+                        note_stream_rejection (table,
+                                               i,
+                                               "video",
+                                               "missing",
+                                               stats);
+                else if (match_audio (desc, table, i, stats) &&
+                         check_container (desc, table, i, stats)) {
+                        set_match (table, i, name, mime, stats);
+                        break;
+                }
+        }
 }
 
 static gboolean
-check_audio_profile (GstDiscovererInfo  *info,
-                     GstEncodingProfile *profile)
+check_video_profile (const GUPnPDLNAStreamDescription *desc,
+                     const GUPnPDLNAProfileTable      *table,
+                     guint                            i,
+                     GUPnPDLNAMatchStats              *stats)
 {
-        GstCaps *caps;
-        GList *i, *stream_list;
-        gboolean found = FALSE;
-
-        /* Optimisation TODO: this can be pre-computed */
-        if (is_video_profile (profile))
-                return FALSE;
-
-        stream_list = gst_discoverer_info_get_stream_list (info);
+        /* Check video and audio restrictions, then container restrictions */
+        return match_video (desc, table, i, stats) &&
+               match_audio (desc, table, i, stats) &&
+               check_container (desc, table, i, stats);
+}
 
-        for (i = stream_list; !found && i; i = i->next) {
-                GstDiscovererStreamInfo *stream =
-                        GST_DISCOVERER_STREAM_INFO(i->data);
-                GType stream_type = G_TYPE_FROM_INSTANCE (stream);
+static void
+guess_video_profile (const GUPnPDLNAStreamDescription *desc,
+                     gchar                            **name,
+                     gchar                            **mime,
+                     const GUPnPDLNAProfileTable      *table,
+                     GUPnPDLNAMatchStats              *stats)
+{
+        guint i;
 
-                if (stream_type != GST_TYPE_DISCOVERER_AUDIO_INFO)
+        for (i = 0; i < table->n_profiles; i++) {
+                if (!(table->flags[i] & GUPNP_DLNA_PROFILE_TABLE_MATCHABLE))
                         continue;
 
-                caps = caps_from_audio_stream_info (stream);
+                note_evaluation (table, i, stats);
 
-                if (match_profile (profile,
-                                   caps,
-                                   GST_TYPE_ENCODING_AUDIO_PROFILE)) {
-                        found = TRUE;
+                if (check_video_profile (desc, table, i, stats)) {
+                        set_match (table, i, name, mime, stats);
                         break;
                 }
-
-                gst_caps_unref (caps);
         }
-
-        gst_discoverer_stream_info_list_free (stream_list);
-
-        return found;
 }
 
 static void
-guess_audio_profile (GstDiscovererInfo *info,
-                     gchar             **name,
-                     gchar             **mime,
-                     GList             *profiles)
+guess_image_profile (const GUPnPDLNAStreamDescription *desc,
+                     gchar                            **name,
+                     gchar                            **mime,
+                     const GUPnPDLNAProfileTable      *table,
+                     GUPnPDLNAMatchStats              *stats)
 {
-        GList *i;
-        GUPnPDLNAProfile *profile;
-        GstEncodingProfile *enc_profile;
-
-        for (i = profiles; i; i = i->next) {
-                profile = (GUPnPDLNAProfile *)(i->data);
-                enc_profile = gupnp_dlna_profile_get_encoding_profile (profile);
-
-                gupnp_dlna_debug ("Checking DLNA profile %s",
-                                  gupnp_dlna_profile_get_name (profile));
-
-                if (!check_audio_profile (info, enc_profile))
-                        gupnp_dlna_debug ("  Audio did not match");
-                else if (!check_container (info, enc_profile))
-                        gupnp_dlna_debug ("  Container did not match");
-                else {
-                        *name = g_strdup
-                                (gupnp_dlna_profile_get_name (profile));
-                        *mime = g_strdup
-                                (gupnp_dlna_profile_get_mime (profile));
+        GList image = { desc->video->data, NULL, NULL };
+        guint i;
+
+        for (i = 0; i < table->n_profiles; i++) {
+                guint8 flags = table->flags[i];
+
+                if (!(flags & GUPNP_DLNA_PROFILE_TABLE_MATCHABLE) ||
+                    !(flags & GUPNP_DLNA_PROFILE_TABLE_VIDEO))
+                        continue;
+
+                note_evaluation (table, i, stats);
+
+                /* Only the first video stream is checked for images */
+                if (match_any_stream (&image,
+                                      table,
+                                      i,
+                                      "image",
+                                      table->video_offsets[i],
+                                      table->audio_offsets[i],
+                                      stats)) {
+                        /* Found a match */
+                        set_match (table, i, name, mime, stats);
                         break;
                 }
         }
 }
 
-static GstCaps *
-caps_from_video_stream_info (GstDiscovererStreamInfo *info)
+static gboolean
+profile_is_image (const GUPnPDLNAProfileTable *table, guint i)
 {
-        GstCaps *temp = gst_discoverer_stream_info_get_caps (info);
-        GstCaps *caps = gst_caps_copy (temp);
-        const GstDiscovererVideoInfo *video_info =
-                GST_DISCOVERER_VIDEO_INFO (info);
-        const GstTagList *stream_tag_list;
-        guint n, d, data;
-        gboolean value;
-
-        gst_caps_unref (temp);
-
-        data = gst_discoverer_video_info_get_height (video_info);
-        if (data)
-                gst_caps_set_simple (caps, "height", G_TYPE_INT, data, NULL);
-
-        data = gst_discoverer_video_info_get_width (video_info);
-        if (data)
-                gst_caps_set_simple (caps, "width", G_TYPE_INT, data, NULL);
-
-        data = gst_discoverer_video_info_get_depth (video_info);
-        if (data)
-                gst_caps_set_simple (caps, "depth", G_TYPE_INT, data, NULL);
-
-        n = gst_discoverer_video_info_get_framerate_num (video_info);
-        d = gst_discoverer_video_info_get_framerate_denom (video_info);
-        if (n && d)
-                gst_caps_set_simple (caps,
-                                     "framerate",
-                                     GST_TYPE_FRACTION, n, d,
-                                     NULL);
-
-        n = gst_discoverer_video_info_get_par_num (video_info);
-        d = gst_discoverer_video_info_get_par_denom (video_info);
-        if (n && d)
-                gst_caps_set_simple (caps,
-                                     "pixel-aspect-ratio",
-                                     GST_TYPE_FRACTION, n, d,
-                                     NULL);
-
-        value = gst_discoverer_video_info_is_interlaced (video_info);
-        if (value)
-                gst_caps_set_simple
-                        (caps, "interlaced", G_TYPE_BOOLEAN, value, NULL);
-
-        stream_tag_list = gst_discoverer_stream_info_get_tags (info);
-        if (stream_tag_list) {
-                guint bitrate;
-                if (gst_tag_list_get_uint (stream_tag_list, "bitrate", &bitrate))
-                        gst_caps_set_simple
-                             (caps, "bitrate", G_TYPE_INT, (int) bitrate, NULL);
-
-                if (gst_tag_list_get_uint (stream_tag_list,
-                                           "maximum-bitrate",
-                                           &bitrate))
-                        gst_caps_set_simple (caps,
-                                             "maximum-bitrate",
-                                             G_TYPE_INT,
-                                             (int) bitrate,
-                                             NULL);
-        }
-
-        return caps;
+        return table->mimes[i] && g_str_has_prefix (table->mimes[i], "image/");
 }
 
-static gboolean
-check_video_profile (GstDiscovererInfo  *info,
-                     GstEncodingProfile *profile)
+/*
+ * Works out what would have to be done to @desc for it to fit profile i of
+ * @profiles, using the same checks as the matcher for each stream but going
+ * on past the first one that fails. Audio does not fit a profile without
+ * audio restrictions, and has to be dropped, which is counted as
+ * re-encoding it. Unlike the matcher, which never picks such a profile,
+ * this lets video without audio fit it. Nothing is recorded in the
+ * statistics.
+ */
+GUPnPDLNATranscodeFlags
+gupnp_dlna_stream_description_get_transcode_flags
+                                (const GUPnPDLNAStreamDescription *desc,
+                                 const GUPnPDLNAProfileTable      *profiles,
+                                 guint                            i)
 {
-        GList *i, *stream_list;
-        gboolean found_video = FALSE, found_audio = FALSE;;
-
-        stream_list = gst_discoverer_info_get_stream_list (info);
-
-        /* Check video and audio restrictions */
-        for (i = stream_list;
-             i && !(found_video && found_audio);
-             i = i->next) {
-                GstDiscovererStreamInfo *stream;
-                GType stream_type;
-                GstCaps *caps = NULL;
-
-                stream = GST_DISCOVERER_STREAM_INFO(i->data);
-                stream_type = G_TYPE_FROM_INSTANCE (stream);
-
-                if (!found_video &&
-                    stream_type == GST_TYPE_DISCOVERER_VIDEO_INFO) {
-                        caps = caps_from_video_stream_info (stream);
-                        if (match_profile (profile,
-                                           caps,
-                                           GST_TYPE_ENCODING_VIDEO_PROFILE))
-                                found_video = TRUE;
-                        else
-                                gupnp_dlna_debug ("  Video did not match");
-                } else if (!found_audio &&
-                           stream_type == GST_TYPE_DISCOVERER_AUDIO_INFO) {
-                        caps = caps_from_audio_stream_info (stream);
-                        if (match_profile (profile,
-                                           caps,
-                                           GST_TYPE_ENCODING_AUDIO_PROFILE))
-                                found_audio = TRUE;
-                        else
-                                gupnp_dlna_debug ("  Audio did not match");
-                }
+        guint8 flags = profiles->flags[i];
+        GUPnPDLNATranscodeFlags ret = GUPNP_DLNA_TRANSCODE_NONE;
 
-                if (caps)
-                        gst_caps_unref (caps);
-        }
+        g_return_val_if_fail (i < profiles->n_profiles,
+                              GUPNP_DLNA_TRANSCODE_IMPOSSIBLE);
 
-        gst_discoverer_stream_info_list_free (stream_list);
+        debug_init ();
 
-        if (!found_video || !found_audio)
-                return FALSE;
+        GST_LOG ("Checking transcoding to DLNA profile %s", profiles->names[i]);
 
-        /* Check container restrictions */
-        if (!check_container (info, profile)) {
-                gupnp_dlna_debug ("  Container did not match");
-                return FALSE;
+        if (!(flags & GUPNP_DLNA_PROFILE_TABLE_MATCHABLE) ||
+            profile_is_image (profiles, i) != desc->is_image ||
+            !(flags & GUPNP_DLNA_PROFILE_TABLE_VIDEO) != !desc->video)
+                return GUPNP_DLNA_TRANSCODE_IMPOSSIBLE;
+
+        if (desc->is_image) {
+                GList image = { desc->video->data, NULL, NULL };
+
+                if (!match_any_stream (&image,
+                                       profiles,
+                                       i,
+                                       "image",
+                                       profiles->video_offsets[i],
+                                       profiles->audio_offsets[i],
+                                       NULL))
+                        ret |= GUPNP_DLNA_TRANSCODE_VIDEO;
+
+                return ret;
         }
 
-        return TRUE;
-}
+        if (desc->video && !match_video (desc, profiles, i, NULL))
+                ret |= GUPNP_DLNA_TRANSCODE_VIDEO;
 
-static void
-guess_video_profile (GstDiscovererInfo *info,
-                     gchar             **name,
-                     gchar             **mime,
-                     GList             *profiles)
-{
-        GUPnPDLNAProfile *profile = NULL;
-        GstEncodingProfile *enc_profile;
-        GList *i;
+        if (profiles->audio_offsets[i] < profiles->video_offsets[i + 1]) {
+                if (!desc->audio)
+                        return GUPNP_DLNA_TRANSCODE_IMPOSSIBLE;
 
-        for (i = profiles; i; i = i->next) {
-                profile = (GUPnPDLNAProfile *)(i->data);
-                enc_profile = gupnp_dlna_profile_get_encoding_profile (profile);
+                if (!match_audio (desc, profiles, i, NULL))
+                        ret |= GUPNP_DLNA_TRANSCODE_AUDIO;
+        } else if (desc->audio)
+                ret |= GUPNP_DLNA_TRANSCODE_AUDIO;
 
-                gupnp_dlna_debug ("Checking DLNA profile %s",
-                                  gupnp_dlna_profile_get_name (profile));
-                if (check_video_profile (info, enc_profile)) {
-                        *name = g_strdup (gupnp_dlna_profile_get_name (profile));
-                        *mime = g_strdup (gupnp_dlna_profile_get_mime (profile));
-                        break;
-                }
-        }
+        if (!check_container (desc, profiles, i, NULL))
+                ret |= GUPNP_DLNA_TRANSCODE_TRANSMUX;
+
+        return ret;
 }
 
-static void
-guess_image_profile (GstDiscovererStreamInfo *info,
-                     gchar                   **name,
-                     gchar                   **mime,
-                     GList                   *profiles)
+/*
+ * Whether @caps, one of the video (or, if @video is FALSE, audio) streams of
+ * a description, already fits profile i of @profiles as it is, and so can be
+ * passed through when transcoding to it. Nothing is recorded in the
+ * statistics.
+ */
+gboolean
+gupnp_dlna_stream_description_stream_fits
+                                (GstCaps                     *caps,
+                                 const GUPnPDLNAProfileTable *profiles,
+                                 guint                       i,
+                                 gboolean                    video)
 {
-        GstCaps *caps;
-        GList *i;
-        gboolean found = FALSE;
-        GUPnPDLNAProfile *profile;
-        GstEncodingProfile *enc_profile;
-        const GstDiscovererVideoInfo *video_info =
-                GST_DISCOVERER_VIDEO_INFO (info);
+        GList stream = { caps, NULL, NULL };
+
+        g_return_val_if_fail (i < profiles->n_profiles, FALSE);
+
+        debug_init ();
+
+        if (video)
+                return match_any_stream (&stream,
+                                         profiles,
+                                         i,
+                                         "video",
+                                         profiles->video_offsets[i],
+                                         profiles->audio_offsets[i],
+                                         NULL);
+
+        return match_any_stream (&stream,
+                                 profiles,
+                                 i,
+                                 "audio",
+                                 profiles->audio_offsets[i],
+                                 profiles->video_offsets[i + 1],
+                                 NULL);
+}
 
-        if (!info || !gst_discoverer_video_info_is_image (video_info))
-                return;
+/* stats, if not NULL, is updated with the profiles that were checked and
+ * the time taken. Returns the time taken. */
+GstClockTime
+gupnp_dlna_stream_description_guess_profile
+                                (const GUPnPDLNAStreamDescription *desc,
+                                 const GUPnPDLNAProfileTable      *profiles,
+                                 GUPnPDLNAMatchStats              *stats,
+                                 gchar                            **name,
+                                 gchar                            **mime)
+{
+        GstClockTime start, elapsed;
 
-        caps = caps_from_video_stream_info (info);
+        if (!profiles)
+                return 0;
 
-        for (i = profiles; !found && i; i = i->next) {
-                profile = (GUPnPDLNAProfile *)(i->data);
-                enc_profile = gupnp_dlna_profile_get_encoding_profile (profile);
+        debug_init ();
 
-                /* Optimisation TODO: this can be pre-computed */
-                if (!is_video_profile (enc_profile))
-                        continue;
+        start = gst_util_get_timestamp ();
 
-                if (match_profile (enc_profile,
-                                   caps,
-                                   GST_TYPE_ENCODING_VIDEO_PROFILE)) {
-                        /* Found a match */
-                        *name = g_strdup (gupnp_dlna_profile_get_name (profile));
-                        *mime = g_strdup (gupnp_dlna_profile_get_mime (profile));
-                        break;
-                }
+        if (desc->video) {
+                if (desc->is_image)
+                        guess_image_profile (desc, name, mime, profiles, stats);
+                else
+                        guess_video_profile (desc, name, mime, profiles, stats);
+        } else if (desc->audio)
+                guess_audio_profile (desc, name, mime, profiles, stats);
+
+        elapsed = gst_util_get_timestamp () - start;
+
+        if (stats) {
+                stats->match_time += elapsed;
+                stats->matches++;
+                if (*name)
+                        stats->matched++;
         }
 
-        gst_caps_unref (caps);
+        return elapsed;
 }
 
 GUPnPDLNAInformation *
-gupnp_dlna_information_new_from_discoverer_info (GstDiscovererInfo *info,
-                                                 GList             *profiles)
+gupnp_dlna_information_new_from_discoverer_info
+                                (GstDiscovererInfo           *info,
+                                 const GUPnPDLNAProfileTable *profiles,
+                                 GUPnPDLNAMatchStats         *stats,
+                                 gboolean                    keep_info)
 {
         GUPnPDLNAInformation *dlna;
-        GList *video_list, *audio_list;
+        GUPnPDLNAStreamDescription *desc;
+        GstStructure *summary;
+        GstClockTime match_time;
         gchar *name = NULL, *mime = NULL;
 
-        video_list = gst_discoverer_info_get_video_streams (info);
-        audio_list = gst_discoverer_info_get_audio_streams (info);
-        if (video_list) {
-                if ((g_list_length (video_list) ==1 ) &&
-                    gst_discoverer_video_info_is_image
-                                        (GST_DISCOVERER_VIDEO_INFO
-                                                  (video_list->data))) {
-                        GstDiscovererStreamInfo *stream;
-                        stream = (GstDiscovererStreamInfo *) video_list->data;
-                        guess_image_profile (stream, &name, &mime, profiles);
-                } else
-                        guess_video_profile (info, &name, &mime, profiles);
-        } else if (audio_list)
-                guess_audio_profile (info, &name, &mime, profiles);
-
-        gst_discoverer_stream_info_list_free (audio_list);
-        gst_discoverer_stream_info_list_free (video_list);
-
-        dlna = gupnp_dlna_information_new (name, mime, info);
-
-
+        /* The stream caps are gathered once here rather than for every
+         * profile that is checked */
+        desc = gupnp_dlna_stream_description_new_from_discoverer_info (info);
+        match_time = gupnp_dlna_stream_description_guess_profile (desc,
+                                                                  profiles,
+                                                                  stats,
+                                                                  &name,
+                                                                  &mime);
+        summary = gupnp_dlna_stream_description_summarize
+                                (desc,
+                                 gst_discoverer_info_get_uri (info),
+                                 gst_discoverer_info_get_duration (info),
+                                 match_time);
+        gupnp_dlna_stream_description_free (desc);
+
+        dlna = g_object_new (GUPNP_TYPE_DLNA_INFORMATION,
+                             "name", name,
+                             "mime", mime,
+                             "info", keep_info ? info : NULL,
+                             "summary", summary,
+                             NULL);
+
+        gst_structure_free (summary);
         g_free (name);
         g_free (mime);
 
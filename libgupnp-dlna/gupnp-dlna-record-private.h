@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#ifndef __GUPNP_DLNA_RECORD_PRIVATE_H__
+#define __GUPNP_DLNA_RECORD_PRIVATE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Appends @str to @json as a quoted and escaped JSON string */
+void gupnp_dlna_json_append_string (GString *json, const gchar *str);
+
+G_END_DECLS
+
+#endif /* __GUPNP_DLNA_RECORD_PRIVATE_H__ */
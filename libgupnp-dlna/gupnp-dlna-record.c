@@ -0,0 +1,618 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include "gupnp-dlna-record.h"
+#include "gupnp-dlna-record-private.h"
+
+/**
+ * SECTION:gupnp-dlna-record
+ * @short_description: Serialisation of #GUPnPDLNAInformation
+ *
+ * A #GUPnPDLNAInformation can be turned into a compact binary record with
+ * gupnp_dlna_information_to_record(), so that it can be handed over to
+ * another process or kept in a cache file instead of being discovered again.
+ * A record holds the DLNA profile name and MIME type, and the fields of the
+ * summary returned by gupnp_dlna_information_get_summary().
+ *
+ * Records are read in place: gupnp_dlna_record_from_data() only checks that
+ * a record in a buffer (a mapped file, for instance) is well-formed, and the
+ * gupnp_dlna_record_get_*() accessors then read each field straight from the
+ * buffer. A #GUPnPDLNAInformation is only built again if asked for with
+ * gupnp_dlna_record_to_information(). Records are padded to a multiple of 8
+ * bytes, so several of them can simply be written one after the other.
+ *
+ * Records are stored in little-endian byte order and carry a version number.
+ * Records written with a different version of the format are rejected.
+ *
+ * The same fields can also be written out as a JSON object with
+ * gupnp_dlna_information_to_json() or gupnp_dlna_record_to_json().
+ */
+
+#define RECORD_VERSION 1
+#define RECORD_ALIGN 8
+
+enum {
+        RECORD_NAME,
+        RECORD_MIME,
+        RECORD_URI,
+        RECORD_CONTAINER_FORMAT,
+        RECORD_VIDEO_FORMAT,
+        RECORD_AUDIO_FORMAT,
+        RECORD_STRING_LAST
+};
+
+enum {
+        RECORD_WIDTH,
+        RECORD_HEIGHT,
+        RECORD_FRAMERATE_NUM,
+        RECORD_FRAMERATE_DENOM,
+        RECORD_VIDEO_BITRATE,
+        RECORD_RATE,
+        RECORD_CHANNELS,
+        RECORD_AUDIO_BITRATE,
+        RECORD_INT_LAST
+};
+
+/* All fields are little-endian. Integer fields are 0 when unknown, string
+ * offsets (from the start of the record) are 0 for missing strings, and
+ * strings are NUL-terminated. */
+struct _GUPnPDLNARecord {
+        guint8  magic[4];
+        guint16 version;
+        guint16 header_size;
+        guint32 size;
+        guint32 reserved;
+        guint64 duration;
+        gint32  ints[RECORD_INT_LAST];
+        guint32 strings[RECORD_STRING_LAST];
+};
+
+static const guint8 record_magic[4] = { 'G', 'D', 'L', 'R' };
+
+/* Summary field names, in the order of the RECORD_* enums */
+static const gchar *string_fields[RECORD_STRING_LAST] = {
+        NULL, NULL, "uri", "container-format", "video-format", "audio-format"
+};
+
+static const gchar *int_fields[RECORD_INT_LAST] = {
+        "width", "height", NULL, NULL, "video-bitrate",
+        "rate", "channels", "audio-bitrate"
+};
+
+static gint
+summary_get_int (const GstStructure *summary, const gchar *field)
+{
+        const GValue *value;
+
+        value = gst_structure_get_value (summary, field);
+        if (!value)
+                return 0;
+
+        if (G_VALUE_HOLDS_INT (value))
+                return g_value_get_int (value);
+        else if (G_VALUE_HOLDS_UINT (value))
+                return (gint) MIN (g_value_get_uint (value), G_MAXINT);
+
+        return 0;
+}
+
+/**
+ * gupnp_dlna_information_to_record:
+ * @self: The #GUPnPDLNAInformation object
+ * @size: (out): return location for the size of the record, in bytes
+ *
+ * Serialises @self into a binary record that can be read back with
+ * gupnp_dlna_record_from_data().
+ *
+ * Returns: (transfer full): the record. Free it with g_free().
+ */
+gpointer
+gupnp_dlna_information_to_record (GUPnPDLNAInformation *self,
+                                  gsize                *size)
+{
+        const GstDiscovererInfo *info;
+        const GstStructure *summary;
+        const gchar *strings[RECORD_STRING_LAST] = { NULL, };
+        GUPnPDLNARecord *record;
+        GstClockTime duration;
+        gsize offset, total;
+        gint ints[RECORD_INT_LAST] = { 0, };
+        guint i;
+
+        g_return_val_if_fail (GUPNP_IS_DLNA_INFORMATION (self), NULL);
+        g_return_val_if_fail (size != NULL, NULL);
+
+        info = gupnp_dlna_information_get_info (self);
+        summary = gupnp_dlna_information_get_summary (self);
+
+        strings[RECORD_NAME] = gupnp_dlna_information_get_name (self);
+        strings[RECORD_MIME] = gupnp_dlna_information_get_mime (self);
+
+        if (summary) {
+                for (i = 0; i < RECORD_STRING_LAST; i++)
+                        if (string_fields[i] &&
+                            gst_structure_has_field (summary,
+                                                     string_fields[i]))
+                                strings[i] = gst_structure_get_string
+                                                (summary, string_fields[i]);
+
+                for (i = 0; i < RECORD_INT_LAST; i++)
+                        if (int_fields[i])
+                                ints[i] = summary_get_int (summary,
+                                                           int_fields[i]);
+
+                gst_structure_get_fraction (summary,
+                                            "framerate",
+                                            &ints[RECORD_FRAMERATE_NUM],
+                                            &ints[RECORD_FRAMERATE_DENOM]);
+        } else if (info)
+                strings[RECORD_URI] = gst_discoverer_info_get_uri
+                                        ((GstDiscovererInfo *) info);
+
+        duration = gupnp_dlna_information_get_duration (self);
+
+        total = sizeof (GUPnPDLNARecord);
+        for (i = 0; i < RECORD_STRING_LAST; i++)
+                if (strings[i])
+                        total += strlen (strings[i]) + 1;
+        total = (total + RECORD_ALIGN - 1) & ~((gsize) RECORD_ALIGN - 1);
+
+        record = g_malloc0 (total);
+        memcpy (record->magic, record_magic, sizeof (record_magic));
+        record->version = GUINT16_TO_LE (RECORD_VERSION);
+        record->header_size = GUINT16_TO_LE (sizeof (GUPnPDLNARecord));
+        record->size = GUINT32_TO_LE (total);
+        record->duration = GUINT64_TO_LE (duration);
+
+        for (i = 0; i < RECORD_INT_LAST; i++)
+                record->ints[i] = GINT32_TO_LE (ints[i]);
+
+        offset = sizeof (GUPnPDLNARecord);
+        for (i = 0; i < RECORD_STRING_LAST; i++) {
+                gsize len;
+
+                if (!strings[i])
+                        continue;
+
+                len = strlen (strings[i]) + 1;
+                memcpy ((guint8 *) record + offset, strings[i], len);
+                record->strings[i] = GUINT32_TO_LE (offset);
+                offset += len;
+        }
+
+        *size = total;
+
+        return record;
+}
+
+/**
+ * gupnp_dlna_record_from_data:
+ * @data: a buffer starting with a record
+ * @size: the number of bytes available in @data
+ * @record_size: (out) (allow-none): return location for the size of the
+ *               record, which is where the next record in @data starts
+ *
+ * Checks that @data starts with a well-formed record of the version of the
+ * format known to this library. @data is not copied, and must stay around
+ * (and unchanged) for as long as the returned record is used. It must be
+ * 8-byte aligned.
+ *
+ * Returns: (transfer none): the record at the start of @data, or NULL if
+ *          there is no valid record there or @data is not aligned.
+ */
+const GUPnPDLNARecord *
+gupnp_dlna_record_from_data (gconstpointer data,
+                             gsize         size,
+                             gsize         *record_size)
+{
+        const GUPnPDLNARecord *record = data;
+        const guint8 *bytes = data;
+        guint32 total;
+        guint i;
+
+        g_return_val_if_fail (data != NULL || size == 0, NULL);
+
+        /* The fields are read in place */
+        if ((gsize) data % RECORD_ALIGN ||
+            size < sizeof (GUPnPDLNARecord) ||
+            memcmp (record->magic, record_magic, sizeof (record_magic)) ||
+            GUINT16_FROM_LE (record->version) != RECORD_VERSION ||
+            GUINT16_FROM_LE (record->header_size) != sizeof (GUPnPDLNARecord))
+                return NULL;
+
+        total = GUINT32_FROM_LE (record->size);
+        if (total < sizeof (GUPnPDLNARecord) ||
+            total > size ||
+            total % RECORD_ALIGN)
+                return NULL;
+
+        for (i = 0; i < RECORD_STRING_LAST; i++) {
+                guint32 offset = GUINT32_FROM_LE (record->strings[i]);
+
+                if (offset == 0)
+                        continue;
+
+                if (offset < sizeof (GUPnPDLNARecord) ||
+                    offset >= total ||
+                    !memchr (bytes + offset, '\0', total - offset))
+                        return NULL;
+        }
+
+        if (record_size)
+                *record_size = total;
+
+        return record;
+}
+
+static const gchar *
+record_get_string (const GUPnPDLNARecord *record, guint field)
+{
+        guint32 offset = GUINT32_FROM_LE (record->strings[field]);
+
+        if (offset == 0)
+                return NULL;
+
+        return (const gchar *) record + offset;
+}
+
+static gint
+record_get_int (const GUPnPDLNARecord *record, guint field)
+{
+        return GINT32_FROM_LE (record->ints[field]);
+}
+
+/**
+ * gupnp_dlna_record_get_name:
+ * @record: a #GUPnPDLNARecord
+ *
+ * Returns: the DLNA profile name of @record, or NULL. The string points into
+ *          the buffer holding @record.
+ */
+const gchar *
+gupnp_dlna_record_get_name (const GUPnPDLNARecord *record)
+{
+        return record_get_string (record, RECORD_NAME);
+}
+
+/**
+ * gupnp_dlna_record_get_mime:
+ * @record: a #GUPnPDLNARecord
+ *
+ * Returns: the DLNA MIME type of @record, or NULL. The string points into
+ *          the buffer holding @record.
+ */
+const gchar *
+gupnp_dlna_record_get_mime (const GUPnPDLNARecord *record)
+{
+        return record_get_string (record, RECORD_MIME);
+}
+
+/**
+ * gupnp_dlna_record_get_uri:
+ * @record: a #GUPnPDLNARecord
+ *
+ * Returns: the URI of the stream described by @record, or NULL. The string
+ *          points into the buffer holding @record.
+ */
+const gchar *
+gupnp_dlna_record_get_uri (const GUPnPDLNARecord *record)
+{
+        return record_get_string (record, RECORD_URI);
+}
+
+/**
+ * gupnp_dlna_record_get_duration:
+ * @record: a #GUPnPDLNARecord
+ *
+ * Returns: the duration of the stream described by @record, or
+ *          #GST_CLOCK_TIME_NONE if it is not known.
+ */
+GstClockTime
+gupnp_dlna_record_get_duration (const GUPnPDLNARecord *record)
+{
+        return GUINT64_FROM_LE (record->duration);
+}
+
+/**
+ * gupnp_dlna_record_get_container_format:
+ * @record: a #GUPnPDLNARecord
+ *
+ * Returns: the media type of the container of the stream described by
+ *          @record, or NULL.
+ */
+const gchar *
+gupnp_dlna_record_get_container_format (const GUPnPDLNARecord *record)
+{
+        return record_get_string (record, RECORD_CONTAINER_FORMAT);
+}
+
+/**
+ * gupnp_dlna_record_get_video_format:
+ * @record: a #GUPnPDLNARecord
+ *
+ * Returns: the media type of the first video stream (or image) described by
+ *          @record, or NULL.
+ */
+const gchar *
+gupnp_dlna_record_get_video_format (const GUPnPDLNARecord *record)
+{
+        return record_get_string (record, RECORD_VIDEO_FORMAT);
+}
+
+/**
+ * gupnp_dlna_record_get_audio_format:
+ * @record: a #GUPnPDLNARecord
+ *
+ * Returns: the media type of the first audio stream described by @record,
+ *          or NULL.
+ */
+const gchar *
+gupnp_dlna_record_get_audio_format (const GUPnPDLNARecord *record)
+{
+        return record_get_string (record, RECORD_AUDIO_FORMAT);
+}
+
+/**
+ * gupnp_dlna_record_get_width:
+ * @record: a #GUPnPDLNARecord
+ *
+ * Returns: the width of the first video stream described by @record, or 0.
+ */
+gint
+gupnp_dlna_record_get_width (const GUPnPDLNARecord *record)
+{
+        return record_get_int (record, RECORD_WIDTH);
+}
+
+/**
+ * gupnp_dlna_record_get_height:
+ * @record: a #GUPnPDLNARecord
+ *
+ * Returns: the height of the first video stream described by @record, or 0.
+ */
+gint
+gupnp_dlna_record_get_height (const GUPnPDLNARecord *record)
+{
+        return record_get_int (record, RECORD_HEIGHT);
+}
+
+/**
+ * gupnp_dlna_record_get_rate:
+ * @record: a #GUPnPDLNARecord
+ *
+ * Returns: the sample rate of the first audio stream described by @record,
+ *          or 0.
+ */
+gint
+gupnp_dlna_record_get_rate (const GUPnPDLNARecord *record)
+{
+        return record_get_int (record, RECORD_RATE);
+}
+
+/**
+ * gupnp_dlna_record_get_channels:
+ * @record: a #GUPnPDLNARecord
+ *
+ * Returns: the number of channels of the first audio stream described by
+ *          @record, or 0.
+ */
+gint
+gupnp_dlna_record_get_channels (const GUPnPDLNARecord *record)
+{
+        return record_get_int (record, RECORD_CHANNELS);
+}
+
+/**
+ * gupnp_dlna_record_to_information:
+ * @record: a #GUPnPDLNARecord
+ *
+ * Builds a #GUPnPDLNAInformation holding the contents of @record. It has a
+ * summary, but no #GstDiscovererInfo.
+ *
+ * Returns: (transfer full): a new #GUPnPDLNAInformation.
+ */
+GUPnPDLNAInformation *
+gupnp_dlna_record_to_information (const GUPnPDLNARecord *record)
+{
+        GUPnPDLNAInformation *dlna;
+        GstStructure *summary;
+        GstClockTime duration;
+        guint i;
+
+        g_return_val_if_fail (record != NULL, NULL);
+
+        summary = gst_structure_empty_new ("gupnp-dlna-summary");
+
+        for (i = 0; i < RECORD_STRING_LAST; i++) {
+                const gchar *value = record_get_string (record, i);
+
+                if (string_fields[i] && value)
+                        gst_structure_set (summary,
+                                           string_fields[i],
+                                           G_TYPE_STRING,
+                                           value,
+                                           NULL);
+        }
+
+        duration = gupnp_dlna_record_get_duration (record);
+        if (GST_CLOCK_TIME_IS_VALID (duration))
+                gst_structure_set (summary,
+                                   "duration", G_TYPE_UINT64, duration,
+                                   NULL);
+
+        for (i = 0; i < RECORD_INT_LAST; i++) {
+                gint value = record_get_int (record, i);
+
+                if (int_fields[i] && value)
+                        gst_structure_set (summary,
+                                           int_fields[i],
+                                           G_TYPE_INT,
+                                           value,
+                                           NULL);
+        }
+
+        if (record_get_int (record, RECORD_FRAMERATE_DENOM))
+                gst_structure_set (summary,
+                                   "framerate",
+                                   GST_TYPE_FRACTION,
+                                   record_get_int (record,
+                                                   RECORD_FRAMERATE_NUM),
+                                   record_get_int (record,
+                                                   RECORD_FRAMERATE_DENOM),
+                                   NULL);
+
+        dlna = g_object_new (GUPNP_TYPE_DLNA_INFORMATION,
+                             "name", gupnp_dlna_record_get_name (record),
+                             "mime", gupnp_dlna_record_get_mime (record),
+                             "summary", summary,
+                             NULL);
+
+        gst_structure_free (summary);
+
+        return dlna;
+}
+
+void
+gupnp_dlna_json_append_string (GString *json, const gchar *str)
+{
+        const gchar *p;
+
+        g_string_append_c (json, '"');
+
+        for (p = str; *p; p++) {
+                guchar c = *p;
+
+                if (c == '"' || c == '\\')
+                        g_string_append_printf (json, "\\%c", c);
+                else if (c < 0x20)
+                        g_string_append_printf (json, "\\u%04x", c);
+                else
+                        g_string_append_c (json, c);
+        }
+
+        g_string_append_c (json, '"');
+}
+
+static void
+json_append_key (GString *json, const gchar *key)
+{
+        g_string_append (json, json->len > 1 ? ", " : "");
+        gupnp_dlna_json_append_string (json, key);
+        g_string_append (json, ": ");
+}
+
+/**
+ * gupnp_dlna_record_to_json:
+ * @record: a #GUPnPDLNARecord
+ *
+ * Writes out the contents of @record as a JSON object. The object has a
+ * "name" and "mime" member for the DLNA profile, a "duration" member in
+ * nanoseconds, a "framerate" member as a "num/denom" string, and members
+ * named after the other summary fields. Unknown fields are left out.
+ *
+ * Returns: (transfer full): the JSON object. Free it with g_free().
+ */
+gchar *
+gupnp_dlna_record_to_json (const GUPnPDLNARecord *record)
+{
+        GString *json;
+        GstClockTime duration;
+        guint i;
+
+        g_return_val_if_fail (record != NULL, NULL);
+
+        json = g_string_new ("{");
+
+        for (i = 0; i < RECORD_STRING_LAST; i++) {
+                const gchar *value = record_get_string (record, i);
+
+                if (!value)
+                        continue;
+
+                if (i == RECORD_NAME)
+                        json_append_key (json, "name");
+                else if (i == RECORD_MIME)
+                        json_append_key (json, "mime");
+                else
+                        json_append_key (json, string_fields[i]);
+
+                gupnp_dlna_json_append_string (json, value);
+        }
+
+        duration = gupnp_dlna_record_get_duration (record);
+        if (GST_CLOCK_TIME_IS_VALID (duration)) {
+                json_append_key (json, "duration");
+                g_string_append_printf (json,
+                                        "%" G_GUINT64_FORMAT,
+                                        duration);
+        }
+
+        for (i = 0; i < RECORD_INT_LAST; i++) {
+                gint value = record_get_int (record, i);
+
+                if (!int_fields[i] || !value)
+                        continue;
+
+                json_append_key (json, int_fields[i]);
+                g_string_append_printf (json, "%d", value);
+        }
+
+        if (record_get_int (record, RECORD_FRAMERATE_DENOM)) {
+                json_append_key (json, "framerate");
+                g_string_append_printf (json,
+                                        "\"%d/%d\"",
+                                        record_get_int
+                                                (record,
+                                                 RECORD_FRAMERATE_NUM),
+                                        record_get_int
+                                                (record,
+                                                 RECORD_FRAMERATE_DENOM));
+        }
+
+        g_string_append_c (json, '}');
+
+        return g_string_free (json, FALSE);
+}
+
+/**
+ * gupnp_dlna_information_to_json:
+ * @self: The #GUPnPDLNAInformation object
+ *
+ * Writes out the fields that gupnp_dlna_information_to_record() would
+ * serialise as a JSON object, see gupnp_dlna_record_to_json().
+ *
+ * Returns: (transfer full): the JSON object. Free it with g_free().
+ */
+gchar *
+gupnp_dlna_information_to_json (GUPnPDLNAInformation *self)
+{
+        gpointer data;
+        gsize size;
+        gchar *json;
+
+        g_return_val_if_fail (GUPNP_IS_DLNA_INFORMATION (self), NULL);
+
+        data = gupnp_dlna_information_to_record (self, &size);
+        json = gupnp_dlna_record_to_json
+                        (gupnp_dlna_record_from_data (data, size, NULL));
+        g_free (data);
+
+        return json;
+}
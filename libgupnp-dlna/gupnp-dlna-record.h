@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GUPNP_DLNA_RECORD_H__
+#define __GUPNP_DLNA_RECORD_H__
+
+#include <glib.h>
+#include "gupnp-dlna-information.h"
+
+G_BEGIN_DECLS
+
+/**
+ * GUPnPDLNARecord:
+ *
+ * A serialised #GUPnPDLNAInformation, read in place from the buffer that
+ * holds it.
+ */
+typedef struct _GUPnPDLNARecord GUPnPDLNARecord;
+
+gpointer
+gupnp_dlna_information_to_record (GUPnPDLNAInformation *self,
+                                  gsize                *size);
+
+gchar *
+gupnp_dlna_information_to_json (GUPnPDLNAInformation *self);
+
+const GUPnPDLNARecord *
+gupnp_dlna_record_from_data (gconstpointer data,
+                             gsize         size,
+                             gsize         *record_size);
+
+GUPnPDLNAInformation *
+gupnp_dlna_record_to_information (const GUPnPDLNARecord *record);
+
+gchar *
+gupnp_dlna_record_to_json (const GUPnPDLNARecord *record);
+
+const gchar *
+gupnp_dlna_record_get_name (const GUPnPDLNARecord *record);
+
+const gchar *
+gupnp_dlna_record_get_mime (const GUPnPDLNARecord *record);
+
+const gchar *
+gupnp_dlna_record_get_uri (const GUPnPDLNARecord *record);
+
+GstClockTime
+gupnp_dlna_record_get_duration (const GUPnPDLNARecord *record);
+
+const gchar *
+gupnp_dlna_record_get_container_format (const GUPnPDLNARecord *record);
+
+const gchar *
+gupnp_dlna_record_get_video_format (const GUPnPDLNARecord *record);
+
+const gchar *
+gupnp_dlna_record_get_audio_format (const GUPnPDLNARecord *record);
+
+gint
+gupnp_dlna_record_get_width (const GUPnPDLNARecord *record);
+
+gint
+gupnp_dlna_record_get_height (const GUPnPDLNARecord *record);
+
+gint
+gupnp_dlna_record_get_rate (const GUPnPDLNARecord *record);
+
+gint
+gupnp_dlna_record_get_channels (const GUPnPDLNARecord *record);
+
+G_END_DECLS
+
+#endif /* __GUPNP_DLNA_RECORD_H__ */
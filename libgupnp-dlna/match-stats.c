@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "match-stats.h"
+
+typedef struct {
+        guint      evaluations;
+        guint      matches;
+        GHashTable *rejections;  /* "stage.field" -> count */
+} ProfileStats;
+
+static void
+profile_stats_free (ProfileStats *profile)
+{
+        g_hash_table_unref (profile->rejections);
+        g_slice_free (ProfileStats, profile);
+}
+
+static ProfileStats *
+get_profile_stats (GUPnPDLNAMatchStats *stats, const gchar *name)
+{
+        ProfileStats *profile;
+
+        profile = g_hash_table_lookup (stats->profiles, name);
+        if (!profile) {
+                profile = g_slice_new0 (ProfileStats);
+                profile->rejections = g_hash_table_new_full (g_str_hash,
+                                                             g_str_equal,
+                                                             g_free,
+                                                             NULL);
+                g_hash_table_insert (stats->profiles,
+                                     g_strdup (name),
+                                     profile);
+        }
+
+        return profile;
+}
+
+GUPnPDLNAMatchStats *
+gupnp_dlna_match_stats_new (void)
+{
+        GUPnPDLNAMatchStats *stats;
+
+        stats = g_slice_new0 (GUPnPDLNAMatchStats);
+        stats->profiles = g_hash_table_new_full (g_str_hash,
+                                                 g_str_equal,
+                                                 g_free,
+                                                 (GDestroyNotify)
+                                                 profile_stats_free);
+
+        return stats;
+}
+
+void
+gupnp_dlna_match_stats_free (GUPnPDLNAMatchStats *stats)
+{
+        g_hash_table_unref (stats->profiles);
+        g_slice_free (GUPnPDLNAMatchStats, stats);
+}
+
+void
+gupnp_dlna_match_stats_evaluated (GUPnPDLNAMatchStats *stats,
+                                  const gchar         *profile)
+{
+        get_profile_stats (stats, profile)->evaluations++;
+}
+
+void
+gupnp_dlna_match_stats_rejected (GUPnPDLNAMatchStats *stats,
+                                 const gchar         *profile,
+                                 const gchar         *stage,
+                                 const gchar         *field)
+{
+        ProfileStats *profile_stats = get_profile_stats (stats, profile);
+        gchar *key;
+        guint count;
+
+        key = g_strconcat (stage, ".", field, NULL);
+        count = GPOINTER_TO_UINT (g_hash_table_lookup
+                                        (profile_stats->rejections, key));
+
+        /* Takes ownership of key, or frees it if it was already there */
+        g_hash_table_insert (profile_stats->rejections,
+                             key,
+                             GUINT_TO_POINTER (count + 1));
+}
+
+void
+gupnp_dlna_match_stats_matched (GUPnPDLNAMatchStats *stats,
+                                const gchar         *profile)
+{
+        get_profile_stats (stats, profile)->matches++;
+}
+
+static void
+add_rejection (const gchar *key, gpointer count, GstStructure *st)
+{
+        gst_structure_set (st,
+                           key, G_TYPE_UINT, GPOINTER_TO_UINT (count),
+                           NULL);
+}
+
+/* The "match-stats" structure comes first, followed by one "profile-stats"
+ * structure per profile, sorted by name */
+GList *
+gupnp_dlna_match_stats_to_structures (const GUPnPDLNAMatchStats *stats)
+{
+        GList *ret = NULL, *names, *l;
+
+        names = g_hash_table_get_keys (stats->profiles);
+        names = g_list_sort (names, (GCompareFunc) g_strcmp0);
+
+        for (l = names; l; l = l->next) {
+                const ProfileStats *profile;
+                GstStructure *st;
+
+                profile = g_hash_table_lookup (stats->profiles, l->data);
+                st = gst_structure_new ("profile-stats",
+                                        "name", G_TYPE_STRING, l->data,
+                                        "evaluations", G_TYPE_UINT,
+                                        profile->evaluations,
+                                        "matches", G_TYPE_UINT,
+                                        profile->matches,
+                                        NULL);
+                g_hash_table_foreach (profile->rejections,
+                                      (GHFunc) add_rejection,
+                                      st);
+
+                ret = g_list_prepend (ret, st);
+        }
+
+        g_list_free (names);
+
+        ret = g_list_reverse (ret);
+
+        return g_list_prepend (ret,
+                               gst_structure_new
+                                ("match-stats",
+                                 "discoveries", G_TYPE_UINT,
+                                 stats->discoveries,
+                                 "discovery-time", G_TYPE_UINT64,
+                                 stats->discovery_time,
+                                 "matches", G_TYPE_UINT, stats->matches,
+                                 "matched", G_TYPE_UINT, stats->matched,
+                                 "match-time", G_TYPE_UINT64,
+                                 stats->match_time,
+                                 NULL));
+}
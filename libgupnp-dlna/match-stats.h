@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GUPNP_DLNA_MATCH_STATS_H__
+#define __GUPNP_DLNA_MATCH_STATS_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Counters kept by a discoverer that collects statistics: how long the
+ * discovery and matching stages took, how often each profile was checked
+ * and matched, and which restriction fields rejected it. The counters are
+ * not locked, they belong to whoever runs the matching.
+ */
+
+typedef struct {
+        guint        discoveries;
+        GstClockTime discovery_time;
+        guint        matches;         /* files matched against profiles */
+        guint        matched;         /* of which got a profile */
+        GstClockTime match_time;
+
+        GHashTable   *profiles;       /* profile name -> ProfileStats */
+} GUPnPDLNAMatchStats;
+
+GUPnPDLNAMatchStats *
+gupnp_dlna_match_stats_new (void);
+
+void
+gupnp_dlna_match_stats_free (GUPnPDLNAMatchStats *stats);
+
+void
+gupnp_dlna_match_stats_evaluated (GUPnPDLNAMatchStats *stats,
+                                  const gchar         *profile);
+
+void
+gupnp_dlna_match_stats_rejected (GUPnPDLNAMatchStats *stats,
+                                 const gchar         *profile,
+                                 const gchar         *stage,
+                                 const gchar         *field);
+
+void
+gupnp_dlna_match_stats_matched (GUPnPDLNAMatchStats *stats,
+                                const gchar         *profile);
+
+GList *
+gupnp_dlna_match_stats_to_structures (const GUPnPDLNAMatchStats *stats);
+
+G_END_DECLS
+
+#endif /* __GUPNP_DLNA_MATCH_STATS_H__ */
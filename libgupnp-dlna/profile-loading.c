@@ -19,6 +19,7 @@
  * Boston, MA 02111-1307, USA.
  */
 
+#include <string.h>
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <glib-object.h>
@@ -166,6 +167,17 @@ free_restrictions_struct (gpointer data, gpointer user_data)
         }
 }
 
+static gboolean
+has_attribute (xmlTextReaderPtr reader, const char *name)
+{
+        xmlChar *value;
+
+        value = xmlTextReaderGetAttribute (reader, BAD_CAST (name));
+        xmlFree (value);
+
+        return value != NULL;
+}
+
 static void
 process_range (xmlTextReaderPtr reader, GString *caps_str)
 {
@@ -174,7 +186,10 @@ process_range (xmlTextReaderPtr reader, GString *caps_str)
         min = xmlTextReaderGetAttribute (reader, BAD_CAST ("min"));
         max = xmlTextReaderGetAttribute (reader, BAD_CAST ("max"));
 
-        g_string_append_printf (caps_str, "[ %s, %s ]", min, max);
+        if (min && max)
+                g_string_append_printf (caps_str, "[ %s, %s ]", min, max);
+        else
+                g_warning ("<range>s need both a min and a max");
 
         xmlFree (min);
         xmlFree (max);
@@ -213,6 +228,11 @@ process_field (xmlTextReaderPtr reader,
         name = xmlTextReaderGetAttribute (reader, BAD_CAST ("name"));
         type = xmlTextReaderGetAttribute (reader, BAD_CAST ("type"));
 
+        if (!skip && (!name || !type)) {
+                g_warning ("Ignoring <field> without a name or a type");
+                skip = TRUE;
+        }
+
         /*
          * This function reads a <field> and appends it to caps_str in the
          * GstCaps-as-a-string format:
@@ -328,10 +348,13 @@ process_parent (xmlTextReaderPtr reader, GUPnPDLNALoadState *data)
         }
 
         parent = xmlTextReaderGetAttribute (reader, BAD_CAST ("name"));
-        restr = g_hash_table_lookup (data->restrictions, parent);
+        if (parent)
+                restr = g_hash_table_lookup (data->restrictions, parent);
 
         if (!restr) {
                 g_warning ("Could not find parent restriction: %s", parent);
+                xmlFree (parent);
+                xmlFree (used);
                 return NULL;
         }
 
@@ -341,6 +364,8 @@ process_parent (xmlTextReaderPtr reader, GUPnPDLNALoadState *data)
         return restr;
 }
 
+/* Restrictions with an id belong to the restrictions table, the others to
+ * the caller */
 static GUPnPDLNARestrictions *
 process_restriction (xmlTextReaderPtr reader, GUPnPDLNALoadState *data)
 {
@@ -457,36 +482,41 @@ process_restriction (xmlTextReaderPtr reader, GUPnPDLNALoadState *data)
                 goto out;
         }
 
+        /* merge_caps () expects exactly one structure on each side */
         caps = gst_caps_from_string (caps_str->str);
-        g_string_free (caps_str, TRUE);
-        g_return_val_if_fail (caps != NULL, NULL);
+        if (!caps || gst_caps_get_size (caps) != 1) {
+                g_warning ("Invalid restriction: %s", caps_str->str);
+                goto out;
+        }
 
-        tmp = parents;
-        while (tmp) {
+        for (tmp = parents; tmp; tmp = tmp->next)
                 /* Merge all the parent caps. The child overrides parent
                  * attributes */
-                GstCaps *tmp_caps = (GstCaps *)tmp->data;
-                caps = merge_caps (caps, tmp_caps);
-                gst_caps_unref (tmp_caps);
-                tmp = tmp->next;
-        }
+                caps = merge_caps (caps, (GstCaps *) tmp->data);
 
         restr = g_new0 (GUPnPDLNARestrictions, 1);
 
         restr->caps = gst_caps_copy (caps);
         restr->type = type;
 
-        if (id)
+        if (id) {
+                /* id is freed when the hash table is destroyed */
                 g_hash_table_insert (data->restrictions, id, restr);
+                id = NULL;
+        }
 
 out:
+        g_string_free (caps_str, TRUE);
+        xmlFree (id);
         xmlFree (restr_type);
         if (used)
                 xmlFree (used);
         if (caps)
                 gst_caps_unref (caps);
-        if (parents)
+        if (parents) {
+                g_list_foreach (parents, (GFunc) gst_caps_unref, NULL);
                 g_list_free (parents);
+        }
 
         return restr;
 }
@@ -505,7 +535,14 @@ process_restrictions (xmlTextReaderPtr reader, GUPnPDLNALoadState *data)
                 case 1:
                         if (xmlStrEqual (tag, BAD_CAST ("restriction"))) {
                                 /* <restriction> */
-                                process_restriction (reader, data);
+                                gboolean anonymous =
+                                        !has_attribute (reader, "id");
+                                GUPnPDLNARestrictions *restr =
+                                        process_restriction (reader, data);
+
+                                /* Nothing can refer to it */
+                                if (anonymous)
+                                        free_restrictions_struct (restr, NULL);
                         }
 
                         break;
@@ -536,8 +573,8 @@ process_dlna_profile (xmlTextReaderPtr   reader,
         GUPnPDLNAProfile  *base = NULL;
         GUPnPDLNARestrictions *restr = NULL;
         GstCaps *temp_audio = NULL, *temp_video = NULL, *temp_container = NULL;
-        xmlChar *name, *mime, *id, *base_profile, *extended;
-        gboolean done = FALSE, is_extended = FALSE;
+        xmlChar *name, *mime, *id, *base_profile, *extended, *priority;
+        gboolean done = FALSE, is_extended = FALSE, anonymous;
 
         name = xmlTextReaderGetAttribute (reader, BAD_CAST ("name"));
         mime = xmlTextReaderGetAttribute (reader, BAD_CAST ("mime"));
@@ -545,6 +582,7 @@ process_dlna_profile (xmlTextReaderPtr   reader,
         id = xmlTextReaderGetAttribute (reader, BAD_CAST ("id"));
         base_profile = xmlTextReaderGetAttribute (reader,
                                                   BAD_CAST ("base-profile"));
+        priority = xmlTextReaderGetAttribute (reader, BAD_CAST ("priority"));
 
         /* Create temporary place-holders for caps */
         temp_container = gst_caps_new_empty ();
@@ -552,13 +590,21 @@ process_dlna_profile (xmlTextReaderPtr   reader,
         temp_audio = gst_caps_new_empty ();
 
         if (!name) {
-                g_assert (mime == NULL);
+                if (mime) {
+                        g_warning ("Ignoring the MIME type of a profile "
+                                   "without a name: %s",
+                                   mime);
+                        xmlFree (mime);
+                }
 
                 /* We need a non-NULL string to not trigger asserts in the
                  * places these are used. Profiles without names are used
                  * only for inheritance, not for actual matching. */
                 name = xmlStrdup (BAD_CAST (""));
                 mime = xmlStrdup (BAD_CAST (""));
+        } else if (!mime) {
+                g_warning ("Profile %s has no MIME type", name);
+                mime = xmlStrdup (BAD_CAST (""));
         }
 
         if (extended && xmlStrEqual (extended, BAD_CAST ("true"))) {
@@ -577,9 +623,13 @@ process_dlna_profile (xmlTextReaderPtr   reader,
 
                 switch (xmlTextReaderNodeType (reader)) {
                 case 1:
-                        if (xmlStrEqual (tag, BAD_CAST ("restriction")))
+                        restr = NULL;
+                        anonymous = FALSE;
+
+                        if (xmlStrEqual (tag, BAD_CAST ("restriction"))) {
+                                anonymous = !has_attribute (reader, "id");
                                 restr = process_restriction (reader, data);
-                        else if (xmlStrEqual (tag, BAD_CAST ("parent")))
+                        } else if (xmlStrEqual (tag, BAD_CAST ("parent")))
                                 restr = process_parent (reader, data);
 
                         if (!restr)
@@ -595,7 +645,12 @@ process_dlna_profile (xmlTextReaderPtr   reader,
                                 gst_caps_merge (temp_audio,
                                                 gst_caps_copy (restr->caps));
                         else
-                                g_assert_not_reached ();
+                                g_warning ("Ignoring restriction of unknown "
+                                           "type in profile %s",
+                                           name);
+
+                        if (anonymous)
+                                free_restrictions_struct (restr, NULL);
 
                         break;
 
@@ -626,6 +681,18 @@ process_dlna_profile (xmlTextReaderPtr   reader,
                                           GST_CAPS_NONE,
                                           is_extended);
 
+        /* The priority is inherited from the base profile unless given */
+        if (priority)
+                gupnp_dlna_profile_set_priority
+                                (profile,
+                                 (gint) g_ascii_strtoll ((gchar *) priority,
+                                                         NULL,
+                                                         10));
+        else if (base)
+                gupnp_dlna_profile_set_priority
+                                (profile,
+                                 gupnp_dlna_profile_get_priority (base));
+
         /* Inherit from base profile, if it exists*/
         if (base) {
                 const GstCaps *video_caps =
@@ -657,12 +724,15 @@ process_dlna_profile (xmlTextReaderPtr   reader,
         if (GST_IS_CAPS (temp_audio) && !gst_caps_is_empty (temp_audio))
                 gupnp_dlna_profile_set_audio_caps (profile, temp_audio);
 
-        *profiles = g_list_append (*profiles, profile);
+        /* The list is built in reverse and put back in order once the
+         * whole file is loaded */
+        *profiles = g_list_prepend (*profiles, profile);
 
         if (id) {
                 /* id is freed when the hash table is destroyed */
                 g_object_ref (profile);
                 g_hash_table_insert (data->profile_ids, id, profile);
+                id = NULL;
         }
 
 out:
@@ -674,12 +744,15 @@ out:
         if (temp_video)
                 gst_caps_unref (temp_video);
 
+        xmlFree (id);
         xmlFree (mime);
         xmlFree (name);
         if (extended)
                 xmlFree (extended);
         if (base_profile)
                 xmlFree (base_profile);
+        if (priority)
+                xmlFree (priority);
 
         return ret;
 }
@@ -691,6 +764,10 @@ process_include (xmlTextReaderPtr reader, GUPnPDLNALoadState *data)
         GList *ret;
 
         path = xmlTextReaderGetAttribute (reader, BAD_CAST ("ref"));
+        if (!path) {
+                g_warning ("Ignoring <include> without a ref");
+                return NULL;
+        }
 
         if (!g_path_is_absolute ((gchar *) path)) {
                 gchar *tmp = g_strconcat (DLNA_DATA_DIR,
@@ -791,8 +868,9 @@ gupnp_dlna_load_profiles_from_file (const char         *file_name,
                                         GList *include =
                                                 process_include (reader,
                                                                  data);
-                                        profiles = g_list_concat (profiles,
-                                                                  include);
+                                        profiles = g_list_concat
+                                                (g_list_reverse (include),
+                                                 profiles);
                                 } else if (xmlStrEqual (tag,
                                         BAD_CAST ("restrictions"))) {
                                         /* <restrictions> */
@@ -824,9 +902,25 @@ gupnp_dlna_load_profiles_from_file (const char         *file_name,
 out:
         g_free (path);
 
-        return profiles;
+        return g_list_reverse (profiles);
 }
 
+static gint
+compare_priorities (gconstpointer a, gconstpointer b)
+{
+        gint priority_a = gupnp_dlna_profile_get_priority
+                                        ((GUPnPDLNAProfile *) a);
+        gint priority_b = gupnp_dlna_profile_get_priority
+                                        ((GUPnPDLNAProfile *) b);
+
+        return (priority_a < priority_b) - (priority_a > priority_b);
+}
+
+/* Matching stops at the first profile that fits, so the order of the list
+ * decides between overlapping profiles. Files are loaded in name order
+ * rather than in whatever order the file system lists them, and the result
+ * is then sorted by decreasing priority. g_list_sort() is stable, so profiles
+ * of equal priority keep their file and document order. */
 GList *
 gupnp_dlna_load_profiles_from_dir (gchar *profile_dir, GUPnPDLNALoadState *data)
 {
@@ -848,16 +942,25 @@ gupnp_dlna_load_profiles_from_dir (gchar *profile_dir, GUPnPDLNALoadState *data)
         GList *profiles = NULL;
 
         if ((dir = g_dir_open (profile_dir, 0, NULL))) {
+                GList *entries = NULL, *i;
                 const gchar *entry;
 
-                while ((entry = g_dir_read_name (dir))) {
+                while ((entry = g_dir_read_name (dir)))
+                        if (g_str_has_suffix (entry, ".xml"))
+                                entries = g_list_prepend (entries,
+                                                          g_strdup (entry));
+
+                g_dir_close (dir);
+
+                entries = g_list_sort (entries, (GCompareFunc) strcmp);
+
+                for (i = entries; i; i = i->next) {
                         gchar *path = g_strconcat (profile_dir,
                                                    G_DIR_SEPARATOR_S,
-                                                   entry,
+                                                   i->data,
                                                    NULL);
 
-                        if (g_str_has_suffix (entry, ".xml") &&
-                            g_file_test (path, G_FILE_TEST_IS_REGULAR)) {
+                        if (g_file_test (path, G_FILE_TEST_IS_REGULAR)) {
                                 profiles = g_list_concat (profiles,
                                         gupnp_dlna_load_profiles_from_file (
                                                 path,
@@ -867,7 +970,10 @@ gupnp_dlna_load_profiles_from_dir (gchar *profile_dir, GUPnPDLNALoadState *data)
                         g_free (path);
                 }
 
-                g_dir_close (dir);
+                g_list_foreach (entries, (GFunc) g_free, NULL);
+                g_list_free (entries);
+
+                profiles = g_list_sort (profiles, compare_priorities);
         }
 
         g_hash_table_unref (data->restrictions);
@@ -876,9 +982,13 @@ gupnp_dlna_load_profiles_from_dir (gchar *profile_dir, GUPnPDLNALoadState *data)
         return profiles;
 }
 
+/* Loads the profiles of @profile_dir as gupnp_dlna_load_profiles_from_disk()
+ * does for the installed ones, so that other sets can be loaded the same way
+ * (by the benchmarks, for instance) */
 GList *
-gupnp_dlna_load_profiles_from_disk (gboolean relaxed_mode,
-                                    gboolean extended_mode)
+gupnp_dlna_load_profiles_from_path (const gchar *profile_dir,
+                                    gboolean    relaxed_mode,
+                                    gboolean    extended_mode)
 {
         GUPnPDLNALoadState *load_data;
         GList *ret, *i;
@@ -894,7 +1004,7 @@ gupnp_dlna_load_profiles_from_disk (gboolean relaxed_mode,
                 load_data->extended_mode = extended_mode;
         }
 
-        ret = gupnp_dlna_load_profiles_from_dir (DLNA_DATA_DIR,
+        ret = gupnp_dlna_load_profiles_from_dir ((gchar *) profile_dir,
                                                  load_data);
 
         /* Now that we're done loading profiles, remove all profiles with no
@@ -914,6 +1024,8 @@ gupnp_dlna_load_profiles_from_disk (gboolean relaxed_mode,
                         g_object_unref (profile);
                 }
 
+                gst_encoding_profile_unref (enc_profile);
+
                 i = tmp;
         }
 
@@ -923,3 +1035,12 @@ gupnp_dlna_load_profiles_from_disk (gboolean relaxed_mode,
 
         return ret;
 }
+
+GList *
+gupnp_dlna_load_profiles_from_disk (gboolean relaxed_mode,
+                                    gboolean extended_mode)
+{
+        return gupnp_dlna_load_profiles_from_path (DLNA_DATA_DIR,
+                                                   relaxed_mode,
+                                                   extended_mode);
+}
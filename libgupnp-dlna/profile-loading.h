@@ -47,6 +47,11 @@ GList *
 gupnp_dlna_load_profiles_from_dir (gchar         *profile_dir,
                                    GUPnPDLNALoadState *data);
 
+GList *
+gupnp_dlna_load_profiles_from_path (const gchar *profile_dir,
+                                    gboolean    relaxed_mode,
+                                    gboolean    extended_mode);
+
 GList *
 gupnp_dlna_load_profiles_from_disk (gboolean relaxed_mode,
                                     gboolean extended_mode);
@@ -0,0 +1,372 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include <gst/gst.h>
+#include "profile-order.h"
+
+/* The candidate tables are ordered again after this many matches */
+#define REORDER_INTERVAL 64
+
+#define COUNTS_GROUP "profile-matches"
+
+typedef struct {
+        /* overlaps[i * n + j], for i < j, is TRUE if the i-th and j-th
+         * profiles of the registry's candidate table could both match the
+         * same file. NULL until first needed. */
+        guint8                *overlaps;
+        /* Indices into the registry's candidate table, in the order of
+         * table. NULL while that is the registry's order. */
+        guint                 *order;
+        GUPnPDLNAProfileTable *table;
+        gboolean              dirty;
+} ClassOrder;
+
+struct _GUPnPDLNAProfileOrder {
+        GUPnPDLNAProfileRegistry *registry;
+        GHashTable               *counts;   /* profile name -> matches */
+        guint                    pending;   /* matches since last ordered */
+        ClassOrder               classes[GUPNP_DLNA_SNIFF_LAST];
+};
+
+GUPnPDLNAProfileOrder *
+gupnp_dlna_profile_order_new (GUPnPDLNAProfileRegistry *registry)
+{
+        GUPnPDLNAProfileOrder *order;
+
+        g_return_val_if_fail (registry != NULL, NULL);
+
+        order = g_slice_new0 (GUPnPDLNAProfileOrder);
+        order->registry = gupnp_dlna_profile_registry_ref (registry);
+        order->counts = g_hash_table_new_full (g_str_hash,
+                                               g_str_equal,
+                                               g_free,
+                                               NULL);
+
+        return order;
+}
+
+void
+gupnp_dlna_profile_order_free (GUPnPDLNAProfileOrder *order)
+{
+        guint i;
+
+        if (!order)
+                return;
+
+        for (i = 0; i < GUPNP_DLNA_SNIFF_LAST; i++) {
+                g_free (order->classes[i].overlaps);
+                g_free (order->classes[i].order);
+                gupnp_dlna_profile_table_free (order->classes[i].table);
+        }
+
+        g_hash_table_unref (order->counts);
+        gupnp_dlna_profile_registry_unref (order->registry);
+
+        g_slice_free (GUPnPDLNAProfileOrder, order);
+}
+
+static void
+mark_dirty (GUPnPDLNAProfileOrder *order)
+{
+        guint i;
+
+        for (i = 0; i < GUPNP_DLNA_SNIFF_LAST; i++)
+                order->classes[i].dirty = TRUE;
+
+        order->pending = 0;
+}
+
+static guint
+get_count (GUPnPDLNAProfileOrder *order, const gchar *name)
+{
+        if (!name)
+                return 0;
+
+        return GPOINTER_TO_UINT (g_hash_table_lookup (order->counts, name));
+}
+
+static void
+set_count (GUPnPDLNAProfileOrder *order, const gchar *name, guint count)
+{
+        g_hash_table_insert (order->counts,
+                             g_strdup (name),
+                             GUINT_TO_POINTER (count));
+}
+
+void
+gupnp_dlna_profile_order_record_match (GUPnPDLNAProfileOrder *order,
+                                       const gchar           *name)
+{
+        guint count;
+
+        g_return_if_fail (order != NULL);
+        g_return_if_fail (name != NULL);
+
+        count = get_count (order, name);
+        if (count < G_MAXUINT)
+                set_count (order, name, count + 1);
+
+        if (++order->pending >= REORDER_INTERVAL)
+                mark_dirty (order);
+}
+
+static guint8 *
+compute_overlaps (const GUPnPDLNAProfileTable *table)
+{
+        guint n = table->n_profiles;
+        guint8 *overlaps;
+        guint i, j;
+
+        overlaps = g_new0 (guint8, n * n);
+
+        for (i = 0; i < n; i++)
+                for (j = i + 1; j < n; j++)
+                        overlaps[i * n + j] =
+                                gupnp_dlna_profile_table_overlap (table, i, j);
+
+        return overlaps;
+}
+
+/*
+ * Orders the profiles of @table by decreasing match count, except that a
+ * profile is never placed before one that comes earlier in @table and
+ * overlaps with it. Among the profiles that can be placed next, the most
+ * matched one is picked, ties going to the earliest. Returns TRUE if the
+ * result is the order of @table itself.
+ */
+static gboolean
+compute_order (GUPnPDLNAProfileOrder       *order,
+               const GUPnPDLNAProfileTable *table,
+               const guint8                *overlaps,
+               guint                       *result)
+{
+        guint n = table->n_profiles;
+        guint *counts, *blockers;
+        gboolean *placed, identity = TRUE;
+        guint i, j, k;
+
+        counts = g_new (guint, n);
+        blockers = g_new0 (guint, n);
+        placed = g_new0 (gboolean, n);
+
+        for (i = 0; i < n; i++) {
+                counts[i] = get_count (order, table->names[i]);
+
+                for (j = i + 1; j < n; j++)
+                        if (overlaps[i * n + j])
+                                blockers[j]++;
+        }
+
+        for (k = 0; k < n; k++) {
+                guint best = n;
+
+                for (j = 0; j < n; j++)
+                        if (!placed[j] &&
+                            blockers[j] == 0 &&
+                            (best == n || counts[j] > counts[best]))
+                                best = j;
+
+                /* blockers only counts earlier profiles, so there always is
+                 * one that can be placed */
+                g_assert (best < n);
+
+                result[k] = best;
+                placed[best] = TRUE;
+                if (best != k)
+                        identity = FALSE;
+
+                for (j = best + 1; j < n; j++)
+                        if (overlaps[best * n + j])
+                                blockers[j]--;
+        }
+
+        g_free (placed);
+        g_free (blockers);
+        g_free (counts);
+
+        return identity;
+}
+
+static void
+reorder_class (GUPnPDLNAProfileOrder *order, GUPnPDLNASniffClass sniff_class)
+{
+        ClassOrder *class_order = &order->classes[sniff_class];
+        const GUPnPDLNAProfileTable *base;
+        GList *profiles = NULL;
+        guint *result;
+        guint i, n;
+
+        class_order->dirty = FALSE;
+
+        base = gupnp_dlna_profile_registry_get_candidates (order->registry,
+                                                           sniff_class);
+        n = base->n_profiles;
+
+        if (!class_order->overlaps)
+                class_order->overlaps = compute_overlaps (base);
+
+        result = g_new (guint, n);
+
+        if (compute_order (order, base, class_order->overlaps, result)) {
+                g_free (result);
+                g_free (class_order->order);
+                class_order->order = NULL;
+                gupnp_dlna_profile_table_free (class_order->table);
+                class_order->table = NULL;
+
+                return;
+        }
+
+        if (class_order->order &&
+            memcmp (class_order->order, result, n * sizeof (guint)) == 0) {
+                g_free (result);
+
+                return;
+        }
+
+        for (i = n; i > 0; i--)
+                profiles = g_list_prepend (profiles,
+                                           base->profiles[result[i - 1]]);
+
+        gupnp_dlna_profile_table_free (class_order->table);
+        class_order->table = gupnp_dlna_profile_table_new (profiles);
+        g_list_free (profiles);
+
+        g_free (class_order->order);
+        class_order->order = result;
+}
+
+/* The candidates for @sniff_class, most frequently matched first. The table
+ * stays valid until the next call. */
+const GUPnPDLNAProfileTable *
+gupnp_dlna_profile_order_get_candidates (GUPnPDLNAProfileOrder *order,
+                                         GUPnPDLNASniffClass   sniff_class)
+{
+        ClassOrder *class_order;
+
+        g_return_val_if_fail (order != NULL, NULL);
+        g_return_val_if_fail (sniff_class < GUPNP_DLNA_SNIFF_LAST, NULL);
+
+        class_order = &order->classes[sniff_class];
+
+        if (class_order->dirty)
+                reorder_class (order, sniff_class);
+
+        if (class_order->table)
+                return class_order->table;
+
+        return gupnp_dlna_profile_registry_get_candidates (order->registry,
+                                                           sniff_class);
+}
+
+/* Adds the match counts saved in @filename to those of @order */
+gboolean
+gupnp_dlna_profile_order_load (GUPnPDLNAProfileOrder *order,
+                               const gchar           *filename,
+                               GError                **error)
+{
+        GKeyFile *key_file;
+        gchar **names = NULL;
+        gboolean ret = FALSE;
+        guint i;
+
+        g_return_val_if_fail (order != NULL, FALSE);
+        g_return_val_if_fail (filename != NULL, FALSE);
+
+        key_file = g_key_file_new ();
+
+        if (!g_key_file_load_from_file (key_file,
+                                        filename,
+                                        G_KEY_FILE_NONE,
+                                        error))
+                goto out;
+
+        /* A file without any match yet has no group at all */
+        if (!g_key_file_has_group (key_file, COUNTS_GROUP)) {
+                ret = TRUE;
+                goto out;
+        }
+
+        names = g_key_file_get_keys (key_file, COUNTS_GROUP, NULL, error);
+        if (!names)
+                goto out;
+
+        for (i = 0; names[i]; i++) {
+                GError *err = NULL;
+                gint count;
+
+                count = g_key_file_get_integer (key_file,
+                                                COUNTS_GROUP,
+                                                names[i],
+                                                &err);
+                if (err) {
+                        g_propagate_error (error, err);
+                        goto out;
+                }
+
+                if (count > 0)
+                        set_count (order,
+                                   names[i],
+                                   get_count (order, names[i]) + count);
+        }
+
+        mark_dirty (order);
+        ret = TRUE;
+
+out:
+        g_strfreev (names);
+        g_key_file_free (key_file);
+
+        return ret;
+}
+
+static void
+save_count (const gchar *name, gpointer count, GKeyFile *key_file)
+{
+        g_key_file_set_integer (key_file,
+                                COUNTS_GROUP,
+                                name,
+                                MIN (GPOINTER_TO_UINT (count), G_MAXINT));
+}
+
+gboolean
+gupnp_dlna_profile_order_save (GUPnPDLNAProfileOrder *order,
+                               const gchar           *filename,
+                               GError                **error)
+{
+        GKeyFile *key_file;
+        gchar *data;
+        gsize length;
+        gboolean ret;
+
+        g_return_val_if_fail (order != NULL, FALSE);
+        g_return_val_if_fail (filename != NULL, FALSE);
+
+        key_file = g_key_file_new ();
+        g_hash_table_foreach (order->counts, (GHFunc) save_count, key_file);
+
+        data = g_key_file_to_data (key_file, &length, NULL);
+        ret = g_file_set_contents (filename, data, length, error);
+
+        g_free (data);
+        g_key_file_free (key_file);
+
+        return ret;
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GUPNP_DLNA_PROFILE_ORDER_H__
+#define __GUPNP_DLNA_PROFILE_ORDER_H__
+
+#include <glib.h>
+#include "profile-registry.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Matching stops at the first profile that fits, so the profiles that most
+ * files match should be checked first. A profile order counts how often each
+ * profile of a registry was matched, and hands out candidate tables in which
+ * frequently matched profiles come earlier.
+ *
+ * Two profiles that could both match the same file are never swapped, so
+ * the result of matching is the same as with the registry's own order: only
+ * the time it takes to get there changes.
+ *
+ * The counts can be saved to and loaded from a file, so that the order does
+ * not have to be learnt again from scratch.
+ */
+typedef struct _GUPnPDLNAProfileOrder GUPnPDLNAProfileOrder;
+
+GUPnPDLNAProfileOrder *
+gupnp_dlna_profile_order_new (GUPnPDLNAProfileRegistry *registry);
+
+void
+gupnp_dlna_profile_order_free (GUPnPDLNAProfileOrder *order);
+
+void
+gupnp_dlna_profile_order_record_match (GUPnPDLNAProfileOrder *order,
+                                       const gchar           *name);
+
+const GUPnPDLNAProfileTable *
+gupnp_dlna_profile_order_get_candidates (GUPnPDLNAProfileOrder *order,
+                                         GUPnPDLNASniffClass   sniff_class);
+
+gboolean
+gupnp_dlna_profile_order_load (GUPnPDLNAProfileOrder *order,
+                               const gchar           *filename,
+                               GError                **error);
+
+gboolean
+gupnp_dlna_profile_order_save (GUPnPDLNAProfileOrder *order,
+                               const gchar           *filename,
+                               GError                **error);
+
+G_END_DECLS
+
+#endif /* __GUPNP_DLNA_PROFILE_ORDER_H__ */
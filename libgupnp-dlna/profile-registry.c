@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <gst/pbutils/pbutils.h>
+#include "profile-registry.h"
+#include "profile-loading.h"
+
+struct _GUPnPDLNAProfileRegistry {
+        volatile gint ref_count;
+        GList                 *profiles;
+        GHashTable            *names;
+        GHashTable            *indices; /* profile -> index in table + 1 */
+        GUPnPDLNAProfileTable *table;
+        GUPnPDLNAProfileTable *candidates[GUPNP_DLNA_SNIFF_LAST];
+};
+
+/* One registry per [relaxed][extended] mode, loaded on first use */
+static volatile gsize default_registries[2][2];
+
+/*
+ * Takes ownership of @profiles. Everything that the profiles would otherwise
+ * compute lazily is computed here, so that matching never has to write to
+ * them afterwards.
+ */
+GUPnPDLNAProfileRegistry *
+gupnp_dlna_profile_registry_new (GList *profiles)
+{
+        GUPnPDLNAProfileRegistry *registry;
+        GList *i;
+        gint sniff_class;
+        guint index;
+
+        registry = g_slice_new0 (GUPnPDLNAProfileRegistry);
+        registry->ref_count = 1;
+        registry->profiles = profiles;
+        registry->names = g_hash_table_new (g_str_hash, g_str_equal);
+        registry->indices = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+        for (i = profiles, index = 0; i; i = i->next, index++) {
+                GUPnPDLNAProfile *profile = GUPNP_DLNA_PROFILE (i->data);
+                GstEncodingProfile *enc_profile;
+                const gchar *name;
+
+                enc_profile = gupnp_dlna_profile_get_encoding_profile
+                                                                (profile);
+                gst_encoding_profile_unref (enc_profile);
+
+                /* Like a walk through the list would, a lookup finds the
+                 * first profile with a given name */
+                name = gupnp_dlna_profile_get_name (profile);
+                if (name && !g_hash_table_lookup (registry->names, name))
+                        g_hash_table_insert (registry->names,
+                                             (gpointer) name,
+                                             profile);
+
+                if (!g_hash_table_lookup (registry->indices, profile))
+                        g_hash_table_insert (registry->indices,
+                                             profile,
+                                             GUINT_TO_POINTER (index + 1));
+        }
+
+        registry->table = gupnp_dlna_profile_table_new (profiles);
+
+        for (sniff_class = 0;
+             sniff_class < GUPNP_DLNA_SNIFF_LAST;
+             sniff_class++) {
+                GList *candidates;
+
+                candidates = gupnp_dlna_sniff_filter_profiles (sniff_class,
+                                                               profiles);
+                registry->candidates[sniff_class] =
+                        gupnp_dlna_profile_table_new (candidates);
+                g_list_free (candidates);
+        }
+
+        return registry;
+}
+
+/*
+ * Returns the registry of the profiles installed on disk for the given mode.
+ * It is loaded by whichever thread asks for it first and is never freed.
+ */
+GUPnPDLNAProfileRegistry *
+gupnp_dlna_profile_registry_get_default (gboolean relaxed_mode,
+                                         gboolean extended_mode)
+{
+        volatile gsize *location;
+
+        location = &default_registries[relaxed_mode != FALSE]
+                                      [extended_mode != FALSE];
+
+        if (g_once_init_enter (location)) {
+                GUPnPDLNAProfileRegistry *registry;
+
+                registry = gupnp_dlna_profile_registry_new
+                                (gupnp_dlna_load_profiles_from_disk
+                                                (relaxed_mode,
+                                                 extended_mode));
+
+                g_once_init_leave (location, (gsize) registry);
+        }
+
+        return (GUPnPDLNAProfileRegistry *) *location;
+}
+
+GUPnPDLNAProfileRegistry *
+gupnp_dlna_profile_registry_ref (GUPnPDLNAProfileRegistry *registry)
+{
+        g_return_val_if_fail (registry != NULL, NULL);
+
+        g_atomic_int_inc (&registry->ref_count);
+
+        return registry;
+}
+
+void
+gupnp_dlna_profile_registry_unref (GUPnPDLNAProfileRegistry *registry)
+{
+        gint sniff_class;
+
+        g_return_if_fail (registry != NULL);
+
+        if (!g_atomic_int_dec_and_test (&registry->ref_count))
+                return;
+
+        for (sniff_class = 0;
+             sniff_class < GUPNP_DLNA_SNIFF_LAST;
+             sniff_class++)
+                gupnp_dlna_profile_table_free
+                                (registry->candidates[sniff_class]);
+
+        gupnp_dlna_profile_table_free (registry->table);
+        g_hash_table_unref (registry->indices);
+        g_hash_table_unref (registry->names);
+        g_list_foreach (registry->profiles, (GFunc) g_object_unref, NULL);
+        g_list_free (registry->profiles);
+
+        g_slice_free (GUPnPDLNAProfileRegistry, registry);
+}
+
+const GList *
+gupnp_dlna_profile_registry_get_profiles (GUPnPDLNAProfileRegistry *registry)
+{
+        g_return_val_if_fail (registry != NULL, NULL);
+
+        return registry->profiles;
+}
+
+/* All of the profiles, laid out for matching */
+const GUPnPDLNAProfileTable *
+gupnp_dlna_profile_registry_get_table (GUPnPDLNAProfileRegistry *registry)
+{
+        g_return_val_if_fail (registry != NULL, NULL);
+
+        return registry->table;
+}
+
+/* Returns the profile called @name, or NULL. No reference is added. */
+GUPnPDLNAProfile *
+gupnp_dlna_profile_registry_lookup (GUPnPDLNAProfileRegistry *registry,
+                                    const gchar              *name)
+{
+        g_return_val_if_fail (registry != NULL, NULL);
+        g_return_val_if_fail (name != NULL, NULL);
+
+        return g_hash_table_lookup (registry->names, name);
+}
+
+/* Returns the index of @profile in the table of @registry, or -1 if it is
+ * not one of the profiles of @registry */
+gint
+gupnp_dlna_profile_registry_get_index (GUPnPDLNAProfileRegistry *registry,
+                                       GUPnPDLNAProfile         *profile)
+{
+        g_return_val_if_fail (registry != NULL, -1);
+
+        return (gint) GPOINTER_TO_UINT
+                        (g_hash_table_lookup (registry->indices, profile)) - 1;
+}
+
+/* The profiles that a file of class @sniff_class could possibly match */
+const GUPnPDLNAProfileTable *
+gupnp_dlna_profile_registry_get_candidates
+                                (GUPnPDLNAProfileRegistry *registry,
+                                 GUPnPDLNASniffClass      sniff_class)
+{
+        g_return_val_if_fail (registry != NULL, NULL);
+        g_return_val_if_fail (sniff_class < GUPNP_DLNA_SNIFF_LAST, NULL);
+
+        return registry->candidates[sniff_class];
+}
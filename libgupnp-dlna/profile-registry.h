@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GUPNP_DLNA_PROFILE_REGISTRY_H__
+#define __GUPNP_DLNA_PROFILE_REGISTRY_H__
+
+#include <glib.h>
+#include "container-sniff.h"
+#include "profile-table.h"
+
+G_BEGIN_DECLS
+
+/*
+ * A frozen set of profiles. Once created, neither the registry nor the
+ * profiles in it are modified any more, so a registry can be shared by any
+ * number of discoverers and matched against from any number of threads.
+ */
+typedef struct _GUPnPDLNAProfileRegistry GUPnPDLNAProfileRegistry;
+
+GUPnPDLNAProfileRegistry *
+gupnp_dlna_profile_registry_new (GList *profiles);
+
+GUPnPDLNAProfileRegistry *
+gupnp_dlna_profile_registry_get_default (gboolean relaxed_mode,
+                                         gboolean extended_mode);
+
+GUPnPDLNAProfileRegistry *
+gupnp_dlna_profile_registry_ref (GUPnPDLNAProfileRegistry *registry);
+
+void
+gupnp_dlna_profile_registry_unref (GUPnPDLNAProfileRegistry *registry);
+
+const GList *
+gupnp_dlna_profile_registry_get_profiles (GUPnPDLNAProfileRegistry *registry);
+
+GUPnPDLNAProfile *
+gupnp_dlna_profile_registry_lookup (GUPnPDLNAProfileRegistry *registry,
+                                    const gchar              *name);
+
+gint
+gupnp_dlna_profile_registry_get_index (GUPnPDLNAProfileRegistry *registry,
+                                       GUPnPDLNAProfile         *profile);
+
+const GUPnPDLNAProfileTable *
+gupnp_dlna_profile_registry_get_table (GUPnPDLNAProfileRegistry *registry);
+
+const GUPnPDLNAProfileTable *
+gupnp_dlna_profile_registry_get_candidates
+                                (GUPnPDLNAProfileRegistry *registry,
+                                 GUPnPDLNASniffClass      sniff_class);
+
+G_END_DECLS
+
+#endif /* __GUPNP_DLNA_PROFILE_REGISTRY_H__ */
@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "profile-table.h"
+#include "gupnp-dlna-profile-private.h"
+
+/* Each structure of @caps becomes a caps of its own, so that the matcher
+ * does not have to copy it into one for every match */
+static void
+add_restrictions (GPtrArray *restrictions, const GstCaps *caps)
+{
+        guint i;
+
+        if (!GST_IS_CAPS (caps))
+                return;
+
+        for (i = 0; i < gst_caps_get_size (caps); i++) {
+                GstStructure *st = gst_caps_get_structure (caps, i);
+
+                g_ptr_array_add (restrictions,
+                                 gst_caps_new_full (gst_structure_copy (st),
+                                                    NULL));
+        }
+}
+
+/* The profiles are referenced by the table, which does not hold on to
+ * @profiles itself */
+GUPnPDLNAProfileTable *
+gupnp_dlna_profile_table_new (const GList *profiles)
+{
+        GUPnPDLNAProfileTable *table;
+        GPtrArray *restrictions;
+        const GList *l;
+        guint n, i;
+
+        n = g_list_length ((GList *) profiles);
+        restrictions = g_ptr_array_new ();
+
+        table = g_slice_new (GUPnPDLNAProfileTable);
+        table->n_profiles = n;
+        table->profiles = g_new (GUPnPDLNAProfile *, n);
+        table->names = g_new (const gchar *, n);
+        table->mimes = g_new (const gchar *, n);
+        table->flags = g_new0 (guint8, n);
+        table->container_caps = g_new (const GstCaps *, n);
+        table->video_offsets = g_new (guint, n + 1);
+        table->audio_offsets = g_new (guint, n + 1);
+
+        for (l = profiles, i = 0; l; l = l->next, i++) {
+                GUPnPDLNAProfile *profile = GUPNP_DLNA_PROFILE (l->data);
+                const GstCaps *container, *video;
+                const gchar *name;
+
+                name = gupnp_dlna_profile_get_name (profile);
+                container = gupnp_dlna_profile_get_container_caps (profile);
+                video = gupnp_dlna_profile_get_video_caps (profile);
+
+                table->profiles[i] = g_object_ref (profile);
+                table->names[i] = name;
+                table->mimes[i] = gupnp_dlna_profile_get_mime (profile);
+                table->container_caps[i] = container;
+
+                /* Profiles with an empty name are used only for inheritance,
+                 * and those without container caps have no encoding profile
+                 * that could be matched against */
+                if (name && name[0] != '\0' && GST_IS_CAPS (container))
+                        table->flags[i] |= GUPNP_DLNA_PROFILE_TABLE_MATCHABLE;
+
+                if (GST_IS_CAPS (container) && !gst_caps_is_empty (container))
+                        table->flags[i] |= GUPNP_DLNA_PROFILE_TABLE_CONTAINER;
+
+                if (GST_IS_CAPS (video) && !gst_caps_is_empty (video))
+                        table->flags[i] |= GUPNP_DLNA_PROFILE_TABLE_VIDEO;
+
+                table->video_offsets[i] = restrictions->len;
+                add_restrictions (restrictions, video);
+                table->audio_offsets[i] = restrictions->len;
+                add_restrictions (restrictions,
+                                  gupnp_dlna_profile_get_audio_caps (profile));
+        }
+
+        table->video_offsets[n] = table->audio_offsets[n] = restrictions->len;
+        table->restrictions = (GstCaps **) g_ptr_array_free (restrictions,
+                                                             FALSE);
+
+        return table;
+}
+
+static gboolean
+restrictions_overlap (const GUPnPDLNAProfileTable *table,
+                      guint                       first_a,
+                      guint                       last_a,
+                      guint                       first_b,
+                      guint                       last_b)
+{
+        guint a, b;
+
+        for (a = first_a; a < last_a; a++)
+                for (b = first_b; b < last_b; b++)
+                        if (gst_caps_can_intersect (table->restrictions[a],
+                                                    table->restrictions[b]))
+                                return TRUE;
+
+        return FALSE;
+}
+
+/*
+ * Returns FALSE only if no stream can match both profiles i and j. Stream
+ * caps are fixed, so a stream can only fit two restrictions that intersect.
+ * Video profiles are only checked against streams with video and the others
+ * against streams without, and a profile with a container is only checked
+ * against streams with one.
+ *
+ * A profile matches if any stream of each kind fits it, so a file with
+ * several audio or video streams can match two profiles with disjoint
+ * restrictions through different streams. Only files with a container can
+ * have more than one stream, so profiles with containers that intersect
+ * always overlap. Images are only matched on their first stream, which is
+ * why video profiles overlap whenever their video restrictions do.
+ */
+gboolean
+gupnp_dlna_profile_table_overlap (const GUPnPDLNAProfileTable *table,
+                                  guint                       i,
+                                  guint                       j)
+{
+        guint8 flags_i = table->flags[i];
+        guint8 flags_j = table->flags[j];
+        gboolean containers_overlap;
+
+        if (!(flags_i & GUPNP_DLNA_PROFILE_TABLE_MATCHABLE) ||
+            !(flags_j & GUPNP_DLNA_PROFILE_TABLE_MATCHABLE))
+                return FALSE;
+
+        if ((flags_i ^ flags_j) & GUPNP_DLNA_PROFILE_TABLE_VIDEO)
+                return FALSE;
+
+        containers_overlap =
+                (flags_i & flags_j & GUPNP_DLNA_PROFILE_TABLE_CONTAINER) &&
+                gst_caps_can_intersect (table->container_caps[i],
+                                        table->container_caps[j]);
+
+        if (flags_i & GUPNP_DLNA_PROFILE_TABLE_VIDEO)
+                return containers_overlap ||
+                       restrictions_overlap (table,
+                                             table->video_offsets[i],
+                                             table->audio_offsets[i],
+                                             table->video_offsets[j],
+                                             table->audio_offsets[j]);
+
+        if ((flags_i ^ flags_j) & GUPNP_DLNA_PROFILE_TABLE_CONTAINER)
+                return FALSE;
+
+        if (flags_i & GUPNP_DLNA_PROFILE_TABLE_CONTAINER)
+                return containers_overlap;
+
+        return restrictions_overlap (table,
+                                     table->audio_offsets[i],
+                                     table->video_offsets[i + 1],
+                                     table->audio_offsets[j],
+                                     table->video_offsets[j + 1]);
+}
+
+void
+gupnp_dlna_profile_table_free (GUPnPDLNAProfileTable *table)
+{
+        guint i;
+
+        if (!table)
+                return;
+
+        for (i = 0; i < table->video_offsets[table->n_profiles]; i++)
+                gst_caps_unref (table->restrictions[i]);
+
+        for (i = 0; i < table->n_profiles; i++)
+                g_object_unref (table->profiles[i]);
+
+        g_free (table->restrictions);
+        g_free (table->audio_offsets);
+        g_free (table->video_offsets);
+        g_free (table->container_caps);
+        g_free (table->flags);
+        g_free (table->mimes);
+        g_free (table->names);
+        g_free (table->profiles);
+
+        g_slice_free (GUPnPDLNAProfileTable, table);
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GUPNP_DLNA_PROFILE_TABLE_H__
+#define __GUPNP_DLNA_PROFILE_TABLE_H__
+
+#include <gst/gst.h>
+#include "gupnp-dlna-profile.h"
+
+G_BEGIN_DECLS
+
+/*
+ * The profiles of a GList laid out as a struct of arrays, in the same order,
+ * so that the matcher walks a few contiguous arrays instead of chasing list
+ * nodes and GObject private structs for every candidate.
+ *
+ * The video restrictions of profile i are the single-structure caps
+ * restrictions[video_offsets[i]] up to (not including)
+ * restrictions[audio_offsets[i]], and its audio restrictions continue up to
+ * restrictions[video_offsets[i + 1]]. Both offset arrays therefore have
+ * n_profiles + 1 entries.
+ */
+
+typedef enum {
+        /* The profile is not only used for inheritance */
+        GUPNP_DLNA_PROFILE_TABLE_MATCHABLE     = 1 << 0,
+        /* The profile has video restrictions */
+        GUPNP_DLNA_PROFILE_TABLE_VIDEO         = 1 << 1,
+        /* The profile restricts the container */
+        GUPNP_DLNA_PROFILE_TABLE_CONTAINER     = 1 << 2
+} GUPnPDLNAProfileTableFlags;
+
+typedef struct {
+        guint             n_profiles;
+
+        GUPnPDLNAProfile  **profiles;
+        const gchar       **names;
+        const gchar       **mimes;
+        guint8            *flags;
+        const GstCaps     **container_caps;
+
+        guint             *video_offsets;
+        guint             *audio_offsets;
+        GstCaps           **restrictions;
+} GUPnPDLNAProfileTable;
+
+GUPnPDLNAProfileTable *
+gupnp_dlna_profile_table_new (const GList *profiles);
+
+void
+gupnp_dlna_profile_table_free (GUPnPDLNAProfileTable *table);
+
+gboolean
+gupnp_dlna_profile_table_overlap (const GUPnPDLNAProfileTable *table,
+                                  guint                       i,
+                                  guint                       j);
+
+G_END_DECLS
+
+#endif /* __GUPNP_DLNA_PROFILE_TABLE_H__ */
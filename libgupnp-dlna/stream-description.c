@@ -0,0 +1,324 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "stream-description.h"
+
+static GstCaps *
+caps_from_audio_stream_info (GstDiscovererStreamInfo *info)
+{
+        GstCaps *temp = gst_discoverer_stream_info_get_caps (info);
+        GstCaps *caps = gst_caps_copy (temp);
+        const GstDiscovererAudioInfo *audio_info =
+                GST_DISCOVERER_AUDIO_INFO(info);
+        guint data;
+
+        gst_caps_unref (temp);
+
+        data = gst_discoverer_audio_info_get_sample_rate (audio_info);
+        if (data)
+                gst_caps_set_simple (caps, "rate", G_TYPE_INT, data, NULL);
+
+        data = gst_discoverer_audio_info_get_channels (audio_info);
+        if (data)
+                gst_caps_set_simple (caps, "channels", G_TYPE_INT, data, NULL);
+
+        data = gst_discoverer_audio_info_get_bitrate (audio_info);
+        if (data)
+                gst_caps_set_simple (caps, "bitrate", G_TYPE_INT, data, NULL);
+
+        data = gst_discoverer_audio_info_get_max_bitrate (audio_info);
+        if (data)
+                gst_caps_set_simple
+                        (caps, "maximum-bitrate", G_TYPE_INT, data, NULL);
+
+        data = gst_discoverer_audio_info_get_depth (audio_info);
+        if (data)
+                gst_caps_set_simple (caps, "depth", G_TYPE_INT, data, NULL);
+
+        return caps;
+}
+
+static GstCaps *
+caps_from_video_stream_info (GstDiscovererStreamInfo *info)
+{
+        GstCaps *temp = gst_discoverer_stream_info_get_caps (info);
+        GstCaps *caps = gst_caps_copy (temp);
+        const GstDiscovererVideoInfo *video_info =
+                GST_DISCOVERER_VIDEO_INFO (info);
+        const GstTagList *stream_tag_list;
+        guint n, d, data;
+        gboolean value;
+
+        gst_caps_unref (temp);
+
+        data = gst_discoverer_video_info_get_height (video_info);
+        if (data)
+                gst_caps_set_simple (caps, "height", G_TYPE_INT, data, NULL);
+
+        data = gst_discoverer_video_info_get_width (video_info);
+        if (data)
+                gst_caps_set_simple (caps, "width", G_TYPE_INT, data, NULL);
+
+        data = gst_discoverer_video_info_get_depth (video_info);
+        if (data)
+                gst_caps_set_simple (caps, "depth", G_TYPE_INT, data, NULL);
+
+        n = gst_discoverer_video_info_get_framerate_num (video_info);
+        d = gst_discoverer_video_info_get_framerate_denom (video_info);
+        if (n && d)
+                gst_caps_set_simple (caps,
+                                     "framerate",
+                                     GST_TYPE_FRACTION, n, d,
+                                     NULL);
+
+        n = gst_discoverer_video_info_get_par_num (video_info);
+        d = gst_discoverer_video_info_get_par_denom (video_info);
+        if (n && d)
+                gst_caps_set_simple (caps,
+                                     "pixel-aspect-ratio",
+                                     GST_TYPE_FRACTION, n, d,
+                                     NULL);
+
+        value = gst_discoverer_video_info_is_interlaced (video_info);
+        if (value)
+                gst_caps_set_simple
+                        (caps, "interlaced", G_TYPE_BOOLEAN, value, NULL);
+
+        stream_tag_list = gst_discoverer_stream_info_get_tags (info);
+        if (stream_tag_list) {
+                guint bitrate;
+                if (gst_tag_list_get_uint (stream_tag_list, "bitrate", &bitrate))
+                        gst_caps_set_simple
+                             (caps, "bitrate", G_TYPE_INT, (int) bitrate, NULL);
+
+                if (gst_tag_list_get_uint (stream_tag_list,
+                                           "maximum-bitrate",
+                                           &bitrate))
+                        gst_caps_set_simple (caps,
+                                             "maximum-bitrate",
+                                             G_TYPE_INT,
+                                             (int) bitrate,
+                                             NULL);
+        }
+
+        return caps;
+}
+
+GUPnPDLNAStreamDescription *
+gupnp_dlna_stream_description_new (void)
+{
+        return g_slice_new0 (GUPnPDLNAStreamDescription);
+}
+
+GUPnPDLNAStreamDescription *
+gupnp_dlna_stream_description_new_from_discoverer_info
+                                        (GstDiscovererInfo *info)
+{
+        GUPnPDLNAStreamDescription *desc;
+        GstDiscovererStreamInfo *stream_info;
+        GList *i, *stream_list;
+        guint n_video = 0;
+        gboolean is_image = FALSE;
+
+        desc = gupnp_dlna_stream_description_new ();
+
+        /* Top-level GstStreamInformation in the topology will be
+         * the container */
+        stream_info = gst_discoverer_info_get_stream_info (info);
+        if (stream_info) {
+                if (G_TYPE_FROM_INSTANCE (stream_info) ==
+                    GST_TYPE_DISCOVERER_CONTAINER_INFO)
+                        desc->container = gst_discoverer_stream_info_get_caps
+                                        (stream_info);
+
+                gst_discoverer_stream_info_unref (stream_info);
+        }
+
+        stream_list = gst_discoverer_info_get_stream_list (info);
+
+        for (i = stream_list; i; i = i->next) {
+                GstDiscovererStreamInfo *stream =
+                        GST_DISCOVERER_STREAM_INFO (i->data);
+                GType stream_type = G_TYPE_FROM_INSTANCE (stream);
+
+                if (stream_type == GST_TYPE_DISCOVERER_VIDEO_INFO) {
+                        desc->video = g_list_prepend
+                                (desc->video,
+                                 caps_from_video_stream_info (stream));
+                        is_image = gst_discoverer_video_info_is_image
+                                (GST_DISCOVERER_VIDEO_INFO (stream));
+                        n_video++;
+                } else if (stream_type == GST_TYPE_DISCOVERER_AUDIO_INFO)
+                        desc->audio = g_list_prepend
+                                (desc->audio,
+                                 caps_from_audio_stream_info (stream));
+        }
+
+        gst_discoverer_stream_info_list_free (stream_list);
+
+        desc->video = g_list_reverse (desc->video);
+        desc->audio = g_list_reverse (desc->audio);
+        desc->is_image = (n_video == 1 && is_image);
+
+        return desc;
+}
+
+static void
+copy_field (GstStructure       *to,
+            const gchar        *to_name,
+            const GstStructure *from,
+            const gchar        *from_name)
+{
+        const GValue *value = gst_structure_get_value (from, from_name);
+
+        if (value)
+                gst_structure_set_value (to, to_name, value);
+}
+
+/*
+ * Boils @desc down to the handful of fields that are commonly shown to users
+ * or needed to serve the file: the media types of the container and of the
+ * first video and audio streams, and their main properties. The result can
+ * be kept around long after the GstDiscovererInfo has been dropped.
+ * @duration and @match_time are left out if they are GST_CLOCK_TIME_NONE.
+ */
+GstStructure *
+gupnp_dlna_stream_description_summarize
+                                (const GUPnPDLNAStreamDescription *desc,
+                                 const gchar                      *uri,
+                                 GstClockTime                     duration,
+                                 GstClockTime                     match_time)
+{
+        GstStructure *summary, *st;
+
+        summary = gst_structure_empty_new ("gupnp-dlna-summary");
+
+        if (uri)
+                gst_structure_set (summary, "uri", G_TYPE_STRING, uri, NULL);
+
+        if (GST_CLOCK_TIME_IS_VALID (duration) && duration > 0)
+                gst_structure_set (summary,
+                                   "duration", G_TYPE_UINT64, duration,
+                                   NULL);
+
+        if (GST_CLOCK_TIME_IS_VALID (match_time))
+                gst_structure_set (summary,
+                                   "match-time", G_TYPE_UINT64, match_time,
+                                   NULL);
+
+        if (desc->container && !gst_caps_is_empty (desc->container)) {
+                st = gst_caps_get_structure (desc->container, 0);
+                gst_structure_set (summary,
+                                   "container-format",
+                                   G_TYPE_STRING,
+                                   gst_structure_get_name (st),
+                                   NULL);
+        }
+
+        if (desc->video) {
+                st = gst_caps_get_structure (GST_CAPS (desc->video->data), 0);
+                gst_structure_set (summary,
+                                   "video-format",
+                                   G_TYPE_STRING,
+                                   gst_structure_get_name (st),
+                                   NULL);
+                copy_field (summary, "width", st, "width");
+                copy_field (summary, "height", st, "height");
+                copy_field (summary, "framerate", st, "framerate");
+                copy_field (summary, "video-bitrate", st, "bitrate");
+        }
+
+        if (desc->audio) {
+                st = gst_caps_get_structure (GST_CAPS (desc->audio->data), 0);
+                gst_structure_set (summary,
+                                   "audio-format",
+                                   G_TYPE_STRING,
+                                   gst_structure_get_name (st),
+                                   NULL);
+                copy_field (summary, "rate", st, "rate");
+                copy_field (summary, "channels", st, "channels");
+                copy_field (summary, "audio-bitrate", st, "bitrate");
+        }
+
+        return summary;
+}
+
+/*
+ * Does the opposite of gupnp_dlna_stream_description_summarize(), for
+ * results that no longer have a GstDiscovererInfo. Only the fields of the
+ * summary make it back into the caps, so the description is much less
+ * precise than the one the summary was made from: it fails any restriction
+ * on the fields that were left out (profile, level, ...).
+ */
+GUPnPDLNAStreamDescription *
+gupnp_dlna_stream_description_new_from_summary (const GstStructure *summary,
+                                                gboolean           is_image)
+{
+        GUPnPDLNAStreamDescription *desc;
+        const gchar *format;
+        GstStructure *st;
+
+        desc = gupnp_dlna_stream_description_new ();
+
+        if (!summary)
+                return desc;
+
+        format = gst_structure_get_string (summary, "container-format");
+        if (format)
+                desc->container = gst_caps_new_simple (format, NULL);
+
+        format = gst_structure_get_string (summary, "video-format");
+        if (format) {
+                st = gst_structure_empty_new (format);
+                copy_field (st, "width", summary, "width");
+                copy_field (st, "height", summary, "height");
+                copy_field (st, "framerate", summary, "framerate");
+                copy_field (st, "bitrate", summary, "video-bitrate");
+                desc->video = g_list_prepend (NULL,
+                                              gst_caps_new_full (st, NULL));
+        }
+
+        format = gst_structure_get_string (summary, "audio-format");
+        if (format) {
+                st = gst_structure_empty_new (format);
+                copy_field (st, "rate", summary, "rate");
+                copy_field (st, "channels", summary, "channels");
+                copy_field (st, "bitrate", summary, "audio-bitrate");
+                desc->audio = g_list_prepend (NULL,
+                                              gst_caps_new_full (st, NULL));
+        }
+
+        desc->is_image = (is_image && desc->video != NULL);
+
+        return desc;
+}
+
+void
+gupnp_dlna_stream_description_free (GUPnPDLNAStreamDescription *desc)
+{
+        if (desc->container)
+                gst_caps_unref (desc->container);
+
+        g_list_foreach (desc->video, (GFunc) gst_caps_unref, NULL);
+        g_list_free (desc->video);
+        g_list_foreach (desc->audio, (GFunc) gst_caps_unref, NULL);
+        g_list_free (desc->audio);
+
+        g_slice_free (GUPnPDLNAStreamDescription, desc);
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GUPNP_DLNA_STREAM_DESCRIPTION_H__
+#define __GUPNP_DLNA_STREAM_DESCRIPTION_H__
+
+#include <gst/pbutils/pbutils.h>
+#include "gupnp-dlna-information.h"
+#include "gupnp-dlna-discoverer.h"
+#include "profile-table.h"
+#include "match-stats.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Everything the profile matcher needs to know about a stream: the caps of
+ * the container and of each elementary stream, with the metadata that
+ * GstDiscoverer reports outside of the caps (width, bitrate, ...) merged in
+ * as caps fields. The description is built once per stream, either from a
+ * GstDiscovererInfo or by parsing the file headers directly, and is then
+ * matched against each profile in turn.
+ */
+typedef struct {
+        GstCaps  *container; /* NULL if there is no container */
+        GList    *video;     /* GstCaps of each video stream */
+        GList    *audio;     /* GstCaps of each audio stream */
+        gboolean is_image;
+} GUPnPDLNAStreamDescription;
+
+GUPnPDLNAStreamDescription *
+gupnp_dlna_stream_description_new (void);
+
+GUPnPDLNAStreamDescription *
+gupnp_dlna_stream_description_new_from_discoverer_info
+                                        (GstDiscovererInfo *info);
+
+GUPnPDLNAStreamDescription *
+gupnp_dlna_stream_description_new_from_summary (const GstStructure *summary,
+                                                gboolean           is_image);
+
+void
+gupnp_dlna_stream_description_free (GUPnPDLNAStreamDescription *desc);
+
+GstStructure *
+gupnp_dlna_stream_description_summarize
+                                (const GUPnPDLNAStreamDescription *desc,
+                                 const gchar                      *uri,
+                                 GstClockTime                     duration,
+                                 GstClockTime                     match_time);
+
+GstClockTime
+gupnp_dlna_stream_description_guess_profile
+                                (const GUPnPDLNAStreamDescription *desc,
+                                 const GUPnPDLNAProfileTable      *profiles,
+                                 GUPnPDLNAMatchStats              *stats,
+                                 gchar                            **name,
+                                 gchar                            **mime);
+
+GUPnPDLNATranscodeFlags
+gupnp_dlna_stream_description_get_transcode_flags
+                                (const GUPnPDLNAStreamDescription *desc,
+                                 const GUPnPDLNAProfileTable      *profiles,
+                                 guint                            i);
+
+gboolean
+gupnp_dlna_stream_description_stream_fits
+                                (GstCaps                     *caps,
+                                 const GUPnPDLNAProfileTable *profiles,
+                                 guint                       i,
+                                 gboolean                    video);
+
+G_GNUC_INTERNAL GUPnPDLNAInformation *
+gupnp_dlna_information_new_from_discoverer_info
+                                (GstDiscovererInfo           *info,
+                                 const GUPnPDLNAProfileTable *profiles,
+                                 GUPnPDLNAMatchStats         *stats,
+                                 gboolean                    keep_info);
+
+G_END_DECLS
+
+#endif /* __GUPNP_DLNA_STREAM_DESCRIPTION_H__ */
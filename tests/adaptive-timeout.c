@@ -0,0 +1,353 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Checks that a file slower than those GUPnPDLNADiscoverer has learnt its
+ * adaptive timeout from is still discovered: once enough fast files have been
+ * seen, a file that takes longer than the adaptive timeout times out with it,
+ * and must then be given the full timeout. The discoverer's timeout property
+ * must hold the value set by the application once discovery returns.
+ *
+ * The slow file is the same short WAV file as the fast ones, read through a
+ * source element registered by the test for the "gupnpdlnaslow" URI scheme,
+ * which holds back the first buffer for SLOW_DELAY. The WAV file is encoded
+ * with audiotestsrc and wavenc when the test starts. The test is skipped if
+ * those are not installed.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+#include <libgupnp-dlna/gupnp-dlna-discoverer.h>
+#include "test-util.h"
+
+/* Exit status telling automake that the test was skipped */
+#define EXIT_SKIP 77
+
+#define SLOW_SCHEME "gupnpdlnaslow"
+#define SLOW_DELAY (2 * GST_SECOND)
+#define FULL_TIMEOUT (10 * GST_SECOND)
+
+/* Enough fast discoveries for the adaptive timeout to kick in */
+#define N_FAST 40
+
+/* A filesrc followed by an identity element that sleeps when the first
+ * buffer goes through */
+typedef struct {
+        GstBin     parent;
+        GstElement *filesrc;
+        gchar      *uri;
+        gboolean   delayed;
+} SlowSrc;
+
+typedef struct {
+        GstBinClass parent_class;
+} SlowSrcClass;
+
+static void
+slow_src_uri_handler_init (gpointer g_iface, gpointer iface_data);
+
+G_DEFINE_TYPE_WITH_CODE (SlowSrc,
+                         slow_src,
+                         GST_TYPE_BIN,
+                         G_IMPLEMENT_INTERFACE (GST_TYPE_URI_HANDLER,
+                                                slow_src_uri_handler_init));
+
+static void
+slow_src_handoff_cb (GstElement *identity,
+                     GstBuffer  *buffer,
+                     SlowSrc    *self)
+{
+        if (!self->delayed) {
+                self->delayed = TRUE;
+                g_usleep (SLOW_DELAY / GST_USECOND);
+        }
+}
+
+static void
+slow_src_init (SlowSrc *self)
+{
+        GstElement *identity;
+        GstPad *pad, *ghost;
+
+        self->filesrc = gst_element_factory_make ("filesrc", NULL);
+        identity = gst_element_factory_make ("identity", NULL);
+        g_assert (self->filesrc && identity);
+
+        gst_bin_add_many (GST_BIN (self), self->filesrc, identity, NULL);
+        gst_element_link (self->filesrc, identity);
+        g_signal_connect (identity,
+                          "handoff",
+                          G_CALLBACK (slow_src_handoff_cb),
+                          self);
+
+        pad = gst_element_get_static_pad (identity, "src");
+        ghost = gst_ghost_pad_new ("src", pad);
+        gst_element_add_pad (GST_ELEMENT (self), ghost);
+        gst_object_unref (pad);
+}
+
+static void
+slow_src_finalize (GObject *object)
+{
+        SlowSrc *self = (SlowSrc *) object;
+
+        g_free (self->uri);
+
+        G_OBJECT_CLASS (slow_src_parent_class)->finalize (object);
+}
+
+static void
+slow_src_class_init (SlowSrcClass *klass)
+{
+        G_OBJECT_CLASS (klass)->finalize = slow_src_finalize;
+
+        gst_element_class_set_details_simple
+                                (GST_ELEMENT_CLASS (klass),
+                                 "Slow file source",
+                                 "Source/File",
+                                 "Reads a file, after holding back the first "
+                                 "buffer for a while",
+                                 "GUPnP DLNA tests");
+}
+
+static GstURIType
+slow_src_uri_get_type (void)
+{
+        return GST_URI_SRC;
+}
+
+static gchar **
+slow_src_uri_get_protocols (void)
+{
+        static gchar *protocols[] = { SLOW_SCHEME, NULL };
+
+        return protocols;
+}
+
+static const gchar *
+slow_src_uri_get_uri (GstURIHandler *handler)
+{
+        return ((SlowSrc *) handler)->uri;
+}
+
+/* SLOW_SCHEME://path reads the local file at path */
+static gboolean
+slow_src_uri_set_uri (GstURIHandler *handler, const gchar *uri)
+{
+        SlowSrc *self = (SlowSrc *) handler;
+
+        if (!g_str_has_prefix (uri, SLOW_SCHEME "://"))
+                return FALSE;
+
+        g_free (self->uri);
+        self->uri = g_strdup (uri);
+        g_object_set (self->filesrc,
+                      "location",
+                      uri + strlen (SLOW_SCHEME "://"),
+                      NULL);
+
+        return TRUE;
+}
+
+static void
+slow_src_uri_handler_init (gpointer g_iface, gpointer iface_data)
+{
+        GstURIHandlerInterface *iface = g_iface;
+
+        iface->get_type = slow_src_uri_get_type;
+        iface->get_protocols = slow_src_uri_get_protocols;
+        iface->get_uri = slow_src_uri_get_uri;
+        iface->set_uri = slow_src_uri_set_uri;
+}
+
+static void
+count_notify_cb (GObject *object, GParamSpec *pspec, guint *count)
+{
+        (*count)++;
+}
+
+/* The latency histogram of files that are not sniffed as anything, which
+ * both the WAV file and the slow URI are */
+static GstStructure *
+get_unknown_histogram (GUPnPDLNADiscoverer *discoverer)
+{
+        GList *histograms, *l;
+        GstStructure *ret = NULL;
+
+        histograms = gupnp_dlna_discoverer_get_latency_histograms (discoverer);
+
+        for (l = histograms; l; l = l->next) {
+                GstStructure *st = l->data;
+
+                if (!ret &&
+                    g_str_equal (gst_structure_get_string (st, "format"),
+                                 "unknown"))
+                        ret = st;
+                else
+                        gst_structure_free (st);
+        }
+
+        g_list_free (histograms);
+        g_assert (ret != NULL);
+
+        return ret;
+}
+
+static guint
+get_histogram_uint (GUPnPDLNADiscoverer *discoverer, const gchar *field)
+{
+        GstStructure *st = get_unknown_histogram (discoverer);
+        guint value;
+
+        g_assert (gst_structure_get_uint (st, field, &value));
+        gst_structure_free (st);
+
+        return value;
+}
+
+static GstClockTime
+get_adaptive_timeout (GUPnPDLNADiscoverer *discoverer)
+{
+        GstStructure *st = get_unknown_histogram (discoverer);
+        guint64 value;
+
+        g_assert (gst_structure_get_uint64 (st, "timeout", &value));
+        gst_structure_free (st);
+
+        return value;
+}
+
+int
+main (int argc, char **argv)
+{
+        GUPnPDLNADiscoverer *discoverer;
+        GUPnPDLNAInformation *dlna;
+        GstDiscovererInfo *info;
+        GError *error = NULL;
+        gchar *dir, *wav_path, *wav_uri, *slow_uri;
+        GstClockTime timeout;
+        guint i, notifies = 0;
+
+        if (!g_thread_supported ())
+                g_thread_init (NULL);
+
+        gst_init (&argc, &argv);
+
+        dir = g_build_filename (g_get_tmp_dir (),
+                                "gupnp-dlna-timeout-XXXXXX",
+                                NULL);
+        if (!mkdtemp (dir)) {
+                g_printerr ("Could not create a temporary directory\n");
+                return EXIT_FAILURE;
+        }
+
+        wav_path = g_build_filename (dir, "tone.wav", NULL);
+
+        if (!test_util_encode_wav (wav_path)) {
+                g_printerr ("Could not encode a WAV file, skipping\n");
+                g_unlink (wav_path);
+                g_rmdir (dir);
+                return EXIT_SKIP;
+        }
+
+        if (!gst_element_register (NULL,
+                                   "gupnpdlnaslowsrc",
+                                   GST_RANK_PRIMARY,
+                                   slow_src_get_type ()))
+                g_error ("Could not register the slow source");
+
+        wav_uri = g_filename_to_uri (wav_path, NULL, NULL);
+        slow_uri = g_strconcat (SLOW_SCHEME "://", wav_path, NULL);
+
+        discoverer = gupnp_dlna_discoverer_new (FULL_TIMEOUT, FALSE, FALSE);
+        g_object_set (discoverer, "adaptive-timeout", TRUE, NULL);
+        g_signal_connect (discoverer,
+                          "notify::timeout",
+                          G_CALLBACK (count_notify_cb),
+                          &notifies);
+
+        for (i = 0; i < N_FAST; i++) {
+                dlna = gupnp_dlna_discoverer_discover_uri_sync (discoverer,
+                                                                wav_uri,
+                                                                &error);
+                g_assert_no_error (error);
+                g_assert (dlna != NULL);
+                g_object_unref (dlna);
+
+                /* The timeout is only touched while it is shortened */
+                if (i == 0)
+                        g_assert_cmpuint (notifies, ==, 0);
+        }
+
+        if (get_adaptive_timeout (discoverer) >= SLOW_DELAY) {
+                g_printerr ("Discovery is too slow here for the adaptive "
+                            "timeout to be shorter than the slow file, "
+                            "skipping\n");
+                return EXIT_SKIP;
+        }
+
+        g_assert_cmpuint (get_histogram_uint (discoverer, "timeouts"), ==, 0);
+
+        /* Times out with the adaptive timeout, then gets the full one */
+        dlna = gupnp_dlna_discoverer_discover_uri_sync (discoverer,
+                                                        slow_uri,
+                                                        &error);
+        g_assert_no_error (error);
+        g_assert (dlna != NULL);
+        info = (GstDiscovererInfo *) gupnp_dlna_information_get_info (dlna);
+        g_assert (info != NULL);
+        g_assert_cmpint (gst_discoverer_info_get_result (info),
+                         ==,
+                         GST_DISCOVERER_OK);
+        g_object_unref (dlna);
+
+        g_assert_cmpuint (get_histogram_uint (discoverer, "timeouts"), ==, 1);
+        g_assert_cmpuint (get_histogram_uint (discoverer, "count"),
+                          ==,
+                          N_FAST + 1);
+
+        g_object_get (discoverer, "timeout", &timeout, NULL);
+        g_assert_cmpuint (timeout, ==, FULL_TIMEOUT);
+
+        /* Setting it is still taken into account */
+        g_object_set (discoverer, "timeout", 2 * FULL_TIMEOUT, NULL);
+        dlna = gupnp_dlna_discoverer_discover_uri_sync (discoverer,
+                                                        wav_uri,
+                                                        &error);
+        g_assert_no_error (error);
+        g_object_unref (dlna);
+        g_object_get (discoverer, "timeout", &timeout, NULL);
+        g_assert_cmpuint (timeout, ==, 2 * FULL_TIMEOUT);
+
+        g_object_unref (discoverer);
+
+        g_unlink (wav_path);
+        g_rmdir (dir);
+
+        g_free (slow_uri);
+        g_free (wav_uri);
+        g_free (wav_path);
+        g_free (dir);
+
+        return EXIT_SUCCESS;
+}
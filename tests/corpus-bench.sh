@@ -0,0 +1,72 @@
+#!/bin/bash
+
+#
+# Measures the end-to-end discovery throughput of gupnp-dlna-info over a
+# corpus made by make-corpus, in the synchronous, asynchronous and parallel
+# batch modes.
+#
+# Usage:
+#   corpus-bench.sh <corpus_dir> <extra_args ...>
+#
+# <extra_args> are passed on to gupnp-dlna-info. The numbers of jobs tried in
+# batch mode can be set with the JOBS environment variable (defaults to
+# "2 4" and the number of processors).
+#
+
+if [[ "x${GUPNP_DLNA_INFO}" = "x" ]]; then
+  GUPNP_DLNA_INFO=$(dirname ${0})/../tools/gupnp-dlna-info
+fi
+
+if [[ ${#} -lt 1 ]]; then
+  echo "Usage:"
+  echo "  ${0} <corpus_dir> <extra_args ...>"
+  exit -1
+fi
+
+CORPUS_DIR=${1}
+shift
+
+if [[ "x${JOBS}" = "x" ]]; then
+  JOBS="2 4 $(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)"
+fi
+
+files=()
+while IFS=',' read -r path profile mime; do
+  # Files that did not match their profile are commented out, but are still
+  # worth discovering
+  path=${path#\# }
+  if [[ "${path:0:1}" = "#" || "x${path}" = "x" ]]; then
+    continue
+  fi
+  files+=("${CORPUS_DIR}/${path}")
+done <${CORPUS_DIR}/media-list.txt
+
+if [[ ${#files[@]} -eq 0 ]]; then
+  echo "No files listed in ${CORPUS_DIR}/media-list.txt"
+  exit 1
+fi
+
+now () {
+  date +%s.%N
+}
+
+run () {
+  local name=${1}
+  shift
+
+  local start=$(now)
+  "${@}" >/dev/null 2>&1
+  local end=$(now)
+
+  awk -v name="${name}" -v n=${#files[@]} -v start=${start} -v end=${end} \
+    'BEGIN { t = end - start;
+             printf "%-12s %6d files in %8.3f s: %8.1f files/s\n",
+                    name, n, t, t > 0 ? n / t : 0 }'
+}
+
+run "sync" ${GUPNP_DLNA_INFO} --format=tsv ${@} "${files[@]}"
+run "async" ${GUPNP_DLNA_INFO} -a --format=tsv ${@} "${files[@]}"
+
+for jobs in $(echo ${JOBS} | tr ' ' '\n' | sort -n | uniq); do
+  run "-j ${jobs}" ${GUPNP_DLNA_INFO} -j ${jobs} ${@} "${files[@]}"
+done
@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Checks which synchronous discoveries end up in the result cache of
+ * GUPnPDLNADiscoverer: complete ones are served from it the next time, those
+ * that did not complete are discovered again, and switching the
+ * compact-results or fast-probe modes drops what was cached in the other
+ * mode. Cache hits must still count in the per-profile match statistics.
+ *
+ * The media is a short WAV file encoded with audiotestsrc and wavenc when
+ * the test starts. The test is skipped if those are not installed.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+#include <libgupnp-dlna/gupnp-dlna-discoverer.h>
+#include "test-util.h"
+
+/* Exit status telling automake that the test was skipped */
+#define EXIT_SKIP 77
+
+static guint
+get_uint (GUPnPDLNADiscoverer *discoverer, const gchar *property)
+{
+        guint value;
+
+        g_object_get (discoverer, property, &value, NULL);
+
+        return value;
+}
+
+/* Sums the "matches" field of the per-profile statistics */
+static guint
+count_profile_matches (GUPnPDLNADiscoverer *discoverer)
+{
+        GList *stats, *l;
+        guint total = 0;
+
+        stats = gupnp_dlna_discoverer_get_stats (discoverer);
+        for (l = stats; l; l = l->next) {
+                GstStructure *st = l->data;
+                guint matches;
+
+                if (gst_structure_has_name (st, "profile-stats") &&
+                    gst_structure_get_uint (st, "matches", &matches))
+                        total += matches;
+                gst_structure_free (st);
+        }
+        g_list_free (stats);
+
+        return total;
+}
+
+/* Discovers @uri, checking that it was (or was not) served from the cache */
+static GUPnPDLNAInformation *
+discover (GUPnPDLNADiscoverer *discoverer,
+          const gchar         *uri,
+          gboolean            cached)
+{
+        GUPnPDLNAInformation *dlna;
+        GError *error = NULL;
+        guint hits;
+
+        hits = get_uint (discoverer, "cache-hits");
+        dlna = gupnp_dlna_discoverer_discover_uri_sync (discoverer,
+                                                        uri,
+                                                        &error);
+        if (error)
+                g_error_free (error);
+
+        g_assert_cmpuint (get_uint (discoverer, "cache-hits"),
+                          ==,
+                          hits + (cached ? 1 : 0));
+
+        return dlna;
+}
+
+int
+main (int argc, char **argv)
+{
+        GUPnPDLNADiscoverer *discoverer;
+        GUPnPDLNAInformation *dlna;
+        gchar *dir, *wav_path, *junk_path, *wav_uri, *junk_uri;
+        guint8 junk[4096];
+        GRand *prng;
+        guint i, matches;
+
+        if (!g_thread_supported ())
+                g_thread_init (NULL);
+
+        gst_init (&argc, &argv);
+
+        dir = g_build_filename (g_get_tmp_dir (),
+                                "gupnp-dlna-cache-XXXXXX",
+                                NULL);
+        if (!mkdtemp (dir)) {
+                g_printerr ("Could not create a temporary directory\n");
+                return EXIT_FAILURE;
+        }
+
+        wav_path = g_build_filename (dir, "tone.wav", NULL);
+        junk_path = g_build_filename (dir, "junk.bin", NULL);
+
+        if (!test_util_encode_wav (wav_path)) {
+                g_printerr ("Could not encode a WAV file, skipping\n");
+                g_unlink (wav_path);
+                g_rmdir (dir);
+                return EXIT_SKIP;
+        }
+
+        /* Nothing can make sense of this, so discovery does not complete */
+        prng = g_rand_new_with_seed (42);
+        for (i = 0; i < sizeof (junk); i++)
+                junk[i] = g_rand_int_range (prng, 0, 256);
+        g_rand_free (prng);
+        if (!g_file_set_contents (junk_path,
+                                  (const gchar *) junk,
+                                  sizeof (junk),
+                                  NULL))
+                g_error ("Could not write %s", junk_path);
+
+        wav_uri = g_filename_to_uri (wav_path, NULL, NULL);
+        junk_uri = g_filename_to_uri (junk_path, NULL, NULL);
+
+        discoverer = gupnp_dlna_discoverer_new (5 * GST_SECOND, FALSE, FALSE);
+        g_object_set (discoverer,
+                      "cache-size", 1 << 20,
+                      "collect-stats", TRUE,
+                      NULL);
+
+        dlna = discover (discoverer, wav_uri, FALSE);
+        g_assert (dlna != NULL);
+        g_assert (gupnp_dlna_information_get_info (dlna) != NULL);
+        g_object_unref (dlna);
+        matches = count_profile_matches (discoverer);
+
+        /* The profile the file was given is counted again */
+        dlna = discover (discoverer, wav_uri, TRUE);
+        g_assert_cmpuint (count_profile_matches (discoverer),
+                          ==,
+                          matches * 2);
+        g_object_unref (dlna);
+
+        /* Incomplete results are retried every time */
+        for (i = 0; i < 2; i++) {
+                dlna = discover (discoverer, junk_uri, FALSE);
+                if (dlna) {
+                        g_assert (gupnp_dlna_information_get_info (dlna) ==
+                                  NULL ||
+                                  gst_discoverer_info_get_result
+                                        (gupnp_dlna_information_get_info
+                                                                (dlna)) !=
+                                  GST_DISCOVERER_OK);
+                        g_object_unref (dlna);
+                }
+        }
+
+        /* Compact results must not be returned once they are not wanted any
+         * more, nor full ones while they are */
+        g_object_set (discoverer, "compact-results", TRUE, NULL);
+        dlna = discover (discoverer, wav_uri, FALSE);
+        g_assert (gupnp_dlna_information_get_info (dlna) == NULL);
+        g_object_unref (dlna);
+
+        dlna = discover (discoverer, wav_uri, TRUE);
+        g_object_unref (dlna);
+
+        g_object_set (discoverer, "compact-results", FALSE, NULL);
+        dlna = discover (discoverer, wav_uri, FALSE);
+        g_assert (gupnp_dlna_information_get_info (dlna) != NULL);
+        g_object_unref (dlna);
+
+        g_object_set (discoverer, "fast-probe", TRUE, NULL);
+        dlna = discover (discoverer, wav_uri, FALSE);
+        g_object_unref (dlna);
+
+        g_object_unref (discoverer);
+
+        g_unlink (junk_path);
+        g_unlink (wav_path);
+        g_rmdir (dir);
+
+        g_free (junk_uri);
+        g_free (wav_uri);
+        g_free (junk_path);
+        g_free (wav_path);
+        g_free (dir);
+
+        return EXIT_SUCCESS;
+}
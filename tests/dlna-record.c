@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Round-trips a GUPnPDLNAInformation through the binary record format and
+ * checks that damaged, truncated or misaligned records are rejected.
+ */
+
+#include <gst/gst.h>
+#include <libgupnp-dlna/gupnp-dlna-information.h>
+#include <libgupnp-dlna/gupnp-dlna-record.h>
+#include <stdlib.h>
+#include <string.h>
+
+static GUPnPDLNAInformation *
+make_information (void)
+{
+        GUPnPDLNAInformation *dlna;
+        GstStructure *summary;
+
+        summary = gst_structure_new ("gupnp-dlna-summary",
+                                     "uri", G_TYPE_STRING,
+                                     "file:///media/\"clip\".mp4",
+                                     "duration", G_TYPE_UINT64,
+                                     (guint64) 5 * GST_SECOND,
+                                     "container-format", G_TYPE_STRING,
+                                     "video/quicktime",
+                                     "video-format", G_TYPE_STRING,
+                                     "video/x-h264",
+                                     "width", G_TYPE_INT, 640,
+                                     "height", G_TYPE_INT, 480,
+                                     "framerate", GST_TYPE_FRACTION, 30000,
+                                     1001,
+                                     "audio-format", G_TYPE_STRING,
+                                     "audio/mpeg",
+                                     "rate", G_TYPE_INT, 48000,
+                                     "channels", G_TYPE_INT, 2,
+                                     NULL);
+
+        dlna = g_object_new (GUPNP_TYPE_DLNA_INFORMATION,
+                             "name", "AVC_MP4_BL_CIF15_AAC_520",
+                             "mime", "video/mp4",
+                             "summary", summary,
+                             NULL);
+        gst_structure_free (summary);
+
+        return dlna;
+}
+
+static void
+check_record (const GUPnPDLNARecord *record)
+{
+        g_assert (record != NULL);
+        g_assert_cmpstr (gupnp_dlna_record_get_name (record),
+                         ==,
+                         "AVC_MP4_BL_CIF15_AAC_520");
+        g_assert_cmpstr (gupnp_dlna_record_get_mime (record), ==, "video/mp4");
+        g_assert_cmpstr (gupnp_dlna_record_get_uri (record),
+                         ==,
+                         "file:///media/\"clip\".mp4");
+        g_assert_cmpuint (gupnp_dlna_record_get_duration (record),
+                          ==,
+                          5 * GST_SECOND);
+        g_assert_cmpstr (gupnp_dlna_record_get_container_format (record),
+                         ==,
+                         "video/quicktime");
+        g_assert_cmpstr (gupnp_dlna_record_get_video_format (record),
+                         ==,
+                         "video/x-h264");
+        g_assert_cmpstr (gupnp_dlna_record_get_audio_format (record),
+                         ==,
+                         "audio/mpeg");
+        g_assert_cmpint (gupnp_dlna_record_get_width (record), ==, 640);
+        g_assert_cmpint (gupnp_dlna_record_get_height (record), ==, 480);
+        g_assert_cmpint (gupnp_dlna_record_get_rate (record), ==, 48000);
+        g_assert_cmpint (gupnp_dlna_record_get_channels (record), ==, 2);
+}
+
+int
+main (int argc, char **argv)
+{
+        GUPnPDLNAInformation *dlna, *copy;
+        const GUPnPDLNARecord *record;
+        const GstStructure *summary;
+        guint8 *data, *stream;
+        gsize size, record_size;
+        gint num, denom;
+        gchar *json;
+
+        gst_init (&argc, &argv);
+
+        dlna = make_information ();
+        data = gupnp_dlna_information_to_record (dlna, &size);
+        g_assert (size % 8 == 0);
+
+        record = gupnp_dlna_record_from_data (data, size, &record_size);
+        g_assert_cmpuint (record_size, ==, size);
+        check_record (record);
+
+        /* Two records back to back */
+        stream = g_malloc (2 * size);
+        memcpy (stream, data, size);
+        memcpy (stream + size, data, size);
+        record = gupnp_dlna_record_from_data (stream, 2 * size, &record_size);
+        check_record (record);
+        check_record (gupnp_dlna_record_from_data (stream + record_size,
+                                                   2 * size - record_size,
+                                                   NULL));
+        g_free (stream);
+
+        /* A valid record that is not 8-byte aligned */
+        stream = g_malloc (size + 8);
+        memcpy (stream + 4, data, size);
+        g_assert (gupnp_dlna_record_from_data (stream + 4, size, NULL) ==
+                  NULL);
+        g_free (stream);
+
+        copy = gupnp_dlna_record_to_information (record);
+        g_assert_cmpstr (gupnp_dlna_information_get_name (copy),
+                         ==,
+                         "AVC_MP4_BL_CIF15_AAC_520");
+        g_assert_cmpuint (gupnp_dlna_information_get_duration (copy),
+                          ==,
+                          5 * GST_SECOND);
+        summary = gupnp_dlna_information_get_summary (copy);
+        g_assert (gst_structure_get_fraction (summary,
+                                              "framerate",
+                                              &num,
+                                              &denom));
+        g_assert_cmpint (num, ==, 30000);
+        g_assert_cmpint (denom, ==, 1001);
+        g_object_unref (copy);
+
+        json = gupnp_dlna_information_to_json (dlna);
+        g_assert (strstr (json, "\"name\": \"AVC_MP4_BL_CIF15_AAC_520\""));
+        g_assert (strstr (json, "\\\"clip\\\""));
+        g_assert (strstr (json, "\"duration\": 5000000000"));
+        g_assert (strstr (json, "\"framerate\": \"30000/1001\""));
+        g_assert (!strstr (json, "video-bitrate"));
+        g_free (json);
+
+        /* Truncated records */
+        g_assert (gupnp_dlna_record_from_data (data, size - 8, NULL) == NULL);
+        g_assert (gupnp_dlna_record_from_data (data, 16, NULL) == NULL);
+
+        /* Wrong magic, then wrong version */
+        data[0] ^= 0xff;
+        g_assert (gupnp_dlna_record_from_data (data, size, NULL) == NULL);
+        data[0] ^= 0xff;
+        data[4] ^= 0xff;
+        g_assert (gupnp_dlna_record_from_data (data, size, NULL) == NULL);
+        data[4] ^= 0xff;
+
+        /* A string that is not terminated inside the record */
+        memset (data + size - 8, 'x', 8);
+        g_assert (gupnp_dlna_record_from_data (data, size, NULL) == NULL);
+
+        g_free (data);
+        g_object_unref (dlna);
+
+        return EXIT_SUCCESS;
+}
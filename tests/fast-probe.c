@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Checks the caps that the fast probe finds for constant bitrate MP3
+ * streams of each MPEG audio version. The streams are made of mono Layer III
+ * frame headers followed by silence, which is all the fast probe looks at.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+#include <libgupnp-dlna/fast-probe.h>
+
+#define N_FRAMES 64
+
+typedef struct {
+        guint8 version;         /* version bits of the header */
+        guint8 bitrate_index;
+        guint8 rate_index;
+        gint   mpegaudioversion;
+        gint   rate;
+        gint   bitrate;
+        guint  length;          /* of each frame, in bytes */
+} TestStream;
+
+static const TestStream test_streams[] = {
+        /* MPEG-1 */
+        { 3, 9, 0, 1, 44100, 128000, 144 * 128000 / 44100 },
+        /* MPEG-2 */
+        { 2, 8, 0, 2, 22050, 64000, 72 * 64000 / 22050 },
+        /* MPEG-2.5 */
+        { 0, 8, 0, 3, 11025, 64000, 72 * 64000 / 11025 },
+        { 0, 8, 1, 3, 12000, 64000, 72 * 64000 / 12000 },
+        { 0, 8, 2, 3, 8000, 64000, 72 * 64000 / 8000 },
+};
+
+static gchar *
+write_stream (const gchar *dir, const TestStream *stream)
+{
+        guint8 *data;
+        gsize size;
+        gchar *path;
+        guint i;
+
+        size = stream->length * N_FRAMES;
+        data = g_malloc0 (size);
+
+        for (i = 0; i < N_FRAMES; i++) {
+                guint8 *header = data + i * stream->length;
+
+                /* Layer III without CRC, no padding, mono */
+                header[0] = 0xff;
+                header[1] = 0xe0 | (stream->version << 3) | (1 << 1) | 1;
+                header[2] = (stream->bitrate_index << 4) |
+                            (stream->rate_index << 2);
+                header[3] = 0xc0;
+        }
+
+        path = g_build_filename (dir, "stream.mp3", NULL);
+        if (!g_file_set_contents (path, (const gchar *) data, size, NULL))
+                g_error ("Could not write %s", path);
+        g_free (data);
+
+        return path;
+}
+
+static gint
+get_int (const GstStructure *st, const gchar *field)
+{
+        gint value;
+
+        g_assert (gst_structure_get_int (st, field, &value));
+
+        return value;
+}
+
+static void
+check_stream (const gchar *dir, const TestStream *stream)
+{
+        GUPnPDLNAStreamDescription *desc;
+        const GstStructure *st;
+        gchar *path, *uri;
+
+        path = write_stream (dir, stream);
+        uri = g_filename_to_uri (path, NULL, NULL);
+
+        desc = gupnp_dlna_fast_probe_uri (uri);
+        g_assert (desc != NULL);
+        g_assert (desc->container == NULL);
+        g_assert_cmpuint (g_list_length (desc->audio), ==, 1);
+
+        st = gst_caps_get_structure (GST_CAPS (desc->audio->data), 0);
+        g_assert (gst_structure_has_name (st, "audio/mpeg"));
+        g_assert_cmpint (get_int (st, "mpegversion"), ==, 1);
+        g_assert_cmpint (get_int (st, "layer"), ==, 3);
+        g_assert_cmpint (get_int (st, "mpegaudioversion"),
+                         ==,
+                         stream->mpegaudioversion);
+        g_assert_cmpint (get_int (st, "rate"), ==, stream->rate);
+        g_assert_cmpint (get_int (st, "channels"), ==, 1);
+        g_assert_cmpint (get_int (st, "bitrate"), ==, stream->bitrate);
+
+        gupnp_dlna_stream_description_free (desc);
+
+        g_unlink (path);
+        g_free (uri);
+        g_free (path);
+}
+
+int
+main (int argc, char **argv)
+{
+        gchar *dir;
+        guint i;
+
+        gst_init (&argc, &argv);
+
+        dir = g_build_filename (g_get_tmp_dir (),
+                                "gupnp-dlna-probe-XXXXXX",
+                                NULL);
+        if (!mkdtemp (dir)) {
+                g_printerr ("Could not create a temporary directory\n");
+                return EXIT_FAILURE;
+        }
+
+        for (i = 0; i < G_N_ELEMENTS (test_streams); i++)
+                check_stream (dir, &test_streams[i]);
+
+        g_rmdir (dir);
+        g_free (dir);
+
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Runs the profile matcher over a fixed set of synthetic stream descriptions
+ * and profiles many times over, counting the GLib allocations that are
+ * still live after each round. Once the first rounds have warmed up GLib and
+ * GStreamer's caches (quarks, types, ...) that count must not grow any more.
+ *
+ * GstDiscovererInfo cannot be built outside of GstDiscoverer, so the stream
+ * descriptions that the matcher works on are built directly instead.
+ */
+
+#include <gst/gst.h>
+#include <gst/pbutils/pbutils.h>
+#include <libgupnp-dlna/gupnp-dlna-profile.h>
+#include <libgupnp-dlna/profile-registry.h>
+#include <libgupnp-dlna/match-stats.h>
+#include <libgupnp-dlna/stream-description.h>
+#include <stdlib.h>
+#include "test-util.h"
+
+#define WARMUP_ROUNDS 10
+#define CHECKED_ROUNDS 100
+
+static const TestProfile test_profiles[] = {
+        { "JPEG_SM", "image/jpeg",
+          NULL,
+          "image/jpeg, width=(int)[ 1, 640 ], height=(int)[ 1, 480 ]",
+          NULL },
+        { "MP3", "audio/mpeg",
+          NULL,
+          NULL,
+          "audio/mpeg, mpegversion=(int)1, layer=(int)3, "
+          "rate=(int){ 32000, 44100, 48000 }, channels=(int)[ 1, 2 ], "
+          "bitrate=(int)[ 32000, 320000 ]" },
+        { "AAC_ADTS_320", "audio/vnd.dlna.adts",
+          "audio/mpeg, mpegversion=(int){ 2, 4 }, "
+          "stream-format=(string)adts",
+          NULL,
+          "audio/mpeg, mpegversion=(int){ 2, 4 }, "
+          "rate=(int)[ 8000, 48000 ], channels=(int)[ 1, 2 ], "
+          "bitrate=(int)[ 1, 320000 ]" },
+        { "", "",
+          "video/quicktime, variant=(string)iso",
+          "video/x-h264, width=(int)[ 1, 1920 ]",
+          NULL },
+        { "AVC_MP4_MP_SD_AAC_MULT5", "video/mp4",
+          "video/quicktime, variant=(string)iso",
+          "video/x-h264, width=(int)[ 1, 720 ], height=(int)[ 1, 576 ], "
+          "framerate=(fraction)[ 0/1, 30/1 ]",
+          "audio/mpeg, mpegversion=(int)4, channels=(int)[ 1, 6 ]" },
+};
+
+static const TestStream test_streams[] = {
+        { NULL,
+          "image/jpeg, width=(int)640, height=(int)480",
+          NULL,
+          TRUE },
+        { NULL,
+          "image/jpeg, width=(int)4000, height=(int)3000",
+          NULL,
+          TRUE },
+        { NULL,
+          NULL,
+          "audio/mpeg, mpegversion=(int)1, layer=(int)3, rate=(int)44100, "
+          "channels=(int)2, bitrate=(int)128000",
+          FALSE },
+        { "audio/mpeg, mpegversion=(int)4, stream-format=(string)adts",
+          NULL,
+          "audio/mpeg, mpegversion=(int)4, rate=(int)48000, "
+          "channels=(int)2, bitrate=(int)128000",
+          FALSE },
+        { "video/quicktime, variant=(string)iso",
+          "video/x-h264, width=(int)720, height=(int)576, "
+          "framerate=(fraction)25/1",
+          "audio/mpeg, mpegversion=(int)4, channels=(int)2",
+          FALSE },
+        { "video/quicktime, variant=(string)iso",
+          "video/x-h264, width=(int)1920, height=(int)1080, "
+          "framerate=(fraction)25/1",
+          "audio/mpeg, mpegversion=(int)4, channels=(int)2",
+          FALSE },
+};
+
+static volatile gint live_allocations = 0;
+
+static gpointer
+counting_malloc (gsize n_bytes)
+{
+        g_atomic_int_inc (&live_allocations);
+
+        return malloc (n_bytes);
+}
+
+static gpointer
+counting_calloc (gsize n_blocks, gsize n_block_bytes)
+{
+        g_atomic_int_inc (&live_allocations);
+
+        return calloc (n_blocks, n_block_bytes);
+}
+
+static gpointer
+counting_realloc (gpointer mem, gsize n_bytes)
+{
+        if (!mem)
+                g_atomic_int_inc (&live_allocations);
+
+        return realloc (mem, n_bytes);
+}
+
+static void
+counting_free (gpointer mem)
+{
+        if (mem)
+                g_atomic_int_add (&live_allocations, -1);
+
+        free (mem);
+}
+
+static GMemVTable counting_vtable = {
+        counting_malloc,
+        counting_realloc,
+        counting_free,
+        counting_calloc,
+        counting_malloc,
+        counting_realloc
+};
+
+/* Everything that is done for each file, from the stream description to
+ * the result handed to the application */
+static void
+run_round (GUPnPDLNAProfileRegistry *registry, GUPnPDLNAMatchStats *stats)
+{
+        const gchar *names[] = { "MP3", "JPEG_SM", "UNKNOWN", NULL };
+        GList *found = NULL;
+        guint i;
+
+        for (i = 0; i < G_N_ELEMENTS (test_streams); i++) {
+                GUPnPDLNAStreamDescription *desc;
+                GUPnPDLNAInformation *dlna;
+                gchar *name = NULL, *mime = NULL;
+
+                desc = test_util_describe (&test_streams[i]);
+                gupnp_dlna_stream_description_guess_profile
+                                (desc,
+                                 gupnp_dlna_profile_registry_get_table
+                                                (registry),
+                                 stats,
+                                 &name,
+                                 &mime);
+                gupnp_dlna_stream_description_free (desc);
+
+                dlna = gupnp_dlna_information_new (name, mime, NULL);
+                g_object_unref (dlna);
+
+                g_free (name);
+                g_free (mime);
+        }
+
+        for (i = 0; names[i]; i++) {
+                GUPnPDLNAProfile *profile;
+
+                profile = gupnp_dlna_profile_registry_lookup (registry,
+                                                              names[i]);
+                if (profile) {
+                        GstEncodingProfile *enc_profile;
+
+                        enc_profile =
+                                gupnp_dlna_profile_get_encoding_profile
+                                                                (profile);
+                        gst_encoding_profile_unref (enc_profile);
+
+                        found = g_list_prepend (found,
+                                                g_object_ref (profile));
+                }
+        }
+
+        g_list_foreach (found, (GFunc) g_object_unref, NULL);
+        g_list_free (found);
+
+        found = gupnp_dlna_match_stats_to_structures (stats);
+        g_list_foreach (found, (GFunc) gst_structure_free, NULL);
+        g_list_free (found);
+}
+
+int
+main (int argc, char **argv)
+{
+        GUPnPDLNAProfileRegistry *registry;
+        GUPnPDLNAMatchStats *stats;
+        gint baseline, round, grown = 0;
+        gpointer probe;
+
+        /* GSlice would keep freed memory around in its own magazines,
+         * hiding it from the counters */
+        setenv ("G_SLICE", "always-malloc", 1);
+        g_mem_set_vtable (&counting_vtable);
+
+        /* GLib may have been built to ignore the vtable */
+        baseline = g_atomic_int_get (&live_allocations);
+        probe = g_malloc (1);
+        if (g_atomic_int_get (&live_allocations) == baseline) {
+                g_print ("SKIP: GLib allocations cannot be counted\n");
+                return 77;
+        }
+        g_free (probe);
+
+        if (!g_thread_supported ())
+                g_thread_init (NULL);
+
+        gst_init (&argc, &argv);
+
+        registry = gupnp_dlna_profile_registry_new
+                        (test_util_build_profiles
+                                (test_profiles,
+                                 G_N_ELEMENTS (test_profiles)));
+
+        /* Once every profile has been seen, collecting statistics must not
+         * allocate any more either */
+        stats = gupnp_dlna_match_stats_new ();
+
+        for (round = 0; round < WARMUP_ROUNDS; round++)
+                run_round (registry, stats);
+
+        baseline = g_atomic_int_get (&live_allocations);
+
+        for (round = 0; round < CHECKED_ROUNDS; round++) {
+                gint live;
+
+                run_round (registry, stats);
+
+                live = g_atomic_int_get (&live_allocations);
+                if (live != baseline) {
+                        g_printerr ("Round %d: %d allocations still live, "
+                                    "%d expected\n",
+                                    round,
+                                    live,
+                                    baseline);
+                        grown++;
+                }
+        }
+
+        gupnp_dlna_match_stats_free (stats);
+        gupnp_dlna_profile_registry_unref (registry);
+
+        if (grown) {
+                g_printerr ("FAIL: allocations grew in %d of %d rounds\n",
+                            grown,
+                            CHECKED_ROUNDS);
+                return EXIT_FAILURE;
+        }
+
+        g_print ("PASS: no growth over %d rounds\n", CHECKED_ROUNDS);
+
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,544 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Measures how long loading the DLNA profiles takes and how much memory it
+ * needs, in each of the four relaxed/extended modes:
+ *
+ *   - the time to the first gupnp_dlna_discoverer_new(), whose class
+ *     initialisation loads the installed profiles in all four modes
+ *   - the first (cold) and the following (warm) loads of the profiles in the
+ *     given directory, and of copies of it scaled up 10 and 100 times
+ *   - the peak amount of memory allocated while loading
+ *
+ * With --baseline, the warm load times are compared to the ones saved in a
+ * key file by --save-baseline, and the program fails if any of them is more
+ * than --margin percent slower. Memory is counted through GLib and libxml,
+ * and only when GSlice is told to use malloc (G_SLICE=always-malloc) and the
+ * C library can tell the size of an allocation.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef HAVE_MALLOC_H
+#include <malloc.h>
+#endif
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+#include <libxml/xmlmemory.h>
+#include <libgupnp-dlna/gupnp-dlna-discoverer.h>
+#include <libgupnp-dlna/profile-loading.h>
+
+#define BASELINE_GROUP "loading"
+
+static gint n_iterations = 3;
+static gchar *scales_str = "1,10,100";
+static gchar *baseline = NULL;
+static gchar *save_baseline = NULL;
+static gdouble margin = 20.0;
+
+static const gchar *mode_names[2][2] = {
+        { "strict", "strict-extended" },
+        { "relaxed", "relaxed-extended" }
+};
+
+#ifdef HAVE_MALLOC_USABLE_SIZE
+
+/* Signed, as memory that the C library allocated may be freed through GLib
+ * without having been counted */
+static volatile gssize allocated = 0;
+static volatile gssize peak = 0;
+
+static void
+count_allocation (gpointer mem)
+{
+        if (!mem)
+                return;
+
+        allocated += malloc_usable_size (mem);
+        if (allocated > peak)
+                peak = allocated;
+}
+
+static void
+count_free (gpointer mem)
+{
+        if (mem)
+                allocated -= malloc_usable_size (mem);
+}
+
+static gpointer
+counting_malloc (gsize n_bytes)
+{
+        gpointer mem = malloc (n_bytes);
+
+        count_allocation (mem);
+
+        return mem;
+}
+
+static gpointer
+counting_realloc (gpointer mem, gsize n_bytes)
+{
+        count_free (mem);
+        mem = realloc (mem, n_bytes);
+        count_allocation (mem);
+
+        return mem;
+}
+
+static gpointer
+counting_calloc (gsize n_blocks, gsize n_block_bytes)
+{
+        gpointer mem = calloc (n_blocks, n_block_bytes);
+
+        count_allocation (mem);
+
+        return mem;
+}
+
+static void
+counting_free (gpointer mem)
+{
+        count_free (mem);
+        free (mem);
+}
+
+static void *
+counting_xml_malloc (size_t size)
+{
+        return counting_malloc (size);
+}
+
+static void *
+counting_xml_realloc (void *mem, size_t size)
+{
+        return counting_realloc (mem, size);
+}
+
+static char *
+counting_xml_strdup (const char *str)
+{
+        gsize size = strlen (str) + 1;
+        gchar *copy = counting_malloc (size);
+
+        if (copy)
+                memcpy (copy, str, size);
+
+        return copy;
+}
+
+static GMemVTable counting_vtable = {
+        counting_malloc,
+        counting_realloc,
+        counting_free,
+        counting_calloc,
+        counting_malloc,
+        counting_realloc
+};
+
+static void
+setup_memory_counting (void)
+{
+        g_mem_set_vtable (&counting_vtable);
+        xmlMemSetup (counting_free,
+                     counting_xml_malloc,
+                     counting_xml_realloc,
+                     counting_xml_strdup);
+}
+
+/* Restarts measuring the peak of allocated memory from now */
+static void
+reset_peak (void)
+{
+        peak = allocated;
+}
+
+/* Returns the highest amount of memory allocated since reset_peak() on top
+ * of what was allocated then */
+static gsize
+get_peak (gssize before)
+{
+        return peak > before ? peak - before : 0;
+}
+
+static gssize
+get_allocated (void)
+{
+        return allocated;
+}
+
+#else
+
+static void
+setup_memory_counting (void)
+{
+}
+
+static void
+reset_peak (void)
+{
+}
+
+static gsize
+get_peak (gssize before)
+{
+        return 0;
+}
+
+static gssize
+get_allocated (void)
+{
+        return 0;
+}
+
+#endif /* HAVE_MALLOC_USABLE_SIZE */
+
+static void
+free_profiles (GList *profiles)
+{
+        g_list_foreach (profiles, (GFunc) g_object_unref, NULL);
+        g_list_free (profiles);
+}
+
+/* Copies the profile files of @profile_dir @scale times into a new temporary
+ * directory. Includes still refer to the installed files, so only the
+ * top-level files are multiplied. */
+static gchar *
+make_scaled_dir (const gchar *profile_dir, guint scale)
+{
+        gchar *dir_name;
+        GDir *dir;
+        const gchar *entry;
+
+        dir_name = g_build_filename (g_get_tmp_dir (),
+                                     "gupnp-dlna-bench-XXXXXX",
+                                     NULL);
+        if (!mkdtemp (dir_name)) {
+                g_printerr ("Could not create a temporary directory\n");
+                exit (EXIT_FAILURE);
+        }
+
+        dir = g_dir_open (profile_dir, 0, NULL);
+
+        while (dir && (entry = g_dir_read_name (dir))) {
+                gchar *path, *contents;
+                gsize length;
+                guint i;
+
+                if (!g_str_has_suffix (entry, ".xml"))
+                        continue;
+
+                path = g_build_filename (profile_dir, entry, NULL);
+
+                if (g_file_get_contents (path, &contents, &length, NULL)) {
+                        for (i = 0; i < scale; i++) {
+                                gchar *name, *copy;
+
+                                name = g_strdup_printf ("%03u-%s", i, entry);
+                                copy = g_build_filename (dir_name, name, NULL);
+                                g_file_set_contents (copy,
+                                                     contents,
+                                                     length,
+                                                     NULL);
+                                g_free (copy);
+                                g_free (name);
+                        }
+
+                        g_free (contents);
+                }
+
+                g_free (path);
+        }
+
+        if (dir)
+                g_dir_close (dir);
+
+        return dir_name;
+}
+
+static void
+remove_scaled_dir (gchar *dir_name)
+{
+        GDir *dir = g_dir_open (dir_name, 0, NULL);
+        const gchar *entry;
+
+        while (dir && (entry = g_dir_read_name (dir))) {
+                gchar *path = g_build_filename (dir_name, entry, NULL);
+
+                g_unlink (path);
+                g_free (path);
+        }
+
+        if (dir)
+                g_dir_close (dir);
+
+        g_rmdir (dir_name);
+        g_free (dir_name);
+}
+
+/* Returns the time a load took, and keeps the highest peak of allocated
+ * memory in @peak_bytes */
+static GstClockTime
+time_load (const gchar *profile_dir,
+           gboolean    relaxed_mode,
+           gboolean    extended_mode,
+           guint       *n_profiles,
+           gsize       *peak_bytes)
+{
+        GstClockTime start, elapsed;
+        GList *profiles;
+        gssize before;
+
+        before = get_allocated ();
+        reset_peak ();
+        start = gst_util_get_timestamp ();
+
+        profiles = gupnp_dlna_load_profiles_from_path (profile_dir,
+                                                       relaxed_mode,
+                                                       extended_mode);
+
+        elapsed = gst_util_get_timestamp () - start;
+        *peak_bytes = MAX (*peak_bytes, get_peak (before));
+        *n_profiles = g_list_length (profiles);
+
+        free_profiles (profiles);
+
+        return elapsed;
+}
+
+/* Returns FALSE if the warm time regressed against the baseline */
+static gboolean
+check_baseline (GKeyFile    *key_file,
+                const gchar *key,
+                GstClockTime warm)
+{
+        GError *err = NULL;
+        gdouble expected, limit, measured;
+
+        if (!key_file)
+                return TRUE;
+
+        expected = g_key_file_get_double (key_file,
+                                          BASELINE_GROUP,
+                                          key,
+                                          &err);
+        if (err) {
+                g_error_free (err);
+                return TRUE;
+        }
+
+        measured = (gdouble) warm / GST_MSECOND;
+        limit = expected * (1.0 + margin / 100.0);
+
+        if (measured <= limit)
+                return TRUE;
+
+        g_print ("  REGRESSION: %s took %.2f ms, the baseline is %.2f ms "
+                 "(+%.0f%% allowed)\n",
+                 key,
+                 measured,
+                 expected,
+                 margin);
+
+        return FALSE;
+}
+
+static gboolean
+bench_dir (const gchar *profile_dir,
+           guint       scale,
+           GKeyFile    *baseline_file,
+           GKeyFile    *results)
+{
+        gboolean ok = TRUE;
+        guint relaxed, extended;
+
+        for (relaxed = 0; relaxed < 2; relaxed++) {
+                for (extended = 0; extended < 2; extended++) {
+                        GstClockTime cold, warm = 0;
+                        guint n_profiles;
+                        gsize peak_bytes = 0;
+                        gchar *key;
+                        gint i;
+
+                        cold = time_load (profile_dir,
+                                          relaxed,
+                                          extended,
+                                          &n_profiles,
+                                          &peak_bytes);
+
+                        for (i = 0; i < n_iterations; i++)
+                                warm += time_load (profile_dir,
+                                                   relaxed,
+                                                   extended,
+                                                   &n_profiles,
+                                                   &peak_bytes);
+                        if (n_iterations > 0)
+                                warm /= n_iterations;
+                        else
+                                warm = cold;
+
+                        key = g_strdup_printf ("%ux-%s",
+                                               scale,
+                                               mode_names[relaxed][extended]);
+
+                        g_print ("%-22s %5u profiles  cold %9.2f ms  "
+                                 "warm %9.2f ms  peak %8" G_GSIZE_FORMAT
+                                 " kB\n",
+                                 key,
+                                 n_profiles,
+                                 (gdouble) cold / GST_MSECOND,
+                                 (gdouble) warm / GST_MSECOND,
+                                 peak_bytes / 1024);
+
+                        ok &= check_baseline (baseline_file, key, warm);
+                        g_key_file_set_double (results,
+                                               BASELINE_GROUP,
+                                               key,
+                                               (gdouble) warm / GST_MSECOND);
+
+                        g_free (key);
+                }
+        }
+
+        return ok;
+}
+
+int
+main (int argc, char **argv)
+{
+        GUPnPDLNADiscoverer *discoverer;
+        GKeyFile *baseline_file = NULL, *results;
+        GstClockTime start;
+        GError *err = NULL;
+        GOptionContext *ctx;
+        gchar **scales;
+        gboolean ok = TRUE;
+        guint i;
+
+        GOptionEntry options[] = {
+                {"iterations", 'n', 0, G_OPTION_ARG_INT, &n_iterations,
+                 "Number of warm loads to average", NULL},
+                {"scales", 's', 0, G_OPTION_ARG_STRING, &scales_str,
+                 "Comma-separated numbers of copies of the profiles to "
+                 "load (defaults to 1,10,100)", "LIST"},
+                {"baseline", 'b', 0, G_OPTION_ARG_FILENAME, &baseline,
+                 "Fail if a warm load is slower than in FILE", "FILE"},
+                {"margin", 'm', 0, G_OPTION_ARG_DOUBLE, &margin,
+                 "Slowdown allowed against the baseline, in percent "
+                 "(defaults to 20)", "PERCENT"},
+                {"save-baseline", 'S', 0, G_OPTION_ARG_FILENAME,
+                 &save_baseline,
+                 "Save the warm load times to FILE", "FILE"},
+                {NULL}
+        };
+
+        /* Must come before anything is allocated */
+        setup_memory_counting ();
+
+        if (!g_thread_supported ())
+                g_thread_init (NULL);
+
+        ctx = g_option_context_new (" profile-dir - benchmark loading the "
+                                    "DLNA profiles");
+        g_option_context_add_main_entries (ctx, options, NULL);
+        g_option_context_add_group (ctx, gst_init_get_option_group ());
+
+        if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+                g_print ("Error initializing: %s\n", err->message);
+                exit (1);
+        }
+
+        g_option_context_free (ctx);
+
+        if (argc < 2) {
+                g_print ("Usage: loading-bench [options] profile-dir\n");
+                return EXIT_FAILURE;
+        }
+
+        gst_init (&argc, &argv);
+
+        if (baseline) {
+                baseline_file = g_key_file_new ();
+                if (!g_key_file_load_from_file (baseline_file,
+                                                baseline,
+                                                G_KEY_FILE_NONE,
+                                                &err)) {
+                        g_printerr ("Could not load %s: %s\n",
+                                    baseline,
+                                    err->message);
+                        return EXIT_FAILURE;
+                }
+        }
+
+        /* Done first, as the class initialisation is what an application
+         * pays for at startup */
+        start = gst_util_get_timestamp ();
+        discoverer = gupnp_dlna_discoverer_new (GST_SECOND, FALSE, FALSE);
+        g_print ("First gupnp_dlna_discoverer_new(): %.2f ms\n\n",
+                 (gdouble) (gst_util_get_timestamp () - start) / GST_MSECOND);
+        g_object_unref (discoverer);
+
+        results = g_key_file_new ();
+        scales = g_strsplit (scales_str, ",", -1);
+
+        for (i = 0; scales[i]; i++) {
+                guint scale = (guint) g_ascii_strtoull (scales[i], NULL, 10);
+                gchar *dir;
+
+                if (scale == 0)
+                        continue;
+
+                if (scale == 1) {
+                        ok &= bench_dir (argv[1], 1, baseline_file, results);
+                        continue;
+                }
+
+                dir = make_scaled_dir (argv[1], scale);
+                ok &= bench_dir (dir, scale, baseline_file, results);
+                remove_scaled_dir (dir);
+        }
+
+        g_strfreev (scales);
+
+        if (save_baseline) {
+                gchar *data = g_key_file_to_data (results, NULL, NULL);
+
+                if (!g_file_set_contents (save_baseline, data, -1, &err)) {
+                        g_printerr ("Could not save %s: %s\n",
+                                    save_baseline,
+                                    err->message);
+                        g_clear_error (&err);
+                        ok = FALSE;
+                }
+
+                g_free (data);
+        }
+
+        g_key_file_free (results);
+        if (baseline_file)
+                g_key_file_free (baseline_file);
+
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,455 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Generates a media corpus for end-to-end tests without any external media:
+ * for every DLNA profile, a short test pattern and tone are encoded with
+ * encodebin and the profile's GstEncodingProfile, using whatever encoders
+ * and muxers are installed. Profiles that cannot be encoded on this machine
+ * are skipped.
+ *
+ * Each encoded file is checked with the discoverer, copied --count times,
+ * and listed in media-list.txt in the output directory, in the format that
+ * test-discoverer reads. Files that end up matching another profile than
+ * the one they were encoded for are listed as comments.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+#include <gst/pbutils/pbutils.h>
+#include <gst/pbutils/encoding-profile.h>
+#include <libgupnp-dlna/gupnp-dlna-discoverer.h>
+
+#define VIDEO_BUFFERS 30
+#define AUDIO_BUFFERS 44
+
+static gchar *output_dir = NULL;
+static gint count = 1;
+static gint encode_timeout = 60;
+static gboolean extended = FALSE;
+static gchar **only_profiles = NULL;
+
+static const struct {
+        const gchar *mime;
+        const gchar *extension;
+} extensions[] = {
+        { "audio/3gpp", "3gp" },
+        { "audio/L16", "pcm" },
+        { "audio/mp4", "m4a" },
+        { "audio/mpeg", "mp3" },
+        { "audio/vnd.dlna.adts", "aac" },
+        { "audio/vnd.dolby.dd-raw", "ac3" },
+        { "audio/x-ms-wma", "wma" },
+        { "image/jpeg", "jpg" },
+        { "image/png", "png" },
+        { "video/3gpp", "3gp" },
+        { "video/mp4", "mp4" },
+        { "video/mpeg", "mpg" },
+        { "video/vnd.dlna.mpeg-tts", "ts" },
+        { "video/x-ms-wmv", "wmv" },
+};
+
+static const gchar *
+get_extension (const gchar *mime)
+{
+        guint i;
+
+        for (i = 0; i < G_N_ELEMENTS (extensions); i++)
+                if (g_str_has_prefix (mime, extensions[i].mime))
+                        return extensions[i].extension;
+
+        return "bin";
+}
+
+static void
+get_stream_types (GstEncodingProfile *enc_profile,
+                  gboolean           *has_video,
+                  gboolean           *is_image,
+                  gboolean           *has_audio)
+{
+        const GList *l;
+
+        *has_video = *is_image = *has_audio = FALSE;
+
+        if (GST_IS_ENCODING_AUDIO_PROFILE (enc_profile)) {
+                *has_audio = TRUE;
+                return;
+        }
+
+        for (l = gst_encoding_container_profile_get_profiles
+                        (GST_ENCODING_CONTAINER_PROFILE (enc_profile));
+             l;
+             l = l->next) {
+                GstEncodingProfile *sub = l->data;
+
+                if (GST_IS_ENCODING_VIDEO_PROFILE (sub)) {
+                        const GstCaps *format;
+
+                        format = gst_encoding_profile_get_format (sub);
+                        *has_video = TRUE;
+                        *is_image = g_str_has_prefix
+                                (gst_structure_get_name
+                                        (gst_caps_get_structure (format, 0)),
+                                 "image/");
+                } else if (GST_IS_ENCODING_AUDIO_PROFILE (sub)) {
+                        *has_audio = TRUE;
+                }
+        }
+}
+
+/* Adds @source_name to @pipeline and links it to a new request pad of
+ * @encodebin, named after @pad_template */
+static gboolean
+add_source (GstElement  *pipeline,
+            GstElement  *encodebin,
+            const gchar *source_name,
+            const gchar *pad_template,
+            gint        n_buffers)
+{
+        GstElement *source;
+        GstPad *src_pad, *sink_pad;
+        gboolean ret;
+
+        source = gst_element_factory_make (source_name, NULL);
+        sink_pad = gst_element_get_request_pad (encodebin, pad_template);
+
+        if (!source || !sink_pad) {
+                if (source)
+                        gst_object_unref (source);
+                return FALSE;
+        }
+
+        g_object_set (source, "num-buffers", n_buffers, NULL);
+        gst_bin_add (GST_BIN (pipeline), source);
+
+        src_pad = gst_element_get_static_pad (source, "src");
+        ret = gst_pad_link (src_pad, sink_pad) == GST_PAD_LINK_OK;
+
+        gst_object_unref (src_pad);
+        gst_object_unref (sink_pad);
+
+        return ret;
+}
+
+typedef struct {
+        GMainLoop *loop;
+        gboolean  done;
+        guint     timeout_id;
+} EncodeState;
+
+static gboolean
+stop_on_timeout (EncodeState *state)
+{
+        state->timeout_id = 0;
+        g_main_loop_quit (state->loop);
+
+        return FALSE;
+}
+
+static void
+bus_message_cb (GstBus *bus, GstMessage *message, EncodeState *state)
+{
+        switch (GST_MESSAGE_TYPE (message)) {
+        case GST_MESSAGE_ERROR:
+                g_main_loop_quit (state->loop);
+                break;
+        case GST_MESSAGE_EOS:
+                state->done = TRUE;
+                g_main_loop_quit (state->loop);
+                break;
+        default:
+                break;
+        }
+}
+
+static gboolean
+encode (GstEncodingProfile *enc_profile, const gchar *path)
+{
+        GstElement *pipeline, *encodebin, *sink;
+        EncodeState state = { NULL, FALSE, 0 };
+        GstBus *bus;
+        gboolean has_video, is_image, has_audio;
+
+        get_stream_types (enc_profile, &has_video, &is_image, &has_audio);
+
+        pipeline = gst_pipeline_new (NULL);
+        encodebin = gst_element_factory_make ("encodebin", NULL);
+        sink = gst_element_factory_make ("filesink", NULL);
+
+        if (!encodebin || !sink) {
+                g_printerr ("encodebin and filesink are needed\n");
+                exit (EXIT_FAILURE);
+        }
+
+        g_object_set (encodebin, "profile", enc_profile, NULL);
+        g_object_set (sink, "location", path, NULL);
+        gst_bin_add_many (GST_BIN (pipeline), encodebin, sink, NULL);
+
+        if (!gst_element_link (encodebin, sink) ||
+            (has_video &&
+             !add_source (pipeline,
+                          encodebin,
+                          "videotestsrc",
+                          "video_%d",
+                          is_image ? 1 : VIDEO_BUFFERS)) ||
+            (has_audio &&
+             !add_source (pipeline,
+                          encodebin,
+                          "audiotestsrc",
+                          "audio_%d",
+                          AUDIO_BUFFERS)))
+                goto out;
+
+        state.loop = g_main_loop_new (NULL, FALSE);
+        bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
+        gst_bus_add_signal_watch (bus);
+        g_signal_connect (bus,
+                          "message",
+                          G_CALLBACK (bus_message_cb),
+                          &state);
+
+        state.timeout_id = g_timeout_add_seconds
+                                        (encode_timeout,
+                                         (GSourceFunc) stop_on_timeout,
+                                         &state);
+
+        if (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+            GST_STATE_CHANGE_FAILURE)
+                g_main_loop_run (state.loop);
+
+        if (state.timeout_id)
+                g_source_remove (state.timeout_id);
+        gst_bus_remove_signal_watch (bus);
+        gst_object_unref (bus);
+        g_main_loop_unref (state.loop);
+
+out:
+        gst_element_set_state (pipeline, GST_STATE_NULL);
+        gst_object_unref (pipeline);
+
+        if (!state.done)
+                g_unlink (path);
+
+        return state.done;
+}
+
+static gboolean
+copy_file (const gchar *from, const gchar *to)
+{
+        gchar *contents;
+        gsize length;
+        gboolean ret;
+
+        if (!g_file_get_contents (from, &contents, &length, NULL))
+                return FALSE;
+
+        ret = g_file_set_contents (to, contents, length, NULL);
+        g_free (contents);
+
+        return ret;
+}
+
+/* Encodes a file for @profile and appends its copies to @list. Returns FALSE
+ * if the profile could not be encoded. */
+static gboolean
+make_files (GUPnPDLNADiscoverer *discoverer,
+            GUPnPDLNAProfile    *profile,
+            GString             *list)
+{
+        GstEncodingProfile *enc_profile;
+        GUPnPDLNAInformation *dlna;
+        const gchar *name, *mime, *matched;
+        gchar *file_name, *path, *uri;
+        gboolean ok;
+        gint i;
+
+        name = gupnp_dlna_profile_get_name (profile);
+        mime = gupnp_dlna_profile_get_mime (profile);
+
+        file_name = g_strdup_printf ("%s-0.%s", name, get_extension (mime));
+        path = g_build_filename (output_dir, file_name, NULL);
+
+        enc_profile = gupnp_dlna_profile_get_encoding_profile (profile);
+        ok = encode (enc_profile, path);
+        gst_encoding_profile_unref (enc_profile);
+
+        if (!ok) {
+                g_print ("%-30s skipped, could not be encoded\n", name);
+                goto out;
+        }
+
+        uri = g_filename_to_uri (path, NULL, NULL);
+        dlna = gupnp_dlna_discoverer_discover_uri_sync (discoverer,
+                                                        uri,
+                                                        NULL);
+        g_free (uri);
+
+        matched = dlna ? gupnp_dlna_information_get_name (dlna) : NULL;
+        if (matched && g_str_equal (matched, name))
+                g_print ("%-30s ok\n", name);
+        else
+                g_print ("%-30s matched %s instead\n",
+                         name,
+                         matched ? matched : "no profile");
+
+        for (i = 0; i < count; i++) {
+                gchar *copy_name, *copy_path;
+
+                copy_name = g_strdup_printf ("%s-%d.%s",
+                                             name,
+                                             i,
+                                             get_extension (mime));
+                copy_path = g_build_filename (output_dir, copy_name, NULL);
+
+                if (i == 0 || copy_file (path, copy_path))
+                        g_string_append_printf (list,
+                                                "%s%s,%s,%s\n",
+                                                matched &&
+                                                g_str_equal (matched, name) ?
+                                                "" : "# ",
+                                                copy_name,
+                                                name,
+                                                mime);
+
+                g_free (copy_path);
+                g_free (copy_name);
+        }
+
+        if (dlna)
+                g_object_unref (dlna);
+
+out:
+        g_free (path);
+        g_free (file_name);
+
+        return ok;
+}
+
+static gboolean
+is_selected (const gchar *name)
+{
+        gchar **p;
+
+        if (!only_profiles)
+                return TRUE;
+
+        for (p = only_profiles; *p; p++)
+                if (g_str_equal (*p, name))
+                        return TRUE;
+
+        return FALSE;
+}
+
+int
+main (int argc, char **argv)
+{
+        GUPnPDLNADiscoverer *discoverer;
+        const GList *profiles, *l;
+        GString *list;
+        GError *err = NULL;
+        GOptionContext *ctx;
+        gchar *list_path;
+        guint n_encoded = 0, n_skipped = 0;
+
+        GOptionEntry options[] = {
+                {"output", 'o', 0, G_OPTION_ARG_FILENAME, &output_dir,
+                 "Directory to write the corpus to", "DIR"},
+                {"count", 'n', 0, G_OPTION_ARG_INT, &count,
+                 "Number of files per profile (defaults to 1)", "N"},
+                {"profile", 'p', 0, G_OPTION_ARG_STRING_ARRAY,
+                 &only_profiles,
+                 "Only generate files for PROFILE (can be repeated)",
+                 "PROFILE"},
+                {"extended", 'e', 0, G_OPTION_ARG_NONE, &extended,
+                 "Include the extended (non-standard) profiles", NULL},
+                {"timeout", 't', 0, G_OPTION_ARG_INT, &encode_timeout,
+                 "Give up encoding a file after T seconds", "T"},
+                {NULL}
+        };
+
+        if (!g_thread_supported ())
+                g_thread_init (NULL);
+
+        ctx = g_option_context_new ("- generate test media for every DLNA "
+                                    "profile");
+        g_option_context_add_main_entries (ctx, options, NULL);
+        g_option_context_add_group (ctx, gst_init_get_option_group ());
+
+        if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+                g_print ("Error initializing: %s\n", err->message);
+                exit (1);
+        }
+
+        g_option_context_free (ctx);
+
+        if (!output_dir || count < 1) {
+                g_print ("usage: %s -o <dir> [-n <count>]\n", argv[0]);
+                exit (-1);
+        }
+
+        gst_init (&argc, &argv);
+
+        if (g_mkdir_with_parents (output_dir, 0755) < 0) {
+                g_printerr ("Could not create %s\n", output_dir);
+                return EXIT_FAILURE;
+        }
+
+        discoverer = gupnp_dlna_discoverer_new ((GstClockTime)
+                                                (10 * GST_SECOND),
+                                                FALSE,
+                                                extended);
+        profiles = gupnp_dlna_discoverer_list_profiles (discoverer);
+
+        list = g_string_new ("# Generated by make-corpus: "
+                             "path,profile,mime\n");
+
+        for (l = profiles; l; l = l->next) {
+                GUPnPDLNAProfile *profile = l->data;
+
+                if (!is_selected (gupnp_dlna_profile_get_name (profile)))
+                        continue;
+
+                if (make_files (discoverer, profile, list))
+                        n_encoded++;
+                else
+                        n_skipped++;
+        }
+
+        list_path = g_build_filename (output_dir, "media-list.txt", NULL);
+        if (!g_file_set_contents (list_path, list->str, -1, &err)) {
+                g_printerr ("Could not write %s: %s\n",
+                            list_path,
+                            err->message);
+                return EXIT_FAILURE;
+        }
+
+        g_print ("\n%u profiles encoded, %u skipped, list written to %s\n",
+                 n_encoded,
+                 n_skipped,
+                 list_path);
+
+        g_free (list_path);
+        g_string_free (list, TRUE);
+        g_object_unref (discoverer);
+
+        return n_encoded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,394 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Times the profile matcher on its own, without GStreamer pipelines or media
+ * files. For every profile found in the given directory, three stream
+ * descriptions are built from the profile's own restrictions:
+ *
+ *   match:     the first value allowed for each restricted field
+ *   near-miss: the same, but with a width or sample rate no profile allows
+ *   no-match:  the same, but with unknown media types
+ *
+ * Each set is matched over and over, and the time, the number of memory
+ * allocations and the number of profiles visited per match are reported.
+ * Allocations are only counted if GSlice is told to use malloc, which
+ * "make bench" does by setting G_SLICE=always-malloc.
+ */
+
+#include <stdlib.h>
+#include <gst/gst.h>
+#include <gst/pbutils/pbutils.h>
+#include <libgupnp-dlna/profile-loading.h>
+#include <libgupnp-dlna/profile-registry.h>
+#include <libgupnp-dlna/stream-description.h>
+
+/* An odd value for the width or sample rate, which no profile allows */
+#define NEAR_MISS_VALUE 7
+
+#define N_BUCKETS 12
+
+typedef enum {
+        CASE_MATCH,
+        CASE_NEAR_MISS,
+        CASE_NO_MATCH,
+        N_CASES
+} BenchCase;
+
+static const gchar *case_names[N_CASES] = {
+        "match",
+        "near-miss",
+        "no-match"
+};
+
+static gint n_iterations = 1000;
+
+static volatile gint n_allocations = 0;
+
+static gpointer
+counting_malloc (gsize n_bytes)
+{
+        g_atomic_int_inc (&n_allocations);
+        return malloc (n_bytes);
+}
+
+static gpointer
+counting_realloc (gpointer mem, gsize n_bytes)
+{
+        g_atomic_int_inc (&n_allocations);
+        return realloc (mem, n_bytes);
+}
+
+static gpointer
+counting_calloc (gsize n_blocks, gsize n_block_bytes)
+{
+        g_atomic_int_inc (&n_allocations);
+        return calloc (n_blocks, n_block_bytes);
+}
+
+static GMemVTable counting_vtable = {
+        counting_malloc,
+        counting_realloc,
+        free,
+        counting_calloc,
+        counting_malloc,
+        counting_realloc
+};
+
+static GList *
+load_profiles (const gchar *profile_dir)
+{
+        GUPnPDLNALoadState *data;
+        GList *profiles;
+
+        data = g_new0 (GUPnPDLNALoadState, 1);
+        data->files_hash = g_hash_table_new_full (g_str_hash,
+                                                  g_str_equal,
+                                                  g_free,
+                                                  NULL);
+
+        profiles = gupnp_dlna_load_profiles_from_dir ((gchar *) profile_dir,
+                                                      data);
+
+        g_hash_table_unref (data->files_hash);
+        g_free (data);
+
+        return profiles;
+}
+
+/* Replaces ranges and lists with the first value they allow */
+static gboolean
+fixate_value (GQuark field_id, GValue *value, gpointer unused)
+{
+        GValue fixed = { 0, };
+
+        if (GST_VALUE_HOLDS_INT_RANGE (value)) {
+                g_value_init (&fixed, G_TYPE_INT);
+                g_value_set_int (&fixed, gst_value_get_int_range_min (value));
+        } else if (GST_VALUE_HOLDS_FRACTION_RANGE (value)) {
+                const GValue *min = gst_value_get_fraction_range_min (value);
+
+                g_value_init (&fixed, GST_TYPE_FRACTION);
+                g_value_copy (min, &fixed);
+        } else if (GST_VALUE_HOLDS_LIST (value) &&
+                   gst_value_list_get_size (value)) {
+                const GValue *first = gst_value_list_get_value (value, 0);
+
+                g_value_init (&fixed, G_VALUE_TYPE (first));
+                g_value_copy (first, &fixed);
+                fixate_value (field_id, &fixed, NULL);
+        } else {
+                return TRUE;
+        }
+
+        g_value_unset (value);
+        g_value_init (value, G_VALUE_TYPE (&fixed));
+        g_value_copy (&fixed, value);
+        g_value_unset (&fixed);
+
+        return TRUE;
+}
+
+static GstCaps *
+make_stream_caps (const GstCaps *restriction,
+                  BenchCase     bench_case,
+                  const gchar   *miss_field)
+{
+        GstCaps *caps;
+        GstStructure *st;
+
+        caps = gst_caps_copy_nth (restriction, 0);
+        st = gst_caps_get_structure (caps, 0);
+        gst_structure_map_in_place (st, fixate_value, NULL);
+
+        if (bench_case == CASE_NEAR_MISS && miss_field)
+                gst_structure_set (st,
+                                   miss_field, G_TYPE_INT, NEAR_MISS_VALUE,
+                                   NULL);
+        else if (bench_case == CASE_NO_MATCH)
+                gst_structure_set_name (st, "application/x-gupnp-dlna-bench");
+
+        return caps;
+}
+
+static GUPnPDLNAStreamDescription *
+make_description (const GUPnPDLNAProfileTable *table,
+                  guint                       i,
+                  BenchCase                   bench_case)
+{
+        GUPnPDLNAStreamDescription *desc;
+        guint first_video = table->video_offsets[i];
+        guint first_audio = table->audio_offsets[i];
+
+        desc = gupnp_dlna_stream_description_new ();
+
+        if (table->flags[i] & GUPNP_DLNA_PROFILE_TABLE_CONTAINER)
+                desc->container = make_stream_caps (table->container_caps[i],
+                                                    bench_case,
+                                                    NULL);
+
+        if (first_video < first_audio) {
+                GstCaps *video = make_stream_caps
+                                        (table->restrictions[first_video],
+                                         bench_case,
+                                         "width");
+
+                desc->is_image = g_str_has_prefix
+                                (gst_structure_get_name
+                                        (gst_caps_get_structure (video, 0)),
+                                 "image/");
+                desc->video = g_list_append (NULL, video);
+        }
+
+        /* Only the video is broken in video profiles, so that the audio
+         * gets checked too */
+        if (first_audio < table->video_offsets[i + 1])
+                desc->audio = g_list_append
+                        (NULL,
+                         make_stream_caps (table->restrictions[first_audio],
+                                           desc->video &&
+                                           bench_case == CASE_NEAR_MISS ?
+                                           CASE_MATCH : bench_case,
+                                           "rate"));
+
+        return desc;
+}
+
+static guint
+count_visits (const GUPnPDLNAStreamDescription *desc,
+              const GUPnPDLNAProfileTable      *table)
+{
+        GUPnPDLNAMatchStats *stats = gupnp_dlna_match_stats_new ();
+        gchar *name = NULL, *mime = NULL;
+        GList *structures, *l;
+        guint visits = 0;
+
+        gupnp_dlna_stream_description_guess_profile (desc,
+                                                     table,
+                                                     stats,
+                                                     &name,
+                                                     &mime);
+
+        structures = gupnp_dlna_match_stats_to_structures (stats);
+        for (l = structures; l; l = l->next) {
+                guint evaluations;
+
+                if (gst_structure_get_uint (l->data,
+                                            "evaluations",
+                                            &evaluations))
+                        visits += evaluations;
+                gst_structure_free (l->data);
+        }
+
+        g_list_free (structures);
+        gupnp_dlna_match_stats_free (stats);
+        g_free (name);
+        g_free (mime);
+
+        return visits;
+}
+
+static void
+run_case (BenchCase                   bench_case,
+          GPtrArray                   *descriptions,
+          const GUPnPDLNAProfileTable *table)
+{
+        guint histogram[N_BUCKETS] = { 0, };
+        guint i, n_matched = 0, total_visits = 0, ops;
+        gint n, allocations;
+        GstClockTime start, elapsed;
+
+        for (i = 0; i < descriptions->len; i++) {
+                guint visits, bucket = 0;
+
+                visits = count_visits (g_ptr_array_index (descriptions, i),
+                                       table);
+                total_visits += visits;
+
+                while ((visits >> (bucket + 1)) && bucket < N_BUCKETS - 1)
+                        bucket++;
+                histogram[bucket]++;
+        }
+
+        allocations = g_atomic_int_get (&n_allocations);
+        start = gst_util_get_timestamp ();
+
+        for (n = 0; n < n_iterations; n++) {
+                for (i = 0; i < descriptions->len; i++) {
+                        gchar *name = NULL, *mime = NULL;
+
+                        gupnp_dlna_stream_description_guess_profile
+                                        (g_ptr_array_index (descriptions, i),
+                                         table,
+                                         NULL,
+                                         &name,
+                                         &mime);
+
+                        if (n == 0 && name)
+                                n_matched++;
+
+                        g_free (name);
+                        g_free (mime);
+                }
+        }
+
+        elapsed = gst_util_get_timestamp () - start;
+        allocations = g_atomic_int_get (&n_allocations) - allocations;
+        ops = n_iterations * descriptions->len;
+
+        g_print ("%s: %u streams, %u matched\n",
+                 case_names[bench_case],
+                 descriptions->len,
+                 n_matched);
+
+        if (!ops)
+                return;
+
+        g_print ("  %.0f ns/op, %.1f allocations/op, "
+                 "%.1f profiles visited/op\n",
+                 (gdouble) elapsed / ops,
+                 (gdouble) allocations / ops,
+                 (gdouble) total_visits / descriptions->len);
+
+        g_print ("  profiles visited:\n");
+        for (i = 0; i < N_BUCKETS; i++)
+                if (histogram[i])
+                        g_print ("    < %5u: %u\n", 2 << i, histogram[i]);
+}
+
+int
+main (int argc, char **argv)
+{
+        GUPnPDLNAProfileRegistry *registry;
+        const GUPnPDLNAProfileTable *table;
+        GPtrArray *descriptions[N_CASES];
+        GList *profiles;
+        GError *err = NULL;
+        GOptionContext *ctx;
+        guint i, c;
+
+        GOptionEntry options[] = {
+                {"iterations", 'n', 0, G_OPTION_ARG_INT, &n_iterations,
+                 "Number of times every stream is matched", NULL},
+                {NULL}
+        };
+
+        /* Must come before anything is allocated */
+        g_mem_set_vtable (&counting_vtable);
+
+        if (!g_thread_supported ())
+                g_thread_init (NULL);
+
+        ctx = g_option_context_new (" profile-dir - benchmark the profile "
+                                    "matcher");
+        g_option_context_add_main_entries (ctx, options, NULL);
+        g_option_context_add_group (ctx, gst_init_get_option_group ());
+
+        if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+                g_print ("Error initializing: %s\n", err->message);
+                exit (1);
+        }
+
+        g_option_context_free (ctx);
+
+        if (argc < 2) {
+                g_print ("Usage: matcher-bench [options] profile-dir\n");
+                return EXIT_FAILURE;
+        }
+
+        gst_init (&argc, &argv);
+
+        profiles = load_profiles (argv[1]);
+        if (!profiles) {
+                g_printerr ("No profiles found in %s\n", argv[1]);
+                return EXIT_FAILURE;
+        }
+
+        registry = gupnp_dlna_profile_registry_new (profiles);
+        table = gupnp_dlna_profile_registry_get_table (registry);
+
+        for (c = 0; c < N_CASES; c++) {
+                descriptions[c] = g_ptr_array_new ();
+
+                for (i = 0; i < table->n_profiles; i++)
+                        if (table->flags[i] &
+                            GUPNP_DLNA_PROFILE_TABLE_MATCHABLE)
+                                g_ptr_array_add (descriptions[c],
+                                                 make_description (table,
+                                                                   i,
+                                                                   c));
+        }
+
+        g_print ("%u profiles, %d iterations\n\n",
+                 table->n_profiles,
+                 n_iterations);
+
+        for (c = 0; c < N_CASES; c++) {
+                run_case (c, descriptions[c], table);
+
+                for (i = 0; i < descriptions[c]->len; i++)
+                        gupnp_dlna_stream_description_free
+                                (g_ptr_array_index (descriptions[c], i));
+                g_ptr_array_free (descriptions[c], TRUE);
+        }
+
+        gupnp_dlna_profile_registry_unref (registry);
+
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,741 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Checks the profile matcher against a reference implementation.
+ *
+ * The oracle below is the matcher as it was before it worked on profile
+ * tables: a straight walk of the profile list, checking each stream against
+ * the profile's GstEncodingProfile with caps_can_intersect_and_is_subset ().
+ * It is slow and simple on purpose, and must not be optimised.
+ *
+ * For every matchable profile, random stream descriptions are made from the
+ * profile's restrictions, with values at and just past the edges of ranges,
+ * in and out of lists, fields left out, and streams dropped or borrowed from
+ * other profiles. Each description is run through the oracle and through
+ * every matcher in the matchers[] table below, which must all find the same
+ * profile name and MIME type. A faster matcher only needs an entry there to
+ * be checked.
+ *
+ * Profiles are loaded from the directory given on the command line or in
+ * PROFILE_DIR, in both strict and relaxed mode. --seed replays a run.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <gst/gst.h>
+#include <gst/pbutils/pbutils.h>
+#include <libgupnp-dlna/gupnp-dlna-profile.h>
+#include <libgupnp-dlna/profile-loading.h>
+#include <libgupnp-dlna/profile-order.h>
+#include <libgupnp-dlna/profile-registry.h>
+#include <libgupnp-dlna/stream-description.h>
+
+/* Mismatches reported before giving up */
+#define MAX_FAILURES 10
+
+typedef struct {
+        GUPnPDLNAProfileRegistry *registry;
+        GUPnPDLNAProfileOrder    *order;
+        GUPnPDLNAStreamDescription *desc;
+} MatchContext;
+
+typedef void (* MatchFunc) (MatchContext *context,
+                            gpointer     data,
+                            gchar        **name,
+                            gchar        **mime);
+
+/* Tells whether the matcher has to find @winner, the oracle's result (NULL
+ * if nothing matched). Matchers that only look at some of the profiles
+ * cannot be expected to find the others. */
+typedef gboolean (* AcceptsFunc) (GUPnPDLNAProfile *winner, gpointer data);
+
+typedef struct {
+        const gchar *name;
+        MatchFunc   match;
+        AcceptsFunc accepts;
+        gpointer    data;
+} Matcher;
+
+static gint n_per_profile = 16;
+static gint seed = 1;
+
+static GRand *prng;
+
+/* The oracle */
+
+static gboolean
+oracle_is_video_profile (GstEncodingProfile *profile)
+{
+        const GList *i, *profiles_list;
+
+        if (GST_IS_ENCODING_CONTAINER_PROFILE (profile)) {
+                profiles_list = gst_encoding_container_profile_get_profiles
+                                     (GST_ENCODING_CONTAINER_PROFILE (profile));
+
+                for (i = profiles_list ; i; i = i->next)
+                        if (GST_IS_ENCODING_VIDEO_PROFILE (i->data))
+                                return TRUE;
+        }
+
+        return FALSE;
+}
+
+static gboolean
+oracle_structure_can_intersect (const GstStructure *st1,
+                                const GstStructure *st2)
+{
+        GstCaps *caps1, *caps2;
+        gboolean ret;
+
+        caps1 = gst_caps_new_full (gst_structure_copy (st1), NULL);
+        caps2 = gst_caps_new_full (gst_structure_copy (st2), NULL);
+
+        ret = gst_caps_can_intersect (caps1, caps2);
+
+        gst_caps_unref (caps1);
+        gst_caps_unref (caps2);
+
+        return ret;
+}
+
+static gboolean
+oracle_structure_is_subset (const GstStructure *st1, const GstStructure *st2)
+{
+        int i;
+
+        for (i = 0; i < gst_structure_n_fields (st2); i++) {
+                const gchar *name = gst_structure_nth_field_name (st2, i);
+
+                if (!gst_structure_has_field (st1, name))
+                        return FALSE;
+        }
+
+        return TRUE;
+}
+
+static gboolean
+caps_can_intersect_and_is_subset (GstCaps       *stream_caps,
+                                  const GstCaps *profile_caps)
+{
+        int i;
+        GstStructure *stream_st, *profile_st;
+
+        stream_st = gst_caps_get_structure (stream_caps, 0);
+
+        for (i = 0; i < gst_caps_get_size (profile_caps); i++) {
+                profile_st = gst_caps_get_structure (profile_caps, i);
+
+                if (oracle_structure_can_intersect (stream_st, profile_st) &&
+                    oracle_structure_is_subset (stream_st, profile_st))
+                        return TRUE;
+        }
+
+        return FALSE;
+}
+
+static gboolean
+oracle_match_profile (GstEncodingProfile *profile,
+                      GstCaps            *caps,
+                      GType              type)
+{
+        const GList *i, *profiles_list;
+
+        profiles_list = gst_encoding_container_profile_get_profiles
+                                     (GST_ENCODING_CONTAINER_PROFILE (profile));
+
+        for (i = profiles_list; i; i = i->next) {
+                GstEncodingProfile *enc_profile = GST_ENCODING_PROFILE
+                                        (i->data);
+                const GstCaps *format = gst_encoding_profile_get_format
+                                        (enc_profile);
+
+                if (type == G_TYPE_FROM_INSTANCE (enc_profile) &&
+                    caps_can_intersect_and_is_subset (caps, format))
+                        return TRUE;
+        }
+
+        return FALSE;
+}
+
+/* Only the first structure of the stream caps is matched */
+static gboolean
+oracle_match_streams (GList              *streams,
+                      GstEncodingProfile *profile,
+                      GType              type)
+{
+        GList *i;
+
+        for (i = streams; i; i = i->next) {
+                GstCaps *caps = gst_caps_copy_nth (i->data, 0);
+                gboolean ret = oracle_match_profile (profile, caps, type);
+
+                gst_caps_unref (caps);
+
+                if (ret)
+                        return TRUE;
+        }
+
+        return FALSE;
+}
+
+static gboolean
+oracle_check_container (const GUPnPDLNAStreamDescription *desc,
+                        GstEncodingProfile               *profile)
+{
+        const GstCaps *profile_caps = gst_encoding_profile_get_format (profile);
+
+        if (desc->container)
+                return gst_caps_can_intersect (desc->container, profile_caps);
+
+        return gst_caps_is_empty (profile_caps);
+}
+
+static gboolean
+oracle_check_profile (const GUPnPDLNAStreamDescription *desc,
+                      GstEncodingProfile               *profile)
+{
+        gboolean is_video = oracle_is_video_profile (profile);
+
+        if (desc->video && desc->is_image) {
+                GList image = { desc->video->data, NULL, NULL };
+
+                return is_video &&
+                       oracle_match_streams (&image,
+                                             profile,
+                                             GST_TYPE_ENCODING_VIDEO_PROFILE);
+        }
+
+        if (desc->video)
+                return oracle_match_streams (desc->video,
+                                             profile,
+                                             GST_TYPE_ENCODING_VIDEO_PROFILE) &&
+                       oracle_match_streams (desc->audio,
+                                             profile,
+                                             GST_TYPE_ENCODING_AUDIO_PROFILE) &&
+                       oracle_check_container (desc, profile);
+
+        if (desc->audio)
+                return !is_video &&
+                       oracle_match_streams (desc->audio,
+                                             profile,
+                                             GST_TYPE_ENCODING_AUDIO_PROFILE) &&
+                       oracle_check_container (desc, profile);
+
+        return FALSE;
+}
+
+static GUPnPDLNAProfile *
+oracle_guess_profile (const GUPnPDLNAStreamDescription *desc,
+                      const GList                      *profiles)
+{
+        const GList *i;
+
+        for (i = profiles; i; i = i->next) {
+                GUPnPDLNAProfile *profile = i->data;
+                GstEncodingProfile *enc_profile;
+                const gchar *name = gupnp_dlna_profile_get_name (profile);
+                gboolean found;
+
+                /* Profiles with an empty name are used only for inheritance
+                 * and should not be matched against. */
+                if (!name || name[0] == '\0')
+                        continue;
+
+                enc_profile = gupnp_dlna_profile_get_encoding_profile
+                                                                (profile);
+                found = GST_IS_ENCODING_CONTAINER_PROFILE (enc_profile) &&
+                        oracle_check_profile (desc, enc_profile);
+                gst_encoding_profile_unref (enc_profile);
+
+                if (found)
+                        return profile;
+        }
+
+        return NULL;
+}
+
+/* The matchers checked against the oracle */
+
+static void
+match_table (MatchContext *context,
+             gpointer     data,
+             gchar        **name,
+             gchar        **mime)
+{
+        gupnp_dlna_stream_description_guess_profile
+                        (context->desc,
+                         gupnp_dlna_profile_registry_get_table
+                                                (context->registry),
+                         NULL,
+                         name,
+                         mime);
+}
+
+/* Collecting statistics goes through the reasons for every rejection */
+static void
+match_table_with_stats (MatchContext *context,
+                        gpointer     data,
+                        gchar        **name,
+                        gchar        **mime)
+{
+        GUPnPDLNAMatchStats *stats = gupnp_dlna_match_stats_new ();
+
+        gupnp_dlna_stream_description_guess_profile
+                        (context->desc,
+                         gupnp_dlna_profile_registry_get_table
+                                                (context->registry),
+                         stats,
+                         name,
+                         mime);
+
+        gupnp_dlna_match_stats_free (stats);
+}
+
+static void
+match_candidates (MatchContext *context,
+                  gpointer     data,
+                  gchar        **name,
+                  gchar        **mime)
+{
+        gupnp_dlna_stream_description_guess_profile
+                        (context->desc,
+                         gupnp_dlna_profile_registry_get_candidates
+                                        (context->registry,
+                                         GPOINTER_TO_INT (data)),
+                         NULL,
+                         name,
+                         mime);
+}
+
+static gboolean
+candidates_accept (GUPnPDLNAProfile *winner, gpointer data)
+{
+        /* Leaving profiles out cannot make another one match */
+        return !winner ||
+               gupnp_dlna_sniff_class_accepts (GPOINTER_TO_INT (data),
+                                               winner);
+}
+
+static void
+match_adaptive_order (MatchContext *context,
+                      gpointer     data,
+                      gchar        **name,
+                      gchar        **mime)
+{
+        gupnp_dlna_stream_description_guess_profile
+                        (context->desc,
+                         gupnp_dlna_profile_order_get_candidates
+                                        (context->order,
+                                         GUPNP_DLNA_SNIFF_UNKNOWN),
+                         NULL,
+                         name,
+                         mime);
+}
+
+static const Matcher matchers[] = {
+        { "table", match_table, NULL, NULL },
+        { "table with stats", match_table_with_stats, NULL, NULL },
+        { "image candidates", match_candidates, candidates_accept,
+          GINT_TO_POINTER (GUPNP_DLNA_SNIFF_IMAGE) },
+        { "audio candidates", match_candidates, candidates_accept,
+          GINT_TO_POINTER (GUPNP_DLNA_SNIFF_AUDIO) },
+        { "MP4 candidates", match_candidates, candidates_accept,
+          GINT_TO_POINTER (GUPNP_DLNA_SNIFF_MP4) },
+        { "MPEG-TS candidates", match_candidates, candidates_accept,
+          GINT_TO_POINTER (GUPNP_DLNA_SNIFF_MPEG_TS) },
+        { "MPEG-PS candidates", match_candidates, candidates_accept,
+          GINT_TO_POINTER (GUPNP_DLNA_SNIFF_MPEG_PS) },
+        { "ASF candidates", match_candidates, candidates_accept,
+          GINT_TO_POINTER (GUPNP_DLNA_SNIFF_ASF) },
+        { "adaptive order", match_adaptive_order, NULL, NULL }
+};
+
+/* Stream descriptions */
+
+/* A value at or next to one of the edges of @value, or somewhere inside
+ * it. @outside asks for one that @value does not allow. */
+static void
+pick_value (const GValue *value, gboolean outside, GValue *ret)
+{
+        if (GST_VALUE_HOLDS_INT_RANGE (value)) {
+                gint min = gst_value_get_int_range_min (value);
+                gint max = gst_value_get_int_range_max (value);
+                gint picked;
+
+                if (outside)
+                        picked = g_rand_boolean (prng) && min > G_MININT ?
+                                 min - 1 :
+                                 (max < G_MAXINT ? max + 1 : min - 1);
+                else switch (g_rand_int_range (prng, 0, 3)) {
+                        case 0:
+                                picked = min;
+                                break;
+                        case 1:
+                                picked = max;
+                                break;
+                        default:
+                                picked = min + (gint) ((max - (gdouble) min) *
+                                                       g_rand_double (prng));
+                                break;
+                }
+
+                g_value_init (ret, G_TYPE_INT);
+                g_value_set_int (ret, picked);
+        } else if (GST_VALUE_HOLDS_FRACTION_RANGE (value)) {
+                gboolean at_min = g_rand_boolean (prng);
+                const GValue *edge = at_min ?
+                        gst_value_get_fraction_range_min (value) :
+                        gst_value_get_fraction_range_max (value);
+                gint num = gst_value_get_fraction_numerator (edge);
+                gint denom = gst_value_get_fraction_denominator (edge);
+
+                /* Just past the edge */
+                if (outside && at_min)
+                        num = num > 0 ? num - 1 : num;
+                else if (outside)
+                        num = num < G_MAXINT ? num + 1 : num;
+
+                g_value_init (ret, GST_TYPE_FRACTION);
+                gst_value_set_fraction (ret, num, denom);
+        } else if (GST_VALUE_HOLDS_LIST (value) &&
+                   gst_value_list_get_size (value)) {
+                const GValue *item = gst_value_list_get_value
+                        (value,
+                         g_rand_int_range (prng,
+                                           0,
+                                           gst_value_list_get_size (value)));
+
+                /* Past an item is not always outside of the list, but often
+                 * enough */
+                pick_value (item, outside, ret);
+        } else if (outside && G_VALUE_HOLDS_INT (value)) {
+                g_value_init (ret, G_TYPE_INT);
+                g_value_set_int (ret, g_value_get_int (value) + 1);
+        } else if (outside && G_VALUE_HOLDS_BOOLEAN (value)) {
+                g_value_init (ret, G_TYPE_BOOLEAN);
+                g_value_set_boolean (ret, !g_value_get_boolean (value));
+        } else if (outside && G_VALUE_HOLDS_STRING (value)) {
+                gchar *str = g_strconcat (g_value_get_string (value),
+                                          "-x",
+                                          NULL);
+
+                g_value_init (ret, G_TYPE_STRING);
+                g_value_take_string (ret, str);
+        } else if (outside && GST_VALUE_HOLDS_FRACTION (value)) {
+                g_value_init (ret, GST_TYPE_FRACTION);
+                gst_value_set_fraction
+                        (ret,
+                         gst_value_get_fraction_numerator (value) + 1,
+                         gst_value_get_fraction_denominator (value));
+        } else {
+                g_value_init (ret, G_VALUE_TYPE (value));
+                g_value_copy (value, ret);
+        }
+}
+
+/* A stream made from @restriction: a value is picked for every field, some
+ * fields are left out, and now and then a value is out of bounds */
+static GstCaps *
+make_stream (const GstCaps *restriction)
+{
+        const GstStructure *restriction_st;
+        GstStructure *st;
+        gint i;
+
+        restriction_st = gst_caps_get_structure (restriction, 0);
+        st = gst_structure_empty_new (gst_structure_get_name (restriction_st));
+
+        for (i = 0; i < gst_structure_n_fields (restriction_st); i++) {
+                const gchar *field;
+                GValue value = { 0, };
+
+                field = gst_structure_nth_field_name (restriction_st, i);
+
+                if (g_rand_int_range (prng, 0, 16) == 0)
+                        continue;
+
+                pick_value (gst_structure_get_value (restriction_st, field),
+                            g_rand_int_range (prng, 0, 8) == 0,
+                            &value);
+                gst_structure_set_value (st, field, &value);
+                g_value_unset (&value);
+        }
+
+        return gst_caps_new_full (st, NULL);
+}
+
+static const GstCaps *
+pick_restriction (const GUPnPDLNAProfileTable *table, guint first, guint last)
+{
+        if (first == last)
+                return NULL;
+
+        return table->restrictions[g_rand_int_range (prng, first, last)];
+}
+
+static guint
+pick_profile (const GUPnPDLNAProfileTable *table)
+{
+        return g_rand_int_range (prng, 0, table->n_profiles);
+}
+
+static GUPnPDLNAStreamDescription *
+make_description (const GUPnPDLNAProfileTable *table, guint i)
+{
+        GUPnPDLNAStreamDescription *desc;
+        const GstCaps *video, *audio;
+        guint other = pick_profile (table);
+
+        desc = gupnp_dlna_stream_description_new ();
+
+        /* The container, or sometimes another profile's, or none */
+        switch (g_rand_int_range (prng, 0, 8)) {
+        case 0:
+                if (table->flags[other] & GUPNP_DLNA_PROFILE_TABLE_CONTAINER)
+                        desc->container = make_stream
+                                        (table->container_caps[other]);
+                break;
+        case 1:
+                break;
+        default:
+                if (table->flags[i] & GUPNP_DLNA_PROFILE_TABLE_CONTAINER)
+                        desc->container = make_stream
+                                        (table->container_caps[i]);
+                break;
+        }
+
+        video = pick_restriction (table,
+                                  table->video_offsets[i],
+                                  table->audio_offsets[i]);
+        audio = pick_restriction (table,
+                                  table->audio_offsets[i],
+                                  table->video_offsets[i + 1]);
+
+        if (video && g_rand_int_range (prng, 0, 16)) {
+                GstCaps *caps = make_stream (video);
+
+                desc->is_image = g_str_has_prefix
+                                (gst_structure_get_name
+                                        (gst_caps_get_structure (caps, 0)),
+                                 "image/");
+                desc->video = g_list_append (NULL, caps);
+        }
+
+        if (audio && g_rand_int_range (prng, 0, 16))
+                desc->audio = g_list_append (NULL, make_stream (audio));
+
+        /* Another profile's audio, in front, so that the matchers have to
+         * look past the first stream */
+        if (g_rand_int_range (prng, 0, 8) == 0) {
+                audio = pick_restriction (table,
+                                          table->audio_offsets[other],
+                                          table->video_offsets[other + 1]);
+                if (audio)
+                        desc->audio = g_list_prepend (desc->audio,
+                                                      make_stream (audio));
+        }
+
+        return desc;
+}
+
+static gchar *
+describe (const GUPnPDLNAStreamDescription *desc)
+{
+        GString *str = g_string_new (NULL);
+        GList *l;
+
+        if (desc->container) {
+                gchar *caps = gst_caps_to_string (desc->container);
+
+                g_string_append_printf (str, "  container: %s\n", caps);
+                g_free (caps);
+        }
+
+        for (l = desc->video; l; l = l->next) {
+                gchar *caps = gst_caps_to_string (l->data);
+
+                g_string_append_printf (str,
+                                        "  %s: %s\n",
+                                        desc->is_image ? "image" : "video",
+                                        caps);
+                g_free (caps);
+        }
+
+        for (l = desc->audio; l; l = l->next) {
+                gchar *caps = gst_caps_to_string (l->data);
+
+                g_string_append_printf (str, "  audio: %s\n", caps);
+                g_free (caps);
+        }
+
+        return g_string_free (str, FALSE);
+}
+
+/* Runs @desc through the oracle and all the matchers. Returns the number of
+ * matchers that disagreed with the oracle. */
+static guint
+check_description (MatchContext *context, guint *n_matched)
+{
+        GUPnPDLNAProfile *winner;
+        const gchar *expected_name = NULL, *expected_mime = NULL;
+        guint m, n_failures = 0;
+
+        winner = oracle_guess_profile
+                        (context->desc,
+                         gupnp_dlna_profile_registry_get_profiles
+                                                (context->registry));
+        if (winner) {
+                expected_name = gupnp_dlna_profile_get_name (winner);
+                expected_mime = gupnp_dlna_profile_get_mime (winner);
+                (*n_matched)++;
+
+                /* Keeps the adaptive order moving */
+                gupnp_dlna_profile_order_record_match (context->order,
+                                                       expected_name);
+        }
+
+        for (m = 0; m < G_N_ELEMENTS (matchers); m++) {
+                const Matcher *matcher = &matchers[m];
+                gchar *name = NULL, *mime = NULL;
+
+                if (matcher->accepts &&
+                    !matcher->accepts (winner, matcher->data))
+                        continue;
+
+                matcher->match (context, matcher->data, &name, &mime);
+
+                if (g_strcmp0 (name, expected_name) ||
+                    g_strcmp0 (mime, expected_mime)) {
+                        gchar *description = describe (context->desc);
+
+                        g_printerr ("%s matcher found %s (%s) instead of "
+                                    "%s (%s) for\n%s",
+                                    matcher->name,
+                                    name,
+                                    mime,
+                                    expected_name,
+                                    expected_mime,
+                                    description);
+                        g_free (description);
+                        n_failures++;
+                }
+
+                g_free (name);
+                g_free (mime);
+        }
+
+        return n_failures;
+}
+
+static guint
+check_mode (const gchar *profile_dir, gboolean relaxed_mode)
+{
+        MatchContext context;
+        const GUPnPDLNAProfileTable *table;
+        guint i, n, n_descriptions = 0, n_matched = 0, n_failures = 0;
+
+        context.registry = gupnp_dlna_profile_registry_new
+                (gupnp_dlna_load_profiles_from_path (profile_dir,
+                                                     relaxed_mode,
+                                                     TRUE));
+        context.order = gupnp_dlna_profile_order_new (context.registry);
+        table = gupnp_dlna_profile_registry_get_table (context.registry);
+
+        for (i = 0;
+             i < table->n_profiles && n_failures < MAX_FAILURES;
+             i++) {
+                if (!(table->flags[i] & GUPNP_DLNA_PROFILE_TABLE_MATCHABLE))
+                        continue;
+
+                for (n = 0;
+                     n < (guint) n_per_profile && n_failures < MAX_FAILURES;
+                     n++) {
+                        context.desc = make_description (table, i);
+                        n_failures += check_description (&context,
+                                                         &n_matched);
+                        gupnp_dlna_stream_description_free (context.desc);
+                        n_descriptions++;
+                }
+        }
+
+        g_print ("%s mode: %u profiles, %u streams, %u matched, "
+                 "%u mismatches\n",
+                 relaxed_mode ? "relaxed" : "strict",
+                 table->n_profiles,
+                 n_descriptions,
+                 n_matched,
+                 n_failures);
+
+        gupnp_dlna_profile_order_free (context.order);
+        gupnp_dlna_profile_registry_unref (context.registry);
+
+        return n_failures;
+}
+
+int
+main (int argc, char **argv)
+{
+        GOptionContext *ctx;
+        GError *err = NULL;
+        const gchar *profile_dir;
+        guint n_failures;
+
+        GOptionEntry options[] = {
+                {"streams", 'n', 0, G_OPTION_ARG_INT, &n_per_profile,
+                 "Number of streams made for every profile (defaults to "
+                 "16)", "N"},
+                {"seed", 's', 0, G_OPTION_ARG_INT, &seed,
+                 "Seed of the random streams (defaults to 1)", "S"},
+                {NULL}
+        };
+
+        if (!g_thread_supported ())
+                g_thread_init (NULL);
+
+        ctx = g_option_context_new ("<profile_dir> - check the profile "
+                                    "matcher against a reference");
+        g_option_context_add_main_entries (ctx, options, NULL);
+        g_option_context_add_group (ctx, gst_init_get_option_group ());
+
+        if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+                g_printerr ("Error initializing: %s\n", err->message);
+                return EXIT_FAILURE;
+        }
+
+        g_option_context_free (ctx);
+
+        profile_dir = argc > 1 ? argv[1] : g_getenv ("PROFILE_DIR");
+        if (!profile_dir || !g_file_test (profile_dir, G_FILE_TEST_IS_DIR)) {
+                g_printerr ("No profile directory, skipping\n");
+                return 77;
+        }
+
+        g_print ("Profiles from %s, seed %d\n", profile_dir, seed);
+
+        prng = g_rand_new_with_seed (seed);
+
+        n_failures = check_mode (profile_dir, FALSE);
+        if (n_failures < MAX_FAILURES)
+                n_failures += check_mode (profile_dir, TRUE);
+
+        g_rand_free (prng);
+
+        return n_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
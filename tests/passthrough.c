@@ -0,0 +1,260 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Checks the streams that GUPnPDLNADiscoverer finds can be passed through
+ * when transcoding to a target profile, and the encoding profile it makes
+ * for that: the raw audio of a WAV file fits a target that takes any raw
+ * audio, so it is kept as it is and only remuxed, but has to be re-encoded
+ * for an MP3 target, and nothing can be done for a video-only target.
+ *
+ * The media is a short WAV file encoded with audiotestsrc and wavenc when
+ * the test starts. The test is skipped if those are not installed.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+#include <libgupnp-dlna/gupnp-dlna-discoverer.h>
+#include "test-util.h"
+
+/* Exit status telling automake that the test was skipped */
+#define EXIT_SKIP 77
+
+static const TestProfile targets[] = {
+        { "LPCM_OGG", "audio/ogg",
+          "application/ogg",
+          NULL,
+          "audio/x-raw-int" },
+        { "MP3", "audio/mpeg",
+          NULL,
+          NULL,
+          "audio/mpeg, mpegversion=(int)1, layer=(int)3" },
+        { "AVC_MP4_SILENT", "video/mp4",
+          "video/quicktime",
+          "video/x-h264",
+          NULL },
+};
+
+static gboolean
+caps_equal_string (const GstCaps *caps, const gchar *str)
+{
+        GstCaps *other = gst_caps_from_string (str);
+        gboolean ret = gst_caps_is_equal (caps, other);
+
+        gst_caps_unref (other);
+
+        return ret;
+}
+
+/* The audio profile of the container profile @profile */
+static GstEncodingProfile *
+get_audio_profile (GstEncodingProfile *profile)
+{
+        const GList *l;
+
+        g_assert (GST_IS_ENCODING_CONTAINER_PROFILE (profile));
+
+        for (l = gst_encoding_container_profile_get_profiles
+                        (GST_ENCODING_CONTAINER_PROFILE (profile));
+             l;
+             l = l->next)
+                if (GST_IS_ENCODING_AUDIO_PROFILE (l->data))
+                        return l->data;
+
+        g_assert_not_reached ();
+
+        return NULL;
+}
+
+static void
+check_fitting (GUPnPDLNADiscoverer  *discoverer,
+               GUPnPDLNAInformation *dlna,
+               GUPnPDLNAProfile     *target,
+               const TestProfile    *spec)
+{
+        GstDiscovererStreamInfo *stream;
+        GstEncodingProfile *enc_profile, *audio;
+        GstCaps *caps;
+        GList *streams;
+
+        g_assert (!(gupnp_dlna_discoverer_get_transcode_flags (discoverer,
+                                                               dlna,
+                                                               target) &
+                    GUPNP_DLNA_TRANSCODE_AUDIO));
+
+        streams = gupnp_dlna_discoverer_get_passthrough_streams (discoverer,
+                                                                 dlna,
+                                                                 target);
+        g_assert_cmpuint (g_list_length (streams), ==, 1);
+        stream = streams->data;
+        g_assert (GST_IS_DISCOVERER_AUDIO_INFO (stream));
+        caps = gst_discoverer_stream_info_get_caps (stream);
+
+        /* The audio is taken as it is, the container is the target's */
+        enc_profile = gupnp_dlna_discoverer_get_passthrough_profile
+                                                        (discoverer,
+                                                         dlna,
+                                                         target);
+        g_assert (enc_profile != NULL);
+        g_assert (caps_equal_string
+                        (gst_encoding_profile_get_format (enc_profile),
+                         spec->container));
+
+        audio = get_audio_profile (enc_profile);
+        g_assert (gst_caps_is_equal (gst_encoding_profile_get_format (audio),
+                                     caps));
+        g_assert (gst_encoding_profile_get_restriction (audio) == NULL);
+
+        gst_encoding_profile_unref (enc_profile);
+        gst_caps_unref (caps);
+        gst_discoverer_stream_info_list_free (streams);
+}
+
+static void
+check_not_fitting (GUPnPDLNADiscoverer  *discoverer,
+                   GUPnPDLNAInformation *dlna,
+                   GUPnPDLNAProfile     *target,
+                   const TestProfile    *spec)
+{
+        GstEncodingProfile *enc_profile, *audio;
+
+        g_assert (gupnp_dlna_discoverer_get_transcode_flags (discoverer,
+                                                             dlna,
+                                                             target) &
+                  GUPNP_DLNA_TRANSCODE_AUDIO);
+
+        g_assert (gupnp_dlna_discoverer_get_passthrough_streams (discoverer,
+                                                                 dlna,
+                                                                 target) ==
+                  NULL);
+
+        /* Nothing to pass through, so this is the target's own profile */
+        enc_profile = gupnp_dlna_discoverer_get_passthrough_profile
+                                                        (discoverer,
+                                                         dlna,
+                                                         target);
+        g_assert (enc_profile != NULL);
+
+        audio = get_audio_profile (enc_profile);
+        g_assert (caps_equal_string (gst_encoding_profile_get_format (audio),
+                                     spec->audio));
+
+        gst_encoding_profile_unref (enc_profile);
+}
+
+static void
+check_impossible (GUPnPDLNADiscoverer  *discoverer,
+                  GUPnPDLNAInformation *dlna,
+                  GUPnPDLNAProfile     *target)
+{
+        g_assert (gupnp_dlna_discoverer_get_transcode_flags (discoverer,
+                                                             dlna,
+                                                             target) &
+                  GUPNP_DLNA_TRANSCODE_IMPOSSIBLE);
+        g_assert (gupnp_dlna_discoverer_get_passthrough_profile (discoverer,
+                                                                 dlna,
+                                                                 target) ==
+                  NULL);
+}
+
+int
+main (int argc, char **argv)
+{
+        GUPnPDLNADiscoverer *discoverer;
+        GUPnPDLNAInformation *dlna;
+        GList *profiles, *ranked;
+        gchar *dir, *wav_path, *wav_uri;
+        GError *error = NULL;
+
+        if (!g_thread_supported ())
+                g_thread_init (NULL);
+
+        gst_init (&argc, &argv);
+
+        g_log_set_always_fatal (G_LOG_LEVEL_CRITICAL | G_LOG_LEVEL_WARNING);
+
+        dir = g_build_filename (g_get_tmp_dir (),
+                                "gupnp-dlna-passthrough-XXXXXX",
+                                NULL);
+        if (!mkdtemp (dir)) {
+                g_printerr ("Could not create a temporary directory\n");
+                return EXIT_FAILURE;
+        }
+
+        wav_path = g_build_filename (dir, "tone.wav", NULL);
+
+        if (!test_util_encode_wav (wav_path)) {
+                g_printerr ("Could not encode a WAV file, skipping\n");
+                g_unlink (wav_path);
+                g_rmdir (dir);
+                return EXIT_SKIP;
+        }
+
+        wav_uri = g_filename_to_uri (wav_path, NULL, NULL);
+
+        discoverer = gupnp_dlna_discoverer_new (5 * GST_SECOND, FALSE, FALSE);
+        dlna = gupnp_dlna_discoverer_discover_uri_sync (discoverer,
+                                                        wav_uri,
+                                                        &error);
+        if (error)
+                g_error ("Could not discover %s: %s", wav_uri, error->message);
+        g_assert (dlna != NULL);
+        g_assert (gupnp_dlna_information_get_info (dlna) != NULL);
+
+        profiles = test_util_build_profiles (targets, G_N_ELEMENTS (targets));
+
+        check_fitting (discoverer,
+                       dlna,
+                       g_list_nth_data (profiles, 0),
+                       &targets[0]);
+        check_not_fitting (discoverer,
+                           dlna,
+                           g_list_nth_data (profiles, 1),
+                           &targets[1]);
+        check_impossible (discoverer, dlna, g_list_nth_data (profiles, 2));
+
+        /* Passing the audio through beats re-encoding it, whatever the
+         * order the targets are given in */
+        profiles = g_list_reverse (profiles);
+        ranked = gupnp_dlna_discoverer_rank_targets (discoverer,
+                                                     dlna,
+                                                     profiles);
+        profiles = g_list_reverse (profiles);
+        g_assert_cmpuint (g_list_length (ranked), ==, 2);
+        g_assert (ranked->data == g_list_nth_data (profiles, 0));
+        g_assert (ranked->next->data == g_list_nth_data (profiles, 1));
+        g_list_free (ranked);
+
+        g_list_foreach (profiles, (GFunc) g_object_unref, NULL);
+        g_list_free (profiles);
+        g_object_unref (dlna);
+        g_object_unref (discoverer);
+
+        g_unlink (wav_path);
+        g_rmdir (dir);
+
+        g_free (wav_uri);
+        g_free (wav_path);
+        g_free (dir);
+
+        return EXIT_SUCCESS;
+}
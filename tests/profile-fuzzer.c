@@ -0,0 +1,699 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Fuzzes the profile loader with mutated profile files.
+ *
+ * The seed files (the corner cases in tests/xml and the shipped profiles in
+ * data, by default) are first loaded as they are, then parsed into trees
+ * that are mutated the way profile files actually go wrong: elements are
+ * dropped, duplicated, moved, renamed or spliced in from another seed, and
+ * attributes and values are replaced with ones taken from the seeds or with
+ * known troublemakers. A few inputs are also damaged byte-wise after being
+ * serialized, to reach the paths for files that are not well-formed.
+ *
+ * Every input is written to input.xml in the work directory before being
+ * loaded, so that it is left behind if the loader crashes (build with
+ * --enable-sanitizers to catch memory errors as well). Warnings are expected,
+ * but any critical is treated as a bug and stops the run.
+ *
+ * The run is time-boxed by --time, or the FUZZ_TIME environment variable
+ * that "make check" uses, and can be replayed with --seed.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+#include <libxml/parser.h>
+#include <libxml/tree.h>
+#include <libgupnp-dlna/gupnp-dlna-profile.h>
+#include <libgupnp-dlna/profile-loading.h>
+
+#define DEFAULT_TIME 10
+
+typedef enum {
+        MUTATE_DELETE,
+        MUTATE_DUPLICATE,
+        MUTATE_SPLICE,
+        MUTATE_MOVE,
+        MUTATE_RENAME,
+        MUTATE_SET_ATTRIBUTE,
+        MUTATE_REMOVE_ATTRIBUTE,
+        MUTATE_SET_TEXT,
+        MUTATE_LAST
+} Mutation;
+
+/* Everything the mutator picks from */
+typedef struct {
+        GPtrArray *seeds;
+        GPtrArray *elements;
+        GPtrArray *attributes;
+        GPtrArray *values;
+} FuzzDictionary;
+
+static const gchar *element_names[] = {
+        "dlna-profiles", "dlna-profile", "restrictions", "restriction",
+        "parent", "field", "value", "range", "include", NULL
+};
+
+static const gchar *attribute_names[] = {
+        "name", "mime", "id", "type", "used", "base-profile", "extended",
+        "priority", "ref", "min", "max", NULL
+};
+
+/* Values that are known to upset parsers, on top of those found in the
+ * seeds */
+static const gchar *interesting_values[] = {
+        "", " ", "0", "-1", "1", "2147483647", "2147483648", "-2147483649",
+        "99999999999999999999", "1/0", "0/0", "-1/-1", "0.0", "nan", "1e999",
+        "[ 1, 2 ]", "{ 1, 2 }", "{", "}", "[", "]", "(", ")", ",", ";", "=",
+        "\"", "\\", "\"unterminated", "(int)", "(string) x", "NULL", "ANY",
+        "EMPTY", "NONE", "true", "false", "in-relaxed", "in-strict",
+        "container", "audio", "video", "image", "int", "string", "fraction",
+        "boolean", "audio/mpeg, mpegversion = (int) 1", "%s%s%s%n", NULL
+};
+
+static gint fuzz_time = 0;
+static gint iterations = 0;
+static guint32 seed = 0;
+static gchar *work_dir = NULL;
+
+static guint n_criticals = 0;
+static guint n_warnings = 0;
+
+static void
+log_handler (const gchar    *domain,
+             GLogLevelFlags level,
+             const gchar    *message,
+             gpointer       user_data)
+{
+        if (level & (G_LOG_LEVEL_CRITICAL | G_LOG_LEVEL_ERROR)) {
+                g_printerr ("%s-CRITICAL: %s\n",
+                            domain ? domain : "",
+                            message);
+                n_criticals++;
+        } else if (level & G_LOG_LEVEL_WARNING)
+                n_warnings++;
+}
+
+/* libxml2 complains about every broken input on stderr */
+static void
+silent_error_handler (void *ctx, const char *msg, ...)
+{
+}
+
+static void
+add_word (GPtrArray *words, const gchar *word)
+{
+        guint i;
+
+        for (i = 0; i < words->len; i++)
+                if (g_str_equal (g_ptr_array_index (words, i), word))
+                        return;
+
+        g_ptr_array_add (words, g_strdup (word));
+}
+
+static void
+harvest_node (FuzzDictionary *dict, xmlNodePtr node)
+{
+        for (; node; node = node->next) {
+                xmlAttrPtr attr;
+
+                if (node->type == XML_TEXT_NODE) {
+                        xmlChar *text = xmlNodeGetContent (node);
+                        gchar *stripped = g_strstrip (g_strdup ((gchar *)
+                                                                text));
+
+                        if (*stripped)
+                                add_word (dict->values, stripped);
+
+                        g_free (stripped);
+                        xmlFree (text);
+                }
+
+                if (node->type != XML_ELEMENT_NODE)
+                        continue;
+
+                add_word (dict->elements, (gchar *) node->name);
+
+                for (attr = node->properties; attr; attr = attr->next) {
+                        xmlChar *value = xmlNodeGetContent ((xmlNodePtr) attr);
+
+                        add_word (dict->attributes, (gchar *) attr->name);
+                        if (value)
+                                add_word (dict->values, (gchar *) value);
+                        xmlFree (value);
+                }
+
+                harvest_node (dict, node->children);
+        }
+}
+
+static void
+add_seed (FuzzDictionary *dict, const gchar *path)
+{
+        xmlDocPtr doc;
+
+        if (g_file_test (path, G_FILE_TEST_IS_DIR)) {
+                GDir *dir;
+                const gchar *entry;
+                GList *entries = NULL, *i;
+
+                dir = g_dir_open (path, 0, NULL);
+                if (!dir)
+                        return;
+
+                while ((entry = g_dir_read_name (dir)))
+                        entries = g_list_prepend (entries, g_strdup (entry));
+                g_dir_close (dir);
+
+                /* Sorted, so that --seed replays the same run */
+                entries = g_list_sort (entries, (GCompareFunc) strcmp);
+
+                for (i = entries; i; i = i->next) {
+                        gchar *child = g_build_filename (path, i->data, NULL);
+
+                        if (g_file_test (child, G_FILE_TEST_IS_DIR) ||
+                            g_str_has_suffix (child, ".xml"))
+                                add_seed (dict, child);
+
+                        g_free (child);
+                        g_free (i->data);
+                }
+
+                g_list_free (entries);
+
+                return;
+        }
+
+        doc = xmlReadFile (path, NULL, XML_PARSE_NONET);
+        if (!doc || !xmlDocGetRootElement (doc)) {
+                g_printerr ("Skipping %s, it is not well-formed\n", path);
+                if (doc)
+                        xmlFreeDoc (doc);
+
+                return;
+        }
+
+        g_ptr_array_add (dict->seeds, doc);
+        harvest_node (dict, xmlDocGetRootElement (doc));
+
+        /* Lets <include>s pull in the other seeds */
+        if (g_path_is_absolute (path))
+                add_word (dict->values, path);
+        else {
+                gchar *cwd = g_get_current_dir ();
+                gchar *abs_path = g_build_filename (cwd, path, NULL);
+
+                add_word (dict->values, abs_path);
+                g_free (abs_path);
+                g_free (cwd);
+        }
+}
+
+static void
+add_words (GPtrArray *words, const gchar **list)
+{
+        for (; *list; list++)
+                add_word (words, *list);
+}
+
+static void
+free_words (GPtrArray *words)
+{
+        g_ptr_array_foreach (words, (GFunc) g_free, NULL);
+        g_ptr_array_free (words, TRUE);
+}
+
+static const gchar *
+pick_word (GRand *rand, GPtrArray *words)
+{
+        return g_ptr_array_index (words,
+                                  g_rand_int_range (rand, 0, words->len));
+}
+
+static void
+collect_elements (xmlNodePtr node, GPtrArray *elements)
+{
+        for (; node; node = node->next) {
+                if (node->type != XML_ELEMENT_NODE)
+                        continue;
+
+                g_ptr_array_add (elements, node);
+                collect_elements (node->children, elements);
+        }
+}
+
+static gboolean
+is_ancestor (xmlNodePtr ancestor, xmlNodePtr node)
+{
+        for (; node; node = node->parent)
+                if (node == ancestor)
+                        return TRUE;
+
+        return FALSE;
+}
+
+static gchar *
+mutate_text (GRand *rand, const gchar *text)
+{
+        GString *str = g_string_new (text);
+
+        switch (g_rand_int_range (rand, 0, 4)) {
+        case 0:
+                /* Truncate */
+                g_string_truncate (str,
+                                   g_rand_int_range (rand, 0, str->len + 1));
+                break;
+        case 1:
+                /* Repeat */
+                while (str->len && str->len < 4096)
+                        g_string_append (str, text);
+                break;
+        case 2:
+                /* Flip a character */
+                if (str->len)
+                        str->str[g_rand_int_range (rand, 0, str->len)] ^=
+                                1 << g_rand_int_range (rand, 0, 7);
+                break;
+        default:
+                /* Glue something on */
+                g_string_append (str, interesting_values
+                                 [g_rand_int_range
+                                  (rand,
+                                   0,
+                                   G_N_ELEMENTS (interesting_values) - 1)]);
+                break;
+        }
+
+        return g_string_free (str, FALSE);
+}
+
+static void
+mutate_doc (GRand *rand, FuzzDictionary *dict, xmlDocPtr doc)
+{
+        GPtrArray *elements = g_ptr_array_new ();
+        xmlNodePtr root = xmlDocGetRootElement (doc);
+        xmlNodePtr node, other;
+        gchar *text;
+
+        collect_elements (root, elements);
+        node = g_ptr_array_index (elements,
+                                  g_rand_int_range (rand, 0, elements->len));
+        other = g_ptr_array_index (elements,
+                                   g_rand_int_range (rand, 0, elements->len));
+
+        switch (g_rand_int_range (rand, 0, MUTATE_LAST)) {
+        case MUTATE_DELETE:
+                if (node != root) {
+                        xmlUnlinkNode (node);
+                        xmlFreeNode (node);
+                }
+
+                break;
+
+        case MUTATE_DUPLICATE:
+                if (node != root)
+                        xmlAddNextSibling (node, xmlCopyNode (node, 1));
+
+                break;
+
+        case MUTATE_SPLICE: {
+                xmlDocPtr donor = g_ptr_array_index (dict->seeds,
+                                                     g_rand_int_range
+                                                     (rand,
+                                                      0,
+                                                      dict->seeds->len));
+                GPtrArray *donor_elements = g_ptr_array_new ();
+                xmlNodePtr copy;
+
+                collect_elements (xmlDocGetRootElement (donor),
+                                  donor_elements);
+                copy = xmlDocCopyNode (g_ptr_array_index
+                                       (donor_elements,
+                                        g_rand_int_range
+                                        (rand,
+                                         0,
+                                         donor_elements->len)),
+                                       doc,
+                                       1);
+                xmlAddChild (node, copy);
+                g_ptr_array_free (donor_elements, TRUE);
+
+                break;
+        }
+
+        case MUTATE_MOVE:
+                if (node != root && !is_ancestor (node, other)) {
+                        xmlUnlinkNode (node);
+                        xmlAddChild (other, node);
+                }
+
+                break;
+
+        case MUTATE_RENAME:
+                xmlNodeSetName (node,
+                                BAD_CAST (pick_word (rand, dict->elements)));
+                break;
+
+        case MUTATE_SET_ATTRIBUTE:
+                xmlSetProp (node,
+                            BAD_CAST (pick_word (rand, dict->attributes)),
+                            BAD_CAST (pick_word (rand, dict->values)));
+                break;
+
+        case MUTATE_REMOVE_ATTRIBUTE:
+                if (node->properties)
+                        xmlRemoveProp (node->properties);
+
+                break;
+
+        case MUTATE_SET_TEXT:
+                if (g_rand_boolean (rand))
+                        text = g_strdup (pick_word (rand, dict->values));
+                else {
+                        xmlChar *content = xmlNodeGetContent (node);
+
+                        text = mutate_text (rand, (gchar *) content);
+                        xmlFree (content);
+                }
+
+                xmlNodeSetContent (node, NULL);
+                xmlNodeAddContent (node, BAD_CAST (text));
+                g_free (text);
+
+                break;
+
+        default:
+                g_assert_not_reached ();
+        }
+
+        g_ptr_array_free (elements, TRUE);
+}
+
+static void
+free_restrictions_struct (gpointer data, gpointer user_data)
+{
+        GUPnPDLNARestrictions *restr = (GUPnPDLNARestrictions *)data;
+        if (restr) {
+                if (restr->caps)
+                        gst_caps_unref (restr->caps);
+
+                g_free (restr);
+        }
+}
+
+static void
+load_input (const gchar *path, gboolean relaxed_mode, gboolean extended_mode)
+{
+        GUPnPDLNALoadState *data;
+        GList *profiles, *l;
+
+        data = g_new (GUPnPDLNALoadState, 1);
+
+        data->restrictions = g_hash_table_new_full (g_str_hash,
+                                                    g_str_equal,
+                                                    (GDestroyNotify) xmlFree,
+                                                    (GDestroyNotify)
+                                                    free_restrictions_struct);
+        data->profile_ids = g_hash_table_new_full (g_str_hash,
+                                                   g_str_equal,
+                                                   (GDestroyNotify) xmlFree,
+                                                   (GDestroyNotify)
+                                                   g_object_unref);
+        data->files_hash = g_hash_table_new_full (g_str_hash,
+                                                  g_str_equal,
+                                                  g_free,
+                                                  NULL);
+
+        data->relaxed_mode = relaxed_mode;
+        data->extended_mode = extended_mode;
+
+        profiles = gupnp_dlna_load_profiles_from_file (path, data);
+
+        /* Use the profiles the way the matcher does */
+        for (l = profiles; l; l = l->next) {
+                GUPnPDLNAProfile *profile = l->data;
+                GstEncodingProfile *enc_profile;
+
+                g_assert (gupnp_dlna_profile_get_name (profile) != NULL);
+                g_assert (gupnp_dlna_profile_get_mime (profile) != NULL);
+
+                enc_profile = gupnp_dlna_profile_get_encoding_profile
+                                        (profile);
+                gst_encoding_profile_unref (enc_profile);
+        }
+
+        g_list_foreach (profiles, (GFunc) g_object_unref, NULL);
+        g_list_free (profiles);
+
+        g_hash_table_unref (data->restrictions);
+        g_hash_table_unref (data->profile_ids);
+        g_hash_table_unref (data->files_hash);
+        g_free (data);
+}
+
+static gboolean
+write_input (const gchar *path, const gchar *buffer, gsize size)
+{
+        GError *err = NULL;
+
+        if (!g_file_set_contents (path, buffer, size, &err)) {
+                g_printerr ("Could not write %s: %s\n", path, err->message);
+                g_error_free (err);
+
+                return FALSE;
+        }
+
+        return TRUE;
+}
+
+static gboolean
+run_input (const gchar *path,
+           const gchar *buffer,
+           gsize       size,
+           gboolean    relaxed_mode,
+           gboolean    extended_mode)
+{
+        if (!write_input (path, buffer, size))
+                return FALSE;
+
+        load_input (path, relaxed_mode, extended_mode);
+
+        return n_criticals == 0;
+}
+
+/* Damages a serialized input the way a truncated or badly edited file
+ * would be */
+static void
+damage_buffer (GRand *rand, xmlChar *buffer, gint size)
+{
+        static const gchar junk[] = "<>&\"'/=\0";
+        gint n = g_rand_int_range (rand, 1, 4);
+
+        if (size == 0)
+                return;
+
+        while (n--)
+                buffer[g_rand_int_range (rand, 0, size)] =
+                        junk[g_rand_int_range (rand, 0, sizeof (junk) - 1)];
+}
+
+int
+main (int argc, char **argv)
+{
+        FuzzDictionary dict = { NULL, };
+        GOptionContext *ctx;
+        GError *err = NULL;
+        GRand *rand;
+        GTimer *timer;
+        gchar *input_path;
+        const gchar *env;
+        gboolean own_work_dir = FALSE, ok = TRUE;
+        guint i, n_runs = 0;
+
+        GOptionEntry options[] = {
+                {"time", 't', 0, G_OPTION_ARG_INT, &fuzz_time,
+                 "Fuzz for T seconds (defaults to $FUZZ_TIME, or 10)", "T"},
+                {"iterations", 'n', 0, G_OPTION_ARG_INT, &iterations,
+                 "Stop after N mutated inputs", "N"},
+                {"seed", 's', 0, G_OPTION_ARG_INT, &seed,
+                 "Seed of the random mutations, to replay a run", "S"},
+                {"work-dir", 'w', 0, G_OPTION_ARG_FILENAME, &work_dir,
+                 "Keep the input being loaded in DIR", "DIR"},
+                {NULL}
+        };
+
+        if (!g_thread_supported ())
+                g_thread_init (NULL);
+
+        ctx = g_option_context_new ("<seed files and directories ...> - "
+                                    "fuzz the profile loader");
+        g_option_context_add_main_entries (ctx, options, NULL);
+        g_option_context_add_group (ctx, gst_init_get_option_group ());
+
+        if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+                g_printerr ("Error initializing: %s\n", err->message);
+                return EXIT_FAILURE;
+        }
+
+        g_option_context_free (ctx);
+
+        if (!fuzz_time) {
+                env = g_getenv ("FUZZ_TIME");
+                fuzz_time = env ? atoi (env) : DEFAULT_TIME;
+        }
+
+        if (!seed)
+                seed = (guint32) time (NULL);
+
+        g_log_set_default_handler (log_handler, NULL);
+        xmlSetGenericErrorFunc (NULL, silent_error_handler);
+
+        dict.seeds = g_ptr_array_new ();
+        dict.elements = g_ptr_array_new ();
+        dict.attributes = g_ptr_array_new ();
+        dict.values = g_ptr_array_new ();
+
+        add_words (dict.elements, element_names);
+        add_words (dict.attributes, attribute_names);
+        add_words (dict.values, interesting_values);
+
+        if (argc > 1) {
+                for (i = 1; i < (guint) argc; i++)
+                        add_seed (&dict, argv[i]);
+        } else if ((env = g_getenv ("FUZZ_SEEDS"))) {
+                gchar **paths = g_strsplit (env, G_SEARCHPATH_SEPARATOR_S, -1);
+
+                for (i = 0; paths[i]; i++)
+                        add_seed (&dict, paths[i]);
+
+                g_strfreev (paths);
+        }
+
+        if (!dict.seeds->len) {
+                g_printerr ("No seed files, skipping\n");
+                return 77;
+        }
+
+        if (!work_dir) {
+                work_dir = g_build_filename (g_get_tmp_dir (),
+                                             "profile-fuzzer-XXXXXX",
+                                             NULL);
+                if (!mkdtemp (work_dir)) {
+                        g_printerr ("Could not create %s\n", work_dir);
+                        return EXIT_FAILURE;
+                }
+
+                own_work_dir = TRUE;
+        } else
+                g_mkdir_with_parents (work_dir, 0755);
+
+        input_path = g_build_filename (work_dir, "input.xml", NULL);
+        add_word (dict.values, input_path);
+
+        g_print ("Fuzzing with %u seeds for %d seconds, seed %u, input in "
+                 "%s\n",
+                 dict.seeds->len,
+                 fuzz_time,
+                 seed,
+                 input_path);
+
+        rand = g_rand_new_with_seed (seed);
+        timer = g_timer_new ();
+
+        /* The seeds as they are first */
+        for (i = 0; ok && i < dict.seeds->len; i++) {
+                xmlChar *buffer;
+                gint size;
+
+                xmlDocDumpMemory (g_ptr_array_index (dict.seeds, i),
+                                  &buffer,
+                                  &size);
+                ok = run_input (input_path, (gchar *) buffer, size,
+                                i % 2, i % 4 > 1);
+                xmlFree (buffer);
+        }
+
+        while (ok &&
+               g_timer_elapsed (timer, NULL) < fuzz_time &&
+               (!iterations || n_runs < (guint) iterations)) {
+                xmlDocPtr doc;
+                xmlChar *buffer;
+                gint size, n_mutations;
+
+                doc = xmlCopyDoc (g_ptr_array_index
+                                  (dict.seeds,
+                                   g_rand_int_range (rand,
+                                                     0,
+                                                     dict.seeds->len)),
+                                  1);
+
+                n_mutations = g_rand_int_range (rand, 1, 5);
+                while (n_mutations--)
+                        mutate_doc (rand, &dict, doc);
+
+                xmlDocDumpMemory (doc, &buffer, &size);
+                xmlFreeDoc (doc);
+
+                if (g_rand_int_range (rand, 0, 16) == 0)
+                        damage_buffer (rand, buffer, size);
+
+                ok = run_input (input_path,
+                                (gchar *) buffer,
+                                size,
+                                g_rand_boolean (rand),
+                                g_rand_boolean (rand));
+                xmlFree (buffer);
+
+                n_runs++;
+        }
+
+        g_print ("%u inputs in %.1f s, %u warnings\n",
+                 n_runs + dict.seeds->len,
+                 g_timer_elapsed (timer, NULL),
+                 n_warnings);
+
+        if (ok) {
+                g_unlink (input_path);
+                if (own_work_dir)
+                        g_rmdir (work_dir);
+        } else
+                g_printerr ("Failing input left in %s (replay with "
+                            "--seed=%u)\n",
+                            input_path,
+                            seed);
+
+        g_timer_destroy (timer);
+        g_rand_free (rand);
+        g_free (input_path);
+        g_free (work_dir);
+
+        g_ptr_array_foreach (dict.seeds, (GFunc) xmlFreeDoc, NULL);
+        g_ptr_array_free (dict.seeds, TRUE);
+        free_words (dict.elements);
+        free_words (dict.attributes);
+        free_words (dict.values);
+
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
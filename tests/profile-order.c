@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Checks that adaptive profile ordering moves frequently matched profiles
+ * forward without changing which profile any stream matches, and that the
+ * learnt order survives a save and load.
+ */
+
+#include <gst/gst.h>
+#include <glib/gstdio.h>
+#include <libgupnp-dlna/gupnp-dlna-profile.h>
+#include <libgupnp-dlna/profile-registry.h>
+#include <libgupnp-dlna/profile-order.h>
+#include <libgupnp-dlna/stream-description.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "test-util.h"
+
+/* AVC_SD and AVC_HD overlap: a small H.264 stream fits both, and has to keep
+ * getting AVC_SD however often AVC_HD is matched. The audio restrictions of
+ * AAC_ISO and AAC_MULT5_ISO do not intersect, but a file with a stereo and
+ * a 5.1 track fits both. */
+static const TestProfile test_profiles[] = {
+        { "MP3", "audio/mpeg", NULL, NULL,
+          "audio/mpeg, mpegversion=(int)1, layer=(int)3" },
+        { "AAC_ADTS", "audio/vnd.dlna.adts",
+          "audio/mpeg, mpegversion=(int)4, stream-format=(string)adts", NULL,
+          "audio/mpeg, mpegversion=(int)4" },
+        { "AVC_SD", "video/mp4", "video/quicktime",
+          "video/x-h264, width=(int)[ 1, 720 ]",
+          "audio/mpeg, mpegversion=(int)4" },
+        { "AVC_HD", "video/mp4", "video/quicktime",
+          "video/x-h264, width=(int)[ 1, 1920 ]",
+          "audio/mpeg, mpegversion=(int)4" },
+        { "MPEG2", "video/mpeg", "video/mpegts",
+          "video/mpeg, mpegversion=(int)2",
+          "audio/x-ac3" },
+        { "JPEG", "image/jpeg", NULL, "image/jpeg", NULL },
+        { "AAC_ISO", "audio/mp4", "video/quicktime", NULL,
+          "audio/mpeg, mpegversion=(int)4, channels=(int)[ 1, 2 ]" },
+        { "AAC_MULT5_ISO", "audio/mp4", "video/quicktime", NULL,
+          "audio/mpeg, mpegversion=(int)4, channels=(int)[ 3, 6 ]" },
+};
+
+static const TestStream test_streams[] = {
+        { NULL, NULL, "audio/mpeg, mpegversion=(int)1, layer=(int)3", FALSE },
+        { "audio/mpeg, mpegversion=(int)4, stream-format=(string)adts",
+          NULL, "audio/mpeg, mpegversion=(int)4", FALSE },
+        { "video/quicktime", "video/x-h264, width=(int)640",
+          "audio/mpeg, mpegversion=(int)4", FALSE },
+        { "video/quicktime", "video/x-h264, width=(int)1920",
+          "audio/mpeg, mpegversion=(int)4", FALSE },
+        { "video/mpegts", "video/mpeg, mpegversion=(int)2", "audio/x-ac3",
+          FALSE },
+        { NULL, "image/jpeg", NULL, TRUE },
+        { "video/quicktime", NULL,
+          "audio/mpeg, mpegversion=(int)4, channels=(int)2", FALSE,
+          "audio/mpeg, mpegversion=(int)4, channels=(int)6" },
+};
+
+static gchar *
+guess (const TestStream *stream, const GUPnPDLNAProfileTable *profiles)
+{
+        GUPnPDLNAStreamDescription *desc;
+        gchar *name = NULL, *mime = NULL;
+
+        desc = test_util_describe (stream);
+        gupnp_dlna_stream_description_guess_profile (desc,
+                                                     profiles,
+                                                     NULL,
+                                                     &name,
+                                                     &mime);
+        gupnp_dlna_stream_description_free (desc);
+        g_free (mime);
+
+        return name;
+}
+
+static gint
+find (const GUPnPDLNAProfileTable *table, const gchar *name)
+{
+        guint i;
+
+        for (i = 0; i < table->n_profiles; i++)
+                if (g_str_equal (table->names[i], name))
+                        return i;
+
+        return -1;
+}
+
+static void
+check_order (const GUPnPDLNAProfileTable *table)
+{
+        g_assert_cmpuint (table->n_profiles, ==, G_N_ELEMENTS (test_profiles));
+
+        /* The most matched profile that nothing comes before */
+        g_assert_cmpint (find (table, "MPEG2"), ==, 0);
+        /* Matched more often, but overlaps with an earlier profile */
+        g_assert_cmpint (find (table, "AVC_SD"), <, find (table, "AVC_HD"));
+        /* Only overlaps through files with several audio streams */
+        g_assert_cmpint (find (table, "AAC_ISO"),
+                         <,
+                         find (table, "AAC_MULT5_ISO"));
+}
+
+static void
+check_results (GUPnPDLNAProfileRegistry    *registry,
+               const GUPnPDLNAProfileTable *table)
+{
+        const GUPnPDLNAProfileTable *reference;
+        guint i;
+
+        reference = gupnp_dlna_profile_registry_get_candidates
+                                        (registry, GUPNP_DLNA_SNIFF_UNKNOWN);
+
+        for (i = 0; i < G_N_ELEMENTS (test_streams); i++) {
+                gchar *expected, *name;
+
+                expected = guess (&test_streams[i], reference);
+                name = guess (&test_streams[i], table);
+
+                g_assert (expected != NULL);
+                g_assert_cmpstr (name, ==, expected);
+
+                g_free (expected);
+                g_free (name);
+        }
+}
+
+int
+main (int argc, char **argv)
+{
+        GUPnPDLNAProfileRegistry *registry;
+        GUPnPDLNAProfileOrder *order;
+        const GUPnPDLNAProfileTable *table;
+        GError *error = NULL;
+        gchar *filename;
+        guint i;
+        gint fd;
+
+        if (!g_thread_supported ())
+                g_thread_init (NULL);
+
+        gst_init (&argc, &argv);
+
+        registry = gupnp_dlna_profile_registry_new
+                        (test_util_build_profiles
+                                (test_profiles,
+                                 G_N_ELEMENTS (test_profiles)));
+        order = gupnp_dlna_profile_order_new (registry);
+
+        /* Nothing learnt yet, the registry's order is used */
+        table = gupnp_dlna_profile_order_get_candidates
+                                        (order, GUPNP_DLNA_SNIFF_UNKNOWN);
+        g_assert (table == gupnp_dlna_profile_registry_get_candidates
+                                        (registry, GUPNP_DLNA_SNIFF_UNKNOWN));
+
+        for (i = 0; i < 200; i++)
+                gupnp_dlna_profile_order_record_match (order, "AVC_HD");
+        for (i = 0; i < 100; i++)
+                gupnp_dlna_profile_order_record_match (order, "MPEG2");
+        for (i = 0; i < 50; i++)
+                gupnp_dlna_profile_order_record_match (order, "AAC_MULT5_ISO");
+
+        table = gupnp_dlna_profile_order_get_candidates
+                                        (order, GUPNP_DLNA_SNIFF_UNKNOWN);
+        check_order (table);
+        check_results (registry, table);
+
+        filename = g_build_filename (g_get_tmp_dir (),
+                                     "gupnp-dlna-order-XXXXXX",
+                                     NULL);
+        fd = g_mkstemp (filename);
+        g_assert (fd >= 0);
+        close (fd);
+
+        if (!gupnp_dlna_profile_order_save (order, filename, &error))
+                g_error ("Could not save the order: %s", error->message);
+        gupnp_dlna_profile_order_free (order);
+
+        /* A restarted process starts with the learnt order */
+        order = gupnp_dlna_profile_order_new (registry);
+        if (!gupnp_dlna_profile_order_load (order, filename, &error))
+                g_error ("Could not load the order: %s", error->message);
+
+        table = gupnp_dlna_profile_order_get_candidates
+                                        (order, GUPNP_DLNA_SNIFF_UNKNOWN);
+        check_order (table);
+        check_results (registry, table);
+
+        g_unlink (filename);
+        g_free (filename);
+        gupnp_dlna_profile_order_free (order);
+        gupnp_dlna_profile_registry_unref (registry);
+
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,395 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Matches a fixed set of stream descriptions against one shared profile
+ * registry from several threads at once, and checks that every thread gets
+ * the same answers as a single thread does. Configure with
+ * --enable-thread-sanitizer to have ThreadSanitizer check for races.
+ *
+ * Profiles are loaded from the directory given on the command line or in
+ * PROFILE_DIR.
+ */
+
+#include <gst/gst.h>
+#include <gst/pbutils/pbutils.h>
+#include <libgupnp-dlna/profile-loading.h>
+#include <libgupnp-dlna/profile-registry.h>
+#include <libgupnp-dlna/stream-description.h>
+#include <stdlib.h>
+
+typedef struct {
+        const gchar *container;
+        const gchar *video;
+        const gchar *audio;
+        gboolean    is_image;
+} TestStream;
+
+static const TestStream test_streams[] = {
+        { NULL,
+          NULL,
+          "audio/mpeg, mpegversion=(int)1, layer=(int)3, rate=(int)44100, "
+          "channels=(int)2, bitrate=(uint)128000",
+          FALSE },
+        { NULL,
+          NULL,
+          "audio/mpeg, mpegversion=(int)4, stream-format=(string)adts, "
+          "rate=(int)48000, channels=(int)2, bitrate=(uint)128000",
+          FALSE },
+        { NULL,
+          "image/jpeg, width=(int)640, height=(int)480",
+          NULL,
+          TRUE },
+        { NULL,
+          "image/png, width=(int)640, height=(int)480, depth=(int)24",
+          NULL,
+          TRUE },
+        { "video/quicktime, variant=(string)iso",
+          "video/x-h264, width=(int)1280, height=(int)720, "
+          "framerate=(fraction)30/1, pixel-aspect-ratio=(fraction)1/1",
+          "audio/mpeg, mpegversion=(int)4, stream-format=(string)raw, "
+          "rate=(int)48000, channels=(int)2, bitrate=(uint)128000",
+          FALSE },
+        { "video/mpegts, systemstream=(boolean)true, packetsize=(int)188",
+          "video/mpeg, mpegversion=(int)2, systemstream=(boolean)false, "
+          "width=(int)720, height=(int)576, framerate=(fraction)25/1, "
+          "pixel-aspect-ratio=(fraction)16/15",
+          "audio/x-ac3, rate=(int)48000, channels=(int)2, "
+          "bitrate=(uint)384000",
+          FALSE },
+};
+
+#define N_STREAMS G_N_ELEMENTS (test_streams)
+
+static gint n_threads = 8;
+static gint n_iterations = 200;
+
+static GUPnPDLNAStreamDescription *descriptions[N_STREAMS];
+static gchar *expected[N_STREAMS];
+
+static GMutex *start_mutex;
+static GCond *start_cond;
+static gboolean started = FALSE;
+
+static volatile gint failures = 0;
+
+static void
+wait_for_start (void)
+{
+        g_mutex_lock (start_mutex);
+        while (!started)
+                g_cond_wait (start_cond, start_mutex);
+        g_mutex_unlock (start_mutex);
+}
+
+static void
+start_threads (void)
+{
+        g_mutex_lock (start_mutex);
+        started = TRUE;
+        g_cond_broadcast (start_cond);
+        g_mutex_unlock (start_mutex);
+}
+
+static gchar *
+guess (GUPnPDLNAStreamDescription  *desc,
+       const GUPnPDLNAProfileTable *profiles)
+{
+        gchar *name = NULL, *mime = NULL, *ret;
+
+        gupnp_dlna_stream_description_guess_profile (desc,
+                                                     profiles,
+                                                     NULL,
+                                                     &name,
+                                                     &mime);
+
+        ret = g_strdup_printf ("%s (%s)",
+                               name ? name : "-",
+                               mime ? mime : "-");
+        g_free (name);
+        g_free (mime);
+
+        return ret;
+}
+
+/* Builds the encoding profile of each profile that has not been frozen into
+ * a registry yet, from all threads at once */
+static gpointer
+encoding_profile_thread (gpointer data)
+{
+        GList *profiles = data, *i;
+        GPtrArray *ret = g_ptr_array_new ();
+
+        wait_for_start ();
+
+        for (i = profiles; i; i = i->next) {
+                GstEncodingProfile *enc_profile;
+
+                enc_profile = gupnp_dlna_profile_get_encoding_profile
+                                        (GUPNP_DLNA_PROFILE (i->data));
+                g_ptr_array_add (ret, enc_profile);
+                gst_encoding_profile_unref (enc_profile);
+        }
+
+        return ret;
+}
+
+static gpointer
+match_thread (gpointer data)
+{
+        GUPnPDLNAProfileRegistry *registry = data;
+        gint n;
+        guint i;
+
+        wait_for_start ();
+
+        for (n = 0; n < n_iterations; n++) {
+                gupnp_dlna_profile_registry_ref (registry);
+
+                for (i = 0; i < N_STREAMS; i++) {
+                        gchar *result;
+
+                        result = guess (descriptions[i],
+                                        gupnp_dlna_profile_registry_get_table
+                                                (registry));
+
+                        if (!g_str_equal (result, expected[i])) {
+                                g_printerr ("Stream %u matched %s instead "
+                                            "of %s\n",
+                                            i,
+                                            result,
+                                            expected[i]);
+                                g_atomic_int_inc (&failures);
+                        }
+
+                        g_free (result);
+                }
+
+                gupnp_dlna_profile_registry_unref (registry);
+        }
+
+        return NULL;
+}
+
+static GList *
+load_profiles (const gchar *profile_dir)
+{
+        GUPnPDLNALoadState *data;
+        GList *profiles;
+
+        data = g_new0 (GUPnPDLNALoadState, 1);
+        data->files_hash = g_hash_table_new_full (g_str_hash,
+                                                  g_str_equal,
+                                                  g_free,
+                                                  NULL);
+
+        profiles = gupnp_dlna_load_profiles_from_dir ((gchar *) profile_dir,
+                                                      data);
+
+        g_hash_table_unref (data->files_hash);
+        g_free (data);
+
+        return profiles;
+}
+
+static GstCaps *
+caps_or_null (const gchar *str)
+{
+        return str ? gst_caps_from_string (str) : NULL;
+}
+
+static void
+build_descriptions (void)
+{
+        guint i;
+
+        for (i = 0; i < N_STREAMS; i++) {
+                GUPnPDLNAStreamDescription *desc;
+
+                desc = gupnp_dlna_stream_description_new ();
+                desc->container = caps_or_null (test_streams[i].container);
+                if (test_streams[i].video)
+                        desc->video = g_list_append
+                                (NULL,
+                                 gst_caps_from_string (test_streams[i].video));
+                if (test_streams[i].audio)
+                        desc->audio = g_list_append
+                                (NULL,
+                                 gst_caps_from_string (test_streams[i].audio));
+                desc->is_image = test_streams[i].is_image;
+
+                descriptions[i] = desc;
+        }
+}
+
+static gboolean
+check_encoding_profiles (GList *profiles)
+{
+        GThread **threads;
+        GPtrArray *first = NULL;
+        gboolean ret = TRUE;
+        gint i;
+
+        started = FALSE;
+        threads = g_new (GThread *, n_threads);
+
+        for (i = 0; i < n_threads; i++)
+                threads[i] = g_thread_create (encoding_profile_thread,
+                                              profiles,
+                                              TRUE,
+                                              NULL);
+
+        start_threads ();
+
+        for (i = 0; i < n_threads; i++) {
+                GPtrArray *built = g_thread_join (threads[i]);
+                guint j;
+
+                if (!first) {
+                        first = built;
+                        continue;
+                }
+
+                for (j = 0; j < built->len; j++)
+                        if (g_ptr_array_index (built, j) !=
+                            g_ptr_array_index (first, j)) {
+                                g_printerr ("Encoding profile %u was built "
+                                            "more than once\n", j);
+                                ret = FALSE;
+                        }
+
+                g_ptr_array_free (built, TRUE);
+        }
+
+        if (first)
+                g_ptr_array_free (first, TRUE);
+        g_free (threads);
+
+        return ret;
+}
+
+static void
+check_matching (GUPnPDLNAProfileRegistry *registry)
+{
+        GThread **threads;
+        guint i;
+
+        for (i = 0; i < N_STREAMS; i++) {
+                expected[i] = guess (descriptions[i],
+                                     gupnp_dlna_profile_registry_get_table
+                                                (registry));
+                g_print ("Stream %u: %s\n", i, expected[i]);
+        }
+
+        started = FALSE;
+        threads = g_new (GThread *, n_threads);
+
+        for (i = 0; i < (guint) n_threads; i++)
+                threads[i] = g_thread_create (match_thread,
+                                              registry,
+                                              TRUE,
+                                              NULL);
+
+        start_threads ();
+
+        for (i = 0; i < (guint) n_threads; i++)
+                g_thread_join (threads[i]);
+
+        g_free (threads);
+}
+
+int
+main (int argc, char **argv)
+{
+        GUPnPDLNAProfileRegistry *registry;
+        GList *profiles;
+        GError *err = NULL;
+        GOptionContext *ctx;
+        const gchar *profile_dir;
+        guint i;
+        gboolean ok;
+
+        GOptionEntry options[] = {
+                {"threads", 't', 0, G_OPTION_ARG_INT, &n_threads,
+                 "Number of matching threads", NULL},
+                {"iterations", 'n', 0, G_OPTION_ARG_INT, &n_iterations,
+                 "Number of times each thread matches every stream", NULL},
+                {NULL}
+        };
+
+        if (!g_thread_supported ())
+                g_thread_init (NULL);
+
+        ctx = g_option_context_new (" [profile-dir] - stress test the "
+                                    "profile registry");
+        g_option_context_add_main_entries (ctx, options, NULL);
+        g_option_context_add_group (ctx, gst_init_get_option_group ());
+
+        if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+                g_print ("Error initializing: %s\n", err->message);
+                exit (1);
+        }
+
+        g_option_context_free (ctx);
+
+        profile_dir = argc > 1 ? argv[1] : g_getenv ("PROFILE_DIR");
+        if (!profile_dir || !g_file_test (profile_dir, G_FILE_TEST_IS_DIR)) {
+                g_printerr ("No profile directory, skipping\n");
+                return 77;
+        }
+
+        gst_init (&argc, &argv);
+
+        start_mutex = g_mutex_new ();
+        start_cond = g_cond_new ();
+
+        profiles = load_profiles (profile_dir);
+        if (!profiles) {
+                g_printerr ("No profiles found in %s\n", profile_dir);
+                return EXIT_FAILURE;
+        }
+
+        ok = check_encoding_profiles (profiles);
+
+        registry = gupnp_dlna_profile_registry_new (profiles);
+
+        build_descriptions ();
+        check_matching (registry);
+
+        gupnp_dlna_profile_registry_unref (registry);
+
+        for (i = 0; i < N_STREAMS; i++) {
+                gupnp_dlna_stream_description_free (descriptions[i]);
+                g_free (expected[i]);
+        }
+
+        g_mutex_free (start_mutex);
+        g_cond_free (start_cond);
+
+        if (!ok || g_atomic_int_get (&failures)) {
+                g_printerr ("FAIL\n");
+                return EXIT_FAILURE;
+        }
+
+        g_print ("PASS: %d threads, %d iterations\n",
+                 n_threads,
+                 n_iterations);
+
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Checks that with GUPnPDLNADiscoverer:skip-non-media set, a subtitle file
+ * is neither discovered synchronously nor queued for asynchronous discovery,
+ * whatever fast-probe is set to, and that it is still discovered without it.
+ * Whether a pipeline was run is told by the latency histograms, which only
+ * count discoveries made with GStreamer.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+#include <libgupnp-dlna/gupnp-dlna-discoverer.h>
+
+static const gchar subtitles[] =
+        "1\n"
+        "00:00:01,000 --> 00:00:02,000\n"
+        "Hello\n";
+
+static guint
+count_discoveries (GUPnPDLNADiscoverer *discoverer)
+{
+        GList *histograms, *l;
+        guint ret = 0;
+
+        histograms = gupnp_dlna_discoverer_get_latency_histograms (discoverer);
+
+        for (l = histograms; l; l = l->next) {
+                guint count, timeouts;
+
+                g_assert (gst_structure_get_uint (l->data, "count", &count));
+                g_assert (gst_structure_get_uint (l->data,
+                                                  "timeouts",
+                                                  &timeouts));
+                ret += count + timeouts;
+                gst_structure_free (l->data);
+        }
+
+        g_list_free (histograms);
+
+        return ret;
+}
+
+static void
+check_skipped (GUPnPDLNADiscoverer *discoverer, const gchar *uri)
+{
+        GUPnPDLNAInformation *dlna;
+        GError *error = NULL;
+
+        dlna = gupnp_dlna_discoverer_discover_uri_sync (discoverer,
+                                                        uri,
+                                                        &error);
+        g_assert (dlna == NULL);
+        g_assert (error != NULL);
+        g_assert (error->domain == GST_STREAM_ERROR);
+        g_assert_cmpint (error->code, ==, GST_STREAM_ERROR_WRONG_TYPE);
+        g_error_free (error);
+
+        g_assert (!gupnp_dlna_discoverer_discover_uri (discoverer, uri));
+
+        g_assert_cmpuint (count_discoveries (discoverer), ==, 0);
+}
+
+int
+main (int argc, char **argv)
+{
+        GUPnPDLNADiscoverer *discoverer;
+        GUPnPDLNAInformation *dlna;
+        GError *error = NULL;
+        gchar *dir, *path, *uri;
+
+        if (!g_thread_supported ())
+                g_thread_init (NULL);
+
+        gst_init (&argc, &argv);
+
+        dir = g_build_filename (g_get_tmp_dir (),
+                                "gupnp-dlna-skip-XXXXXX",
+                                NULL);
+        if (!mkdtemp (dir)) {
+                g_printerr ("Could not create a temporary directory\n");
+                return EXIT_FAILURE;
+        }
+
+        path = g_build_filename (dir, "movie.srt", NULL);
+        if (!g_file_set_contents (path, subtitles, -1, NULL))
+                g_error ("Could not write %s", path);
+        uri = g_filename_to_uri (path, NULL, NULL);
+
+        discoverer = gupnp_dlna_discoverer_new (5 * GST_SECOND, FALSE, FALSE);
+
+        g_object_set (discoverer, "skip-non-media", TRUE, NULL);
+        check_skipped (discoverer, uri);
+
+        g_object_set (discoverer, "fast-probe", TRUE, NULL);
+        check_skipped (discoverer, uri);
+
+        /* Fast probing alone does not skip anything */
+        g_object_set (discoverer, "skip-non-media", FALSE, NULL);
+        dlna = gupnp_dlna_discoverer_discover_uri_sync (discoverer,
+                                                        uri,
+                                                        &error);
+        g_clear_error (&error);
+        if (dlna)
+                g_object_unref (dlna);
+        g_assert_cmpuint (count_discoveries (discoverer), ==, 1);
+
+        g_object_unref (discoverer);
+
+        g_unlink (path);
+        g_rmdir (dir);
+
+        g_free (uri);
+        g_free (path);
+        g_free (dir);
+
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,357 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Tests GUPnPDLNADiscoverer on a list of media, comparing the DLNA profile
+ * name and MIME type found for each file against the expected ones.
+ *
+ * Usage:
+ *   test-discoverer [OPTION...] <file_list> <media_dir>
+ *
+ * <file_list> is a CSV file in the format:
+ *   path_name,profile_name,mime_type
+ *
+ * Path names in the list are relative to <media_dir>. Both can be passed as
+ * the FILE_LIST and MEDIA_DIR environment variables instead, as "make check"
+ * does. You can get the default test media collection using:
+ *   git clone git://git.gnome.org/gupnp-dlna-media tests/media
+ *
+ * The profiles are loaded once and the whole list is run through a pool of
+ * --jobs discoverers in this process, so the cost of starting up is only
+ * paid once however long the list is.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <gst/gst.h>
+#include <libgupnp-dlna/gupnp-dlna-discoverer.h>
+
+/* Exit status telling automake that the test was skipped */
+#define EXIT_SKIP 77
+
+typedef struct {
+        gchar *path;
+        gchar *profile;
+        gchar *mime;
+
+        gchar *found_profile;
+        gchar *found_mime;
+        gchar *error;
+        GstClockTime elapsed;
+} TestItem;
+
+typedef struct {
+        GAsyncQueue *discoverers;
+        const gchar *media_dir;
+        GArray *items;
+} TestState;
+
+static gint timeout = 10;
+static gint jobs = 1;
+static gboolean relaxed_mode = FALSE;
+static gboolean extended_mode = FALSE;
+
+/* Files without a profile used to be listed as "(null)" */
+static gchar *
+parse_field (const gchar *field)
+{
+        if (!field || g_str_equal (field, "(null)"))
+                return g_strdup ("");
+
+        return g_strstrip (g_strdup (field));
+}
+
+static GArray *
+read_file_list (const gchar *file_list)
+{
+        GArray *items;
+        gchar *contents, **lines, **line;
+        GError *err = NULL;
+
+        if (!g_file_get_contents (file_list, &contents, NULL, &err)) {
+                g_printerr ("Could not read %s: %s\n",
+                            file_list,
+                            err->message);
+                g_error_free (err);
+                return NULL;
+        }
+
+        items = g_array_new (FALSE, TRUE, sizeof (TestItem));
+        lines = g_strsplit (contents, "\n", -1);
+
+        for (line = lines; *line; line++) {
+                TestItem item = { NULL, };
+                gchar **fields;
+
+                /* Commented or empty line */
+                if (**line == '#' || **line == '\0')
+                        continue;
+
+                fields = g_strsplit (*line, ",", 3);
+                item.path = parse_field (fields[0]);
+                item.profile = parse_field (fields[1]);
+                item.mime = parse_field (fields[1] ? fields[2] : NULL);
+                g_strfreev (fields);
+
+                g_array_append_val (items, item);
+        }
+
+        g_strfreev (lines);
+        g_free (contents);
+
+        return items;
+}
+
+static void
+free_items (GArray *items)
+{
+        guint i;
+
+        for (i = 0; i < items->len; i++) {
+                TestItem *item = &g_array_index (items, TestItem, i);
+
+                g_free (item->path);
+                g_free (item->profile);
+                g_free (item->mime);
+                g_free (item->found_profile);
+                g_free (item->found_mime);
+                g_free (item->error);
+        }
+
+        g_array_free (items, TRUE);
+}
+
+/* Items are pushed to the pool as their index + 1, as the pool does not take
+ * NULL */
+static void
+test_worker (gpointer data, TestState *state)
+{
+        TestItem *item = &g_array_index (state->items,
+                                         TestItem,
+                                         GPOINTER_TO_UINT (data) - 1);
+        GUPnPDLNADiscoverer *discover;
+        GUPnPDLNAInformation *dlna = NULL;
+        GError *err = NULL;
+        gchar *path, *uri;
+        GstClockTime start;
+
+        path = g_build_filename (state->media_dir, item->path, NULL);
+        uri = g_filename_to_uri (path, NULL, &err);
+        g_free (path);
+
+        discover = g_async_queue_pop (state->discoverers);
+
+        start = gst_util_get_timestamp ();
+        if (uri)
+                dlna = gupnp_dlna_discoverer_discover_uri_sync (discover,
+                                                                uri,
+                                                                &err);
+        item->elapsed = gst_util_get_timestamp () - start;
+
+        g_async_queue_push (state->discoverers, discover);
+
+        if (dlna) {
+                item->found_profile =
+                        g_strdup (gupnp_dlna_information_get_name (dlna));
+                item->found_mime =
+                        g_strdup (gupnp_dlna_information_get_mime (dlna));
+                g_object_unref (dlna);
+        }
+
+        if (err) {
+                item->error = g_strdup (err->message);
+                g_error_free (err);
+        }
+
+        g_free (uri);
+}
+
+static gboolean
+check_item (const TestItem *item)
+{
+        return g_strcmp0 (item->profile,
+                          item->found_profile ? item->found_profile : "")
+                == 0 &&
+               g_strcmp0 (item->mime,
+                          item->found_mime ? item->found_mime : "") == 0;
+}
+
+static gboolean
+run_tests (TestState *state)
+{
+        GThreadPool *pool;
+        GError *err = NULL;
+        GstClockTime start, wall_time;
+        guint i, n_failed = 0;
+
+        start = gst_util_get_timestamp ();
+
+        pool = g_thread_pool_new ((GFunc) test_worker,
+                                  state,
+                                  jobs,
+                                  TRUE,
+                                  &err);
+        if (!pool) {
+                g_printerr ("Could not start the worker threads: %s\n",
+                            err->message);
+                g_error_free (err);
+                return FALSE;
+        }
+
+        for (i = 0; i < state->items->len; i++)
+                g_thread_pool_push (pool, GUINT_TO_POINTER (i + 1), NULL);
+
+        /* Waits for all the files to be processed */
+        g_thread_pool_free (pool, FALSE, TRUE);
+
+        wall_time = gst_util_get_timestamp () - start;
+
+        for (i = 0; i < state->items->len; i++) {
+                const TestItem *item = &g_array_index (state->items,
+                                                       TestItem,
+                                                       i);
+
+                g_print (" Testing %s ... ", item->path);
+
+                if (check_item (item)) {
+                        g_print ("PASS");
+                } else {
+                        n_failed++;
+                        g_print ("\033[01;31mFAIL: %s,%s,%s\033[0m",
+                                 item->path,
+                                 item->found_profile ?
+                                 item->found_profile : "",
+                                 item->found_mime ? item->found_mime : "");
+                        if (item->error)
+                                g_print (" (%s)", item->error);
+                }
+
+                g_print (" [%.1f ms]\n",
+                         (gdouble) item->elapsed / GST_MSECOND);
+        }
+
+        g_print ("\n%u passed, %u failed, %u files in %" GST_TIME_FORMAT
+                 " with %d jobs (%.1f files/s)\n",
+                 state->items->len - n_failed,
+                 n_failed,
+                 state->items->len,
+                 GST_TIME_ARGS (wall_time),
+                 jobs,
+                 wall_time ?
+                 state->items->len * (gdouble) GST_SECOND / wall_time : 0.0);
+
+        return n_failed == 0;
+}
+
+int
+main (int argc, char **argv)
+{
+        TestState state = { NULL, };
+        const gchar *file_list, *media_dir;
+        GUPnPDLNADiscoverer **discoverers;
+        GOptionContext *ctx;
+        GError *err = NULL;
+        gboolean ok;
+        gint i;
+
+        GOptionEntry options[] = {
+                {"timeout", 't', 0, G_OPTION_ARG_INT, &timeout,
+                 "Specify timeout (in seconds, defaults to 10)", "T"},
+                {"jobs", 'j', 0, G_OPTION_ARG_INT, &jobs,
+                 "Discover the files on N threads (defaults to 1)", "N"},
+                {"relaxed mode", 'r', 0, G_OPTION_ARG_NONE, &relaxed_mode,
+                 "Enable Relaxed mode", NULL},
+                {"extended mode", 'e', 0, G_OPTION_ARG_NONE, &extended_mode,
+                 "Enable extended mode", NULL},
+                {NULL}
+        };
+
+        if (!g_thread_supported ())
+                g_thread_init (NULL);
+
+        ctx = g_option_context_new ("<file_list> <media_dir> - "
+                                    "test the discoverer on a list of media");
+        g_option_context_add_main_entries (ctx, options, NULL);
+        g_option_context_add_group (ctx, gst_init_get_option_group ());
+
+        if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+                g_printerr ("Error initializing: %s\n", err->message);
+                return EXIT_FAILURE;
+        }
+
+        g_option_context_free (ctx);
+
+        /* See if params are available in the environment - if yes, carry
+         * on, else read them from the command line */
+        file_list = g_getenv ("FILE_LIST");
+        media_dir = g_getenv ("MEDIA_DIR");
+
+        if (!file_list || !*file_list || !media_dir || !*media_dir) {
+                if (argc < 3) {
+                        g_printerr ("Usage:\n  %s <file_list> <media_dir>\n",
+                                    argv[0]);
+                        return EXIT_FAILURE;
+                }
+
+                file_list = argv[1];
+                media_dir = argv[2];
+        }
+
+        if (!g_file_test (media_dir, G_FILE_TEST_IS_DIR)) {
+                g_print ("***\n"
+                         "WARNING: the specified media directory (%s) was "
+                         "not found. Skipping discoverer tests.\n"
+                         "***\n",
+                         media_dir);
+                return EXIT_SKIP;
+        }
+
+        if (jobs < 1)
+                jobs = 1;
+
+        state.media_dir = media_dir;
+        state.items = read_file_list (file_list);
+        if (!state.items)
+                return EXIT_FAILURE;
+
+        state.discoverers = g_async_queue_new ();
+        discoverers = g_new (GUPnPDLNADiscoverer *, jobs);
+
+        for (i = 0; i < jobs; i++) {
+                discoverers[i] = gupnp_dlna_discoverer_new
+                                        ((GstClockTime) (timeout * GST_SECOND),
+                                         relaxed_mode,
+                                         extended_mode);
+                g_async_queue_push (state.discoverers, discoverers[i]);
+        }
+
+        ok = run_tests (&state);
+
+        for (i = 0; i < jobs; i++) {
+                g_async_queue_pop (state.discoverers);
+                g_object_unref (discoverers[i]);
+        }
+
+        g_free (discoverers);
+        g_async_queue_unref (state.discoverers);
+        free_items (state.items);
+
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "test-util.h"
+#include <libgupnp-dlna/gupnp-dlna-profile-private.h>
+
+static GstCaps *
+caps_or_none (const gchar *str)
+{
+        return str ? gst_caps_from_string (str) : gst_caps_new_empty ();
+}
+
+/* Returns a list of new GUPnPDLNAProfiles, in the order of @profiles */
+GList *
+test_util_build_profiles (const TestProfile *profiles, guint n_profiles)
+{
+        GList *ret = NULL;
+        guint i;
+
+        for (i = 0; i < n_profiles; i++) {
+                const TestProfile *p = &profiles[i];
+                GstCaps *container, *video, *audio;
+
+                container = caps_or_none (p->container);
+                video = caps_or_none (p->video);
+                audio = caps_or_none (p->audio);
+
+                ret = g_list_prepend (ret,
+                                      gupnp_dlna_profile_new
+                                                ((gchar *) p->name,
+                                                 (gchar *) p->mime,
+                                                 container,
+                                                 video,
+                                                 audio,
+                                                 FALSE));
+
+                gst_caps_unref (container);
+                gst_caps_unref (video);
+                gst_caps_unref (audio);
+        }
+
+        return g_list_reverse (ret);
+}
+
+GUPnPDLNAStreamDescription *
+test_util_describe (const TestStream *stream)
+{
+        GUPnPDLNAStreamDescription *desc;
+
+        desc = gupnp_dlna_stream_description_new ();
+
+        if (stream->container)
+                desc->container = gst_caps_from_string (stream->container);
+        if (stream->video)
+                desc->video = g_list_append
+                                (NULL, gst_caps_from_string (stream->video));
+        if (stream->audio)
+                desc->audio = g_list_append
+                                (NULL, gst_caps_from_string (stream->audio));
+        if (stream->extra_audio)
+                desc->audio = g_list_append
+                                (desc->audio,
+                                 gst_caps_from_string (stream->extra_audio));
+        desc->is_image = stream->is_image;
+
+        return desc;
+}
+
+/* Encodes a fraction of a second of a test tone into a WAV file at @path.
+ * Returns FALSE if audiotestsrc or wavenc are missing. */
+gboolean
+test_util_encode_wav (const gchar *path)
+{
+        GstElement *pipeline;
+        GstMessage *msg;
+        GstBus *bus;
+        gchar *description;
+        gboolean ret = FALSE;
+
+        description = g_strdup_printf ("audiotestsrc num-buffers=20 ! "
+                                       "wavenc ! filesink location=\"%s\"",
+                                       path);
+        pipeline = gst_parse_launch (description, NULL);
+        g_free (description);
+
+        if (!pipeline)
+                return FALSE;
+
+        bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
+        gst_element_set_state (pipeline, GST_STATE_PLAYING);
+        msg = gst_bus_timed_pop_filtered (bus,
+                                          10 * GST_SECOND,
+                                          GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+        gst_object_unref (bus);
+
+        if (msg) {
+                ret = (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS);
+                gst_message_unref (msg);
+        }
+
+        gst_element_set_state (pipeline, GST_STATE_NULL);
+        gst_object_unref (pipeline);
+
+        return ret;
+}
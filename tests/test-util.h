@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Fixtures shared by the tests: synthetic profiles and stream descriptions
+ * for those that do not need real media, and a short WAV file for those
+ * that do.
+ */
+
+#ifndef __GUPNP_DLNA_TEST_UTIL_H__
+#define __GUPNP_DLNA_TEST_UTIL_H__
+
+#include <gst/gst.h>
+#include <libgupnp-dlna/gupnp-dlna-profile.h>
+#include <libgupnp-dlna/stream-description.h>
+
+G_BEGIN_DECLS
+
+/* Caps are given as strings, NULL standing for empty caps */
+typedef struct {
+        const gchar *name;
+        const gchar *mime;
+        const gchar *container;
+        const gchar *video;
+        const gchar *audio;
+} TestProfile;
+
+/* A stream with at most one video and two audio streams, NULL if absent */
+typedef struct {
+        const gchar *container;
+        const gchar *video;
+        const gchar *audio;
+        gboolean    is_image;
+        const gchar *extra_audio;
+} TestStream;
+
+GList *
+test_util_build_profiles (const TestProfile *profiles, guint n_profiles);
+
+GUPnPDLNAStreamDescription *
+test_util_describe (const TestStream *stream);
+
+gboolean
+test_util_encode_wav (const gchar *path);
+
+G_END_DECLS
+
+#endif /* __GUPNP_DLNA_TEST_UTIL_H__ */
@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Checks the transcode flags worked out for streams against a few profiles,
+ * that the streams found to fit a profile are those that do not have to be
+ * re-encoded, and that descriptions rebuilt from the summary of a result
+ * never need less work than the ones they were made from.
+ */
+
+#include <gst/gst.h>
+#include <libgupnp-dlna/gupnp-dlna-profile.h>
+#include <libgupnp-dlna/profile-registry.h>
+#include <libgupnp-dlna/stream-description.h>
+#include <libgupnp-dlna/match-stats.h>
+#include <stdlib.h>
+#include "test-util.h"
+
+typedef struct {
+        TestStream              stream;
+        /* Expected flags for each of test_profiles */
+        GUPnPDLNATranscodeFlags flags[7];
+        /* The profile that the matcher is expected to pick, if any */
+        const gchar             *match;
+} TestCase;
+
+#define NONE GUPNP_DLNA_TRANSCODE_NONE
+#define MUX GUPNP_DLNA_TRANSCODE_TRANSMUX
+#define AUDIO GUPNP_DLNA_TRANSCODE_AUDIO
+#define VIDEO GUPNP_DLNA_TRANSCODE_VIDEO
+#define IMPOSSIBLE GUPNP_DLNA_TRANSCODE_IMPOSSIBLE
+
+static const TestProfile test_profiles[] = {
+        { "MP3", "audio/mpeg", NULL, NULL,
+          "audio/mpeg, mpegversion=(int)1, layer=(int)3" },
+        { "AAC_ADTS", "audio/vnd.dlna.adts",
+          "audio/mpeg, mpegversion=(int)4, stream-format=(string)adts", NULL,
+          "audio/mpeg, mpegversion=(int)4" },
+        { "AVC_MP4", "video/mp4", "video/quicktime",
+          "video/x-h264, width=(int)[ 1, 720 ]",
+          "audio/mpeg, mpegversion=(int)4" },
+        { "AVC_TS", "video/mpeg", "video/mpegts",
+          "video/x-h264, width=(int)[ 1, 720 ]",
+          "audio/x-ac3" },
+        { "MPEG2_TS", "video/mpeg", "video/mpegts",
+          "video/mpeg, mpegversion=(int)2",
+          "audio/x-ac3" },
+        { "JPEG", "image/jpeg", NULL, "image/jpeg", NULL },
+        { "AVC_MP4_SILENT", "video/mp4", "video/quicktime",
+          "video/x-h264, width=(int)[ 1, 720 ]",
+          NULL },
+};
+
+static const TestCase test_cases[] = {
+        { { NULL, NULL, "audio/mpeg, mpegversion=(int)1, layer=(int)3",
+            FALSE },
+          { NONE, MUX | AUDIO, IMPOSSIBLE, IMPOSSIBLE, IMPOSSIBLE,
+            IMPOSSIBLE, IMPOSSIBLE },
+          "MP3" },
+        { { "video/quicktime", "video/x-h264, width=(int)640",
+            "audio/mpeg, mpegversion=(int)4", FALSE },
+          { IMPOSSIBLE, IMPOSSIBLE, NONE, MUX | AUDIO, MUX | AUDIO | VIDEO,
+            IMPOSSIBLE, AUDIO },
+          "AVC_MP4" },
+        { { "video/quicktime", "video/x-h264, width=(int)1920",
+            "audio/mpeg, mpegversion=(int)4", FALSE },
+          { IMPOSSIBLE, IMPOSSIBLE, VIDEO, MUX | AUDIO | VIDEO,
+            MUX | AUDIO | VIDEO, IMPOSSIBLE, AUDIO | VIDEO },
+          NULL },
+        { { "video/x-matroska", "video/x-h264, width=(int)640", "audio/x-ac3",
+            FALSE },
+          { IMPOSSIBLE, IMPOSSIBLE, MUX | AUDIO, MUX, MUX | VIDEO,
+            IMPOSSIBLE, MUX | AUDIO },
+          NULL },
+        /* Contained audio against profiles without a container */
+        { { "application/ogg", NULL,
+            "audio/mpeg, mpegversion=(int)1, layer=(int)3", FALSE },
+          { MUX, MUX | AUDIO, IMPOSSIBLE, IMPOSSIBLE, IMPOSSIBLE,
+            IMPOSSIBLE, IMPOSSIBLE },
+          NULL },
+        /* The matcher expects every profile to have audio restrictions, but
+         * video without audio does fit a profile without any */
+        { { "video/quicktime", "video/x-h264, width=(int)640", NULL, FALSE },
+          { IMPOSSIBLE, IMPOSSIBLE, IMPOSSIBLE, IMPOSSIBLE, IMPOSSIBLE,
+            IMPOSSIBLE, NONE },
+          NULL },
+        { { NULL, "image/png", NULL, TRUE },
+          { IMPOSSIBLE, IMPOSSIBLE, IMPOSSIBLE, IMPOSSIBLE, IMPOSSIBLE,
+            VIDEO, IMPOSSIBLE },
+          NULL },
+};
+
+static void
+check_stream (const TestCase              *test,
+              GUPnPDLNAStreamDescription  *desc,
+              GUPnPDLNAStreamDescription  *rebuilt,
+              const GUPnPDLNAProfileTable *table)
+{
+        guint i;
+
+        for (i = 0; i < table->n_profiles; i++) {
+                GUPnPDLNATranscodeFlags flags, lossy;
+
+                flags = gupnp_dlna_stream_description_get_transcode_flags
+                                                        (desc, table, i);
+                lossy = gupnp_dlna_stream_description_get_transcode_flags
+                                                        (rebuilt, table, i);
+
+                g_assert_cmpuint (flags, ==, test->flags[i]);
+                g_assert_cmpuint (lossy & flags, ==, flags);
+
+                if (flags & GUPNP_DLNA_TRANSCODE_IMPOSSIBLE)
+                        continue;
+
+                /* A stream can be passed through unless it is re-encoded */
+                if (desc->video)
+                        g_assert (gupnp_dlna_stream_description_stream_fits
+                                        (desc->video->data, table, i, TRUE) ==
+                                  !(flags & GUPNP_DLNA_TRANSCODE_VIDEO));
+                if (desc->audio)
+                        g_assert (gupnp_dlna_stream_description_stream_fits
+                                        (desc->audio->data, table, i, FALSE) ==
+                                  !(flags & GUPNP_DLNA_TRANSCODE_AUDIO));
+        }
+}
+
+/* Runs the matcher over @desc while collecting statistics, which goes
+ * through the code that describes each rejection */
+static void
+check_guess (const TestCase              *test,
+             GUPnPDLNAStreamDescription  *desc,
+             const GUPnPDLNAProfileTable *table)
+{
+        GUPnPDLNAMatchStats *stats;
+        gchar *name = NULL, *mime = NULL;
+
+        stats = gupnp_dlna_match_stats_new ();
+        gupnp_dlna_stream_description_guess_profile (desc,
+                                                     table,
+                                                     stats,
+                                                     &name,
+                                                     &mime);
+
+        g_assert_cmpstr (name, ==, test->match);
+
+        g_free (name);
+        g_free (mime);
+        gupnp_dlna_match_stats_free (stats);
+}
+
+int
+main (int argc, char **argv)
+{
+        GUPnPDLNAProfileRegistry *registry;
+        const GUPnPDLNAProfileTable *table;
+        const GList *l;
+        guint i;
+
+        if (!g_thread_supported ())
+                g_thread_init (NULL);
+
+        gst_init (&argc, &argv);
+
+        /* Mismatches must not trip any precondition in GStreamer */
+        g_log_set_always_fatal (G_LOG_LEVEL_CRITICAL | G_LOG_LEVEL_WARNING);
+
+        registry = gupnp_dlna_profile_registry_new
+                        (test_util_build_profiles
+                                (test_profiles,
+                                 G_N_ELEMENTS (test_profiles)));
+        table = gupnp_dlna_profile_registry_get_table (registry);
+
+        for (l = gupnp_dlna_profile_registry_get_profiles (registry), i = 0;
+             l;
+             l = l->next, i++)
+                g_assert_cmpint (gupnp_dlna_profile_registry_get_index
+                                        (registry, l->data), ==, i);
+
+        for (i = 0; i < G_N_ELEMENTS (test_cases); i++) {
+                GUPnPDLNAStreamDescription *desc, *rebuilt;
+                GstStructure *summary;
+
+                desc = test_util_describe (&test_cases[i].stream);
+                summary = gupnp_dlna_stream_description_summarize
+                                        (desc,
+                                         NULL,
+                                         GST_CLOCK_TIME_NONE,
+                                         GST_CLOCK_TIME_NONE);
+                rebuilt = gupnp_dlna_stream_description_new_from_summary
+                                        (summary,
+                                         test_cases[i].stream.is_image);
+
+                check_stream (&test_cases[i], desc, rebuilt, table);
+                check_guess (&test_cases[i], desc, table);
+
+                gupnp_dlna_stream_description_free (rebuilt);
+                gst_structure_free (summary);
+                gupnp_dlna_stream_description_free (desc);
+        }
+
+        gupnp_dlna_profile_registry_unref (registry);
+
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,128 @@
+/* GUPnPDLNA
+ * gupnp-dlna-check-profiles.c
+ *
+ * Copyright (C) 2011 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib-object.h>
+#include <gst/gst.h>
+
+#include <libgupnp-dlna/gupnp-dlna-profile.h>
+#include <libgupnp-dlna/gupnp-dlna-profile-private.h>
+#include <libgupnp-dlna/profile-registry.h>
+
+static gboolean relaxed = FALSE, strict = FALSE, ties_only = FALSE;
+
+/* Profiles are matched in the order of the table and the first one that fits
+ * wins, so for any two overlapping profiles with different names, files
+ * that fit both always get the earlier one. That is intended when the earlier
+ * profile has a higher priority; with equal priorities the order only comes
+ * from file names and document order, and is worth a second look. */
+static guint
+check_profiles (const GUPnPDLNAProfileTable *table)
+{
+        guint i, j, n_ties = 0;
+
+        for (i = 0; i < table->n_profiles; i++) {
+                for (j = i + 1; j < table->n_profiles; j++) {
+                        gint priority_i, priority_j;
+
+                        if (strcmp (table->names[i], table->names[j]) == 0)
+                                continue;
+
+                        if (!gupnp_dlna_profile_table_overlap (table, i, j))
+                                continue;
+
+                        priority_i = gupnp_dlna_profile_get_priority
+                                                (table->profiles[i]);
+                        priority_j = gupnp_dlna_profile_get_priority
+                                                (table->profiles[j]);
+
+                        if (priority_i == priority_j)
+                                n_ties++;
+                        else if (ties_only)
+                                continue;
+
+                        g_print ("%-30s (priority %d) shadows %s "
+                                 "(priority %d)%s\n",
+                                 table->names[i],
+                                 priority_i,
+                                 table->names[j],
+                                 priority_j,
+                                 priority_i == priority_j ?
+                                 ", ordered by file" : "");
+                }
+        }
+
+        return n_ties;
+}
+
+int
+main (int argc, char **argv)
+{
+        GError *err = NULL;
+        GUPnPDLNAProfileRegistry *registry;
+        guint n_ties;
+
+        GOptionEntry options[] = {
+                {"relaxed", 'r', 0, G_OPTION_ARG_NONE, &relaxed,
+                 "Read profiles in relaxed mode", NULL},
+                {"ties", 't', 0, G_OPTION_ARG_NONE, &ties_only,
+                 "Only report overlapping profiles of equal priority", NULL},
+                {"strict", 's', 0, G_OPTION_ARG_NONE, &strict,
+                 "Fail if overlapping profiles have equal priorities", NULL},
+                {NULL}
+        };
+
+        GOptionContext *ctx;
+
+        if (!g_thread_supported ())
+                g_thread_init(NULL);
+
+        ctx = g_option_context_new (" - program to find DLNA profiles whose "
+                                    "order decides the match");
+        g_option_context_add_main_entries (ctx, options, NULL);
+        g_option_context_add_group (ctx, gst_init_get_option_group ());
+
+        if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+
+                g_print ("Error initializing: %s\n", err->message);
+                exit (1);
+        }
+
+        g_option_context_free (ctx);
+
+        gst_init (&argc, &argv);
+
+        registry = gupnp_dlna_profile_registry_get_default (relaxed, TRUE);
+
+        n_ties = check_profiles
+                        (gupnp_dlna_profile_registry_get_table (registry));
+
+        g_print ("\n%u overlapping profile pair(s) of equal priority.\n",
+                 n_ties);
+
+        return (strict && n_ties) ? 1 : 0;
+}
@@ -44,11 +44,60 @@
 #include <libgupnp-dlna/gupnp-dlna-profile.h>
 #include <libgupnp-dlna/gupnp-dlna-discoverer.h>
 #include <libgupnp-dlna/gupnp-dlna-information.h>
+#include <libgupnp-dlna/gupnp-dlna-record-private.h>
 
 
 static gboolean async = FALSE;
 static gboolean verbose = FALSE;
+static gboolean fast_probe = FALSE;
+static gboolean skip_non_media = FALSE;
+static gboolean compact = FALSE;
+static gboolean adaptive_timeout = FALSE;
+static gboolean latency = FALSE;
+static gboolean stats = FALSE;
+static gchar *profile_order = NULL;
 static gint timeout = 10;
+static gint jobs = 0;
+static gchar **includes = NULL;
+static gchar **excludes = NULL;
+static gchar *format_name = NULL;
+
+typedef enum {
+        FORMAT_TEXT,
+        FORMAT_JSON,
+        FORMAT_CSV,
+        FORMAT_TSV
+} OutputFormat;
+
+static OutputFormat format = FORMAT_TEXT;
+
+/* The fields of the machine-readable formats, in column order. Times are in
+ * nanoseconds and "streams" lists the media types of the container and of
+ * the first video and audio streams. */
+enum {
+        FIELD_URI,
+        FIELD_STATUS,
+        FIELD_PROFILE,
+        FIELD_MIME,
+        FIELD_DURATION,
+        FIELD_STREAMS,
+        FIELD_MATCH_TIME,
+        FIELD_DISCOVERY_TIME,
+        FIELD_ERROR,
+        N_FIELDS
+};
+
+static const gchar *field_names[N_FIELDS] = {
+        "uri",
+        "status",
+        "profile",
+        "mime",
+        "duration",
+        "streams",
+        "match-time",
+        "discovery-time",
+        "error"
+};
 
 
 typedef struct
@@ -58,6 +107,19 @@ typedef struct
         char **argv;
 } PrivStruct;
 
+/* Shared by the worker threads of the batch mode */
+typedef struct
+{
+        /* Idle discoverers, one per worker thread */
+        GAsyncQueue *discoverers;
+
+        GMutex *lock;
+        GArray *latencies;
+        guint matched;
+        guint unmatched;
+        guint errors;
+} BatchState;
+
 /*
  * The following functions are from gst-discoverer.c (gst-convenience/tools)
  */
@@ -312,28 +374,245 @@ print_gst_info (GstDiscovererInfo *info, GError *err)
 }
 
 static void
-print_dlna_info (GUPnPDLNAInformation *dlna, GError *err)
+print_dlna_info (GUPnPDLNAInformation *dlna, const gchar *uri, GError *err)
 {
         GstDiscovererInfo *info;
+        const GstStructure *summary;
 
         info = (GstDiscovererInfo *)gupnp_dlna_information_get_info (dlna);
+        summary = gupnp_dlna_information_get_summary (dlna);
 
-        g_print ("\nURI: %s\n", gst_discoverer_info_get_uri (info));
+        /* There is no GstDiscovererInfo if the headers were probed
+         * directly, or if it was dropped to save memory */
+        if (info)
+                uri = gst_discoverer_info_get_uri (info);
+        else if (summary && gst_structure_has_field (summary, "uri"))
+                uri = gst_structure_get_string (summary, "uri");
+
+        g_print ("\nURI: %s\n", uri);
         g_print ("Profile Name: %s\n", gupnp_dlna_information_get_name (dlna));
         g_print ("Profile MIME: %s\n", gupnp_dlna_information_get_mime (dlna));
 
-        print_gst_info ((GstDiscovererInfo *)info, err);
+        if (info)
+                print_gst_info ((GstDiscovererInfo *)info, err);
+        else if (summary) {
+                gchar *tmp = gst_structure_to_string (summary);
+
+                g_print ("Summary: %s\n", tmp);
+                g_free (tmp);
+        }
 
         g_print ("\n");
         return;
 }
 
+static const gchar *
+get_status (GUPnPDLNAInformation *dlna, GError *err)
+{
+        if (err || !dlna)
+                return "error";
+        if (gupnp_dlna_information_get_name (dlna))
+                return "matched";
+
+        return "unmatched";
+}
+
+static void
+append_separated (GString *line, const gchar *value)
+{
+        const gchar *p;
+
+        if (format == FORMAT_TSV) {
+                /* Tabs and line breaks cannot be quoted in TSV */
+                for (p = value; *p; p++)
+                        g_string_append_c (line,
+                                           strchr ("\t\r\n", *p) ? ' ' : *p);
+                return;
+        }
+
+        if (!strpbrk (value, ",\"\r\n")) {
+                g_string_append (line, value);
+                return;
+        }
+
+        g_string_append_c (line, '"');
+        for (p = value; *p; p++) {
+                if (*p == '"')
+                        g_string_append_c (line, '"');
+                g_string_append_c (line, *p);
+        }
+        g_string_append_c (line, '"');
+}
+
+static void
+print_header (void)
+{
+        GString *line;
+        guint i;
+
+        if (format != FORMAT_CSV && format != FORMAT_TSV)
+                return;
+
+        line = g_string_new (NULL);
+        for (i = 0; i < N_FIELDS; i++) {
+                if (i)
+                        g_string_append_c (line,
+                                           format == FORMAT_CSV ? ',' : '\t');
+                g_string_append (line, field_names[i]);
+        }
+
+        g_print ("%s\n", line->str);
+        g_string_free (line, TRUE);
+}
+
+/* Prints one line describing @dlna in the JSON (one object per line), CSV or
+ * TSV format. Unknown fields are left out of JSON objects and left empty in
+ * CSV and TSV. */
+static void
+print_record (GUPnPDLNAInformation *dlna,
+              const gchar          *uri,
+              GError               *err,
+              GstClockTime         discovery_time)
+{
+        gchar *values[N_FIELDS] = { NULL, };
+        const gchar *streams[4] = { NULL, };
+        guint n_streams = 0, i, j;
+        GString *line;
+
+        if (dlna) {
+                const GstDiscovererInfo *info;
+                const GstStructure *summary;
+                const gchar *format_fields[] = { "container-format",
+                                                 "video-format",
+                                                 "audio-format" };
+                GstClockTime duration;
+                guint64 match_time;
+
+                info = gupnp_dlna_information_get_info (dlna);
+                summary = gupnp_dlna_information_get_summary (dlna);
+
+                if (info)
+                        uri = gst_discoverer_info_get_uri
+                                        ((GstDiscovererInfo *) info);
+                else if (summary && gst_structure_has_field (summary, "uri"))
+                        uri = gst_structure_get_string (summary, "uri");
+
+                values[FIELD_PROFILE] = g_strdup
+                                (gupnp_dlna_information_get_name (dlna));
+                values[FIELD_MIME] = g_strdup
+                                (gupnp_dlna_information_get_mime (dlna));
+
+                duration = gupnp_dlna_information_get_duration (dlna);
+                if (GST_CLOCK_TIME_IS_VALID (duration))
+                        values[FIELD_DURATION] = g_strdup_printf
+                                        ("%" G_GUINT64_FORMAT, duration);
+
+                if (summary &&
+                    gst_structure_get_uint64 (summary,
+                                              "match-time",
+                                              &match_time))
+                        values[FIELD_MATCH_TIME] = g_strdup_printf
+                                        ("%" G_GUINT64_FORMAT, match_time);
+
+                for (i = 0; summary && i < G_N_ELEMENTS (format_fields); i++)
+                        if (gst_structure_has_field (summary,
+                                                     format_fields[i]))
+                                streams[n_streams++] =
+                                        gst_structure_get_string
+                                                (summary, format_fields[i]);
+        }
+
+        values[FIELD_URI] = g_strdup (uri);
+        values[FIELD_STATUS] = g_strdup (get_status (dlna, err));
+        if (GST_CLOCK_TIME_IS_VALID (discovery_time))
+                values[FIELD_DISCOVERY_TIME] = g_strdup_printf
+                                        ("%" G_GUINT64_FORMAT, discovery_time);
+        if (err)
+                values[FIELD_ERROR] = g_strdup (err->message);
+
+        line = g_string_new (NULL);
+
+        if (format == FORMAT_JSON) {
+                g_string_append_c (line, '{');
+
+                for (i = 0; i < N_FIELDS; i++) {
+                        if (i == FIELD_STREAMS) {
+                                if (!n_streams)
+                                        continue;
+                        } else if (!values[i]) {
+                                continue;
+                        }
+
+                        if (line->len > 1)
+                                g_string_append_c (line, ',');
+                        gupnp_dlna_json_append_string (line,
+                                                       field_names[i]);
+                        g_string_append_c (line, ':');
+
+                        if (i == FIELD_STREAMS) {
+                                g_string_append_c (line, '[');
+                                for (j = 0; j < n_streams; j++) {
+                                        if (j)
+                                                g_string_append_c (line, ',');
+                                        gupnp_dlna_json_append_string
+                                                        (line, streams[j]);
+                                }
+                                g_string_append_c (line, ']');
+                        } else if (i == FIELD_DURATION ||
+                                   i == FIELD_MATCH_TIME ||
+                                   i == FIELD_DISCOVERY_TIME) {
+                                g_string_append (line, values[i]);
+                        } else {
+                                gupnp_dlna_json_append_string (line,
+                                                               values[i]);
+                        }
+                }
+
+                g_string_append_c (line, '}');
+        } else {
+                values[FIELD_STREAMS] = g_strjoinv (" ", (gchar **) streams);
+
+                for (i = 0; i < N_FIELDS; i++) {
+                        if (i)
+                                g_string_append_c (line,
+                                                   format == FORMAT_CSV ?
+                                                   ',' : '\t');
+                        if (values[i])
+                                append_separated (line, values[i]);
+                }
+        }
+
+        g_print ("%s\n", line->str);
+        g_string_free (line, TRUE);
+
+        for (i = 0; i < N_FIELDS; i++)
+                g_free (values[i]);
+}
+
+/* Prints the result of a synchronous discovery */
+static void
+print_result (GUPnPDLNAInformation *dlna,
+              const gchar          *uri,
+              GError               *err,
+              GstClockTime         discovery_time)
+{
+        if (format != FORMAT_TEXT)
+                print_record (dlna, uri, err, discovery_time);
+        else if (err)
+                fprintf (stderr, "Unable to read file: %s\n", err->message);
+        else
+                print_dlna_info (dlna, uri, err);
+}
+
 static void
 discoverer_done (GUPnPDLNADiscoverer *discover,
                  GUPnPDLNAInformation *dlna,
                  GError *err)
 {
-        print_dlna_info (dlna, err);
+        if (format != FORMAT_TEXT)
+                print_record (dlna, NULL, err, GST_CLOCK_TIME_NONE);
+        else
+                print_dlna_info (dlna, NULL, err);
         return;
 }
 
@@ -343,12 +622,40 @@ discoverer_ready (GUPnPDLNADiscoverer *dc, GMainLoop *ml)
         g_main_loop_quit (ml);
 }
 
+static gchar *
+filename_to_uri (const gchar *filename)
+{
+        GError *err = NULL;
+        gchar *uri, *path;
+
+        if (!g_path_is_absolute (filename)) {
+                gchar *cur_dir;
+
+                cur_dir = g_get_current_dir ();
+                path = g_build_filename (cur_dir, filename, NULL);
+                g_free (cur_dir);
+        } else {
+                path = g_strdup (filename);
+        }
+
+        uri = g_filename_to_uri (path, NULL, &err);
+        g_free (path);
+
+        if (err) {
+                g_warning ("Couldn't convert filename to URI: %s\n",
+                           err->message);
+                g_error_free (err);
+        }
+
+        return uri;
+}
+
 static void
 process_file (GUPnPDLNADiscoverer *discover, const gchar *filename)
 {
         GError *err = NULL;
         GDir *dir;
-        gchar *uri, *path;
+        gchar *uri;
         GUPnPDLNAInformation *dlna;
 
         if(!gst_uri_is_valid (filename)) {
@@ -369,45 +676,30 @@ process_file (GUPnPDLNADiscoverer *discover, const gchar *filename)
                         return;
                 }
 
-                if (!g_path_is_absolute (filename)) {
-                        gchar *cur_dir;
-
-                        cur_dir = g_get_current_dir ();
-                        path = g_build_filename (cur_dir, filename, NULL);
-                        g_free (cur_dir);
-                } else {
-                        path = g_strdup (filename);
-                }
-
-                uri = g_filename_to_uri (path, NULL, &err);
-                g_free (path);
-                path = NULL;
-
-                if (err) {
-                        g_warning ("Couldn't convert filename to URI: %s\n",
-                                   err->message);
-                        g_error_free (err);
-                        err = NULL;
+                if (!(uri = filename_to_uri (filename)))
                         return;
-                }
         } else {
                 uri = g_strdup (filename);
         }
 
         if (async == FALSE) {
+                GstClockTime start = gst_util_get_timestamp ();
+
                 dlna = gupnp_dlna_discoverer_discover_uri_sync (discover,
                                                                 uri,
                                                                 &err);
+                print_result (dlna,
+                              uri,
+                              err,
+                              gst_util_get_timestamp () - start);
+
                 if (err) {
-                        /* Report error to user, and free error */
-                        fprintf (stderr,
-                                 "Unable to read file: %s\n",
-                                 err->message);
                         g_error_free (err);
                         err = NULL;
-                } else {
-                        print_dlna_info (dlna, err);
                 }
+
+                if (dlna)
+                        g_object_unref (dlna);
         } else {
                 gupnp_dlna_discoverer_discover_uri (discover, uri);
         }
@@ -415,6 +707,346 @@ process_file (GUPnPDLNADiscoverer *discover, const gchar *filename)
         g_free (uri);
 }
 
+static void
+print_latency_histograms (GUPnPDLNADiscoverer *discover)
+{
+        GList *histograms, *i;
+
+        histograms = gupnp_dlna_discoverer_get_latency_histograms (discover);
+
+        g_print ("\nDiscovery latencies:\n");
+
+        for (i = histograms; i; i = i->next) {
+                GstStructure *st = (GstStructure *) i->data;
+                const GValue *buckets;
+                guint count, timeouts, j;
+                guint64 total, p50, p99, next_timeout;
+
+                gst_structure_get_uint (st, "count", &count);
+                gst_structure_get_uint (st, "timeouts", &timeouts);
+                gst_structure_get_uint64 (st, "total", &total);
+                gst_structure_get_uint64 (st, "p50", &p50);
+                gst_structure_get_uint64 (st, "p99", &p99);
+                gst_structure_get_uint64 (st, "timeout", &next_timeout);
+
+                g_print ("  %s: %u done, %u timed out\n",
+                         gst_structure_get_string (st, "format"),
+                         count,
+                         timeouts);
+                if (count) {
+                        g_print ("    mean: %" GST_TIME_FORMAT "\n",
+                                 GST_TIME_ARGS (total / count));
+                        g_print ("    p50 < %" GST_TIME_FORMAT "\n",
+                                 GST_TIME_ARGS (p50));
+                        g_print ("    p99 < %" GST_TIME_FORMAT "\n",
+                                 GST_TIME_ARGS (p99));
+                }
+                g_print ("    timeout: %" GST_TIME_FORMAT "\n",
+                         GST_TIME_ARGS (next_timeout));
+
+                buckets = gst_structure_get_value (st, "buckets");
+                for (j = 0; j < gst_value_array_get_size (buckets); j++) {
+                        guint n = g_value_get_uint
+                                (gst_value_array_get_value (buckets, j));
+
+                        if (n)
+                                g_print ("    < %" GST_TIME_FORMAT ": %u\n",
+                                         GST_TIME_ARGS ((G_GUINT64_CONSTANT (1)
+                                                         << (j + 1)) *
+                                                        GST_USECOND),
+                                         n);
+                }
+
+                gst_structure_free (st);
+        }
+
+        g_list_free (histograms);
+}
+
+static gboolean
+print_rejection (GQuark field_id, const GValue *value, gpointer user_data)
+{
+        const gchar *field = g_quark_to_string (field_id);
+
+        /* Rejections are the fields named after a stream and caps field */
+        if (strchr (field, '.'))
+                g_print ("    rejected on %s: %u\n",
+                         field,
+                         g_value_get_uint (value));
+
+        return TRUE;
+}
+
+static void
+print_stats (GUPnPDLNADiscoverer *discover)
+{
+        GList *list, *i;
+
+        list = gupnp_dlna_discoverer_get_stats (discover);
+        if (!list)
+                return;
+
+        for (i = list; i; i = i->next) {
+                GstStructure *st = (GstStructure *) i->data;
+                guint count, matches;
+
+                if (gst_structure_has_name (st, "match-stats")) {
+                        guint discoveries, matched;
+                        guint64 discovery_time, match_time;
+
+                        gst_structure_get_uint (st,
+                                                "discoveries",
+                                                &discoveries);
+                        gst_structure_get_uint64 (st,
+                                                  "discovery-time",
+                                                  &discovery_time);
+                        gst_structure_get_uint (st, "matches", &matches);
+                        gst_structure_get_uint (st, "matched", &matched);
+                        gst_structure_get_uint64 (st,
+                                                  "match-time",
+                                                  &match_time);
+
+                        g_print ("\nDiscovery: %u files in %"
+                                 GST_TIME_FORMAT "\n",
+                                 discoveries,
+                                 GST_TIME_ARGS (discovery_time));
+                        g_print ("Matching: %u files (%u with a profile) "
+                                 "in %" GST_TIME_FORMAT "\n",
+                                 matches,
+                                 matched,
+                                 GST_TIME_ARGS (match_time));
+                        g_print ("\nProfiles:\n");
+                } else {
+                        gst_structure_get_uint (st, "evaluations", &count);
+                        gst_structure_get_uint (st, "matches", &matches);
+
+                        g_print ("  %s: checked %u times, matched %u\n",
+                                 gst_structure_get_string (st, "name"),
+                                 count,
+                                 matches);
+                        gst_structure_foreach (st, print_rejection, NULL);
+                }
+
+                gst_structure_free (st);
+        }
+
+        g_list_free (list);
+}
+
+static gboolean
+matches_any (const gchar *name, gchar **patterns)
+{
+        for (; patterns && *patterns; patterns++)
+                if (g_pattern_match_simple (*patterns, name))
+                        return TRUE;
+
+        return FALSE;
+}
+
+/* Prepends the URIs of @filename, or of the files below it if it is a
+ * directory, to @uris. Directories are walked in name order and symbolic
+ * links to directories are not followed, so that links cannot loop. */
+static void
+collect_files (const gchar *filename, GList **uris)
+{
+        GDir *dir;
+        gchar *uri;
+
+        if (gst_uri_is_valid (filename)) {
+                *uris = g_list_prepend (*uris, g_strdup (filename));
+                return;
+        }
+
+        if ((dir = g_dir_open (filename, 0, NULL))) {
+                GList *entries = NULL, *i;
+                const gchar *entry;
+
+                while ((entry = g_dir_read_name (dir)))
+                        if (!matches_any (entry, excludes))
+                                entries = g_list_prepend (entries,
+                                                          g_strdup (entry));
+
+                g_dir_close (dir);
+
+                entries = g_list_sort (entries, (GCompareFunc) strcmp);
+
+                for (i = entries; i; i = i->next) {
+                        gchar *path = g_build_filename (filename,
+                                                        i->data,
+                                                        NULL);
+
+                        if (g_file_test (path, G_FILE_TEST_IS_DIR)) {
+                                if (!g_file_test (path,
+                                                  G_FILE_TEST_IS_SYMLINK))
+                                        collect_files (path, uris);
+                        } else if (!includes ||
+                                   matches_any (i->data, includes)) {
+                                collect_files (path, uris);
+                        }
+
+                        g_free (path);
+                        g_free (i->data);
+                }
+
+                g_list_free (entries);
+                return;
+        }
+
+        if ((uri = filename_to_uri (filename)))
+                *uris = g_list_prepend (*uris, uri);
+}
+
+static void
+batch_worker (gchar *uri, BatchState *state)
+{
+        GUPnPDLNADiscoverer *discover;
+        GUPnPDLNAInformation *dlna;
+        GError *err = NULL;
+        GstClockTime start, elapsed;
+        const gchar *status;
+
+        discover = g_async_queue_pop (state->discoverers);
+
+        start = gst_util_get_timestamp ();
+        dlna = gupnp_dlna_discoverer_discover_uri_sync (discover, uri, &err);
+        elapsed = gst_util_get_timestamp () - start;
+
+        g_async_queue_push (state->discoverers, discover);
+
+        status = get_status (dlna, err);
+
+        g_mutex_lock (state->lock);
+
+        if (g_str_equal (status, "error"))
+                state->errors++;
+        else if (g_str_equal (status, "matched"))
+                state->matched++;
+        else
+                state->unmatched++;
+
+        g_array_append_val (state->latencies, elapsed);
+
+        print_result (dlna, uri, err, elapsed);
+
+        g_mutex_unlock (state->lock);
+
+        if (err)
+                g_error_free (err);
+        if (dlna)
+                g_object_unref (dlna);
+        g_free (uri);
+}
+
+static gint
+compare_times (gconstpointer a, gconstpointer b)
+{
+        GstClockTime time_a = *(const GstClockTime *) a;
+        GstClockTime time_b = *(const GstClockTime *) b;
+
+        return (time_a > time_b) - (time_a < time_b);
+}
+
+/* Nearest-rank percentile of the sorted @times */
+static GstClockTime
+percentile (const GstClockTime *times, guint n, guint p)
+{
+        guint rank = (n * p + 99) / 100;
+
+        return times[rank ? rank - 1 : 0];
+}
+
+static void
+print_batch_summary (BatchState *state, GstClockTime wall_time)
+{
+        guint n = state->latencies->len;
+        const GstClockTime *times;
+
+        g_array_sort (state->latencies, compare_times);
+        times = (const GstClockTime *) state->latencies->data;
+
+        g_printerr ("\n%u files in %" GST_TIME_FORMAT " with %d jobs "
+                    "(%.1f files/s)\n",
+                    n,
+                    GST_TIME_ARGS (wall_time),
+                    jobs,
+                    wall_time ? n * (gdouble) GST_SECOND / wall_time : 0.0);
+        g_printerr ("Matched: %u, unmatched: %u, errors: %u\n",
+                    state->matched,
+                    state->unmatched,
+                    state->errors);
+
+        if (!n)
+                return;
+
+        g_printerr ("Latency: p50 %" GST_TIME_FORMAT
+                    ", p90 %" GST_TIME_FORMAT
+                    ", p99 %" GST_TIME_FORMAT
+                    ", max %" GST_TIME_FORMAT "\n",
+                    GST_TIME_ARGS (percentile (times, n, 50)),
+                    GST_TIME_ARGS (percentile (times, n, 90)),
+                    GST_TIME_ARGS (percentile (times, n, 99)),
+                    GST_TIME_ARGS (times[n - 1]));
+}
+
+/* Walks the command line arguments and discovers every file found on @jobs
+ * threads, each with its own discoverer. Returns FALSE if any file could not
+ * be discovered. */
+static gboolean
+run_batch (int argc, char **argv, GUPnPDLNADiscoverer **discoverers)
+{
+        BatchState state = { NULL, };
+        GThreadPool *pool;
+        GList *uris = NULL, *i;
+        GstClockTime start;
+        GError *err = NULL;
+        gint j;
+
+        for (j = 1; j < argc; j++)
+                collect_files (argv[j], &uris);
+        uris = g_list_reverse (uris);
+
+        state.discoverers = g_async_queue_new ();
+        state.lock = g_mutex_new ();
+        state.latencies = g_array_sized_new (FALSE,
+                                             FALSE,
+                                             sizeof (GstClockTime),
+                                             g_list_length (uris));
+
+        for (j = 0; j < jobs; j++)
+                g_async_queue_push (state.discoverers, discoverers[j]);
+
+        start = gst_util_get_timestamp ();
+
+        pool = g_thread_pool_new ((GFunc) batch_worker,
+                                  &state,
+                                  jobs,
+                                  TRUE,
+                                  &err);
+        if (!pool) {
+                g_printerr ("Could not start the worker threads: %s\n",
+                            err->message);
+                g_error_free (err);
+                exit (1);
+        }
+
+        for (i = uris; i; i = i->next)
+                g_thread_pool_push (pool, i->data, NULL);
+        g_list_free (uris);
+
+        /* Waits for all the files to be processed */
+        g_thread_pool_free (pool, FALSE, TRUE);
+
+        print_batch_summary (&state, gst_util_get_timestamp () - start);
+
+        for (j = 0; j < jobs; j++)
+                g_async_queue_pop (state.discoverers);
+        g_async_queue_unref (state.discoverers);
+        g_mutex_free (state.lock);
+        g_array_free (state.latencies, TRUE);
+
+        return state.errors == 0;
+}
+
 static gboolean
 async_idle_loop (PrivStruct * ps)
 {
@@ -426,14 +1058,48 @@ async_idle_loop (PrivStruct * ps)
         return FALSE;
 }
 
+static GUPnPDLNADiscoverer *
+create_discoverer (gboolean relaxed_mode, gboolean extended_mode)
+{
+        GUPnPDLNADiscoverer *discover;
+        GError *err = NULL;
+
+        discover = gupnp_dlna_discoverer_new ((GstClockTime)
+                                              (timeout * GST_SECOND),
+                                              relaxed_mode,
+                                              extended_mode);
+        g_object_set (discover,
+                      "fast-probe", fast_probe,
+                      "skip-non-media", skip_non_media,
+                      "compact-results", compact,
+                      "adaptive-timeout", adaptive_timeout,
+                      "collect-stats", stats,
+                      "adaptive-order", profile_order != NULL,
+                      NULL);
+
+        if (profile_order &&
+            g_file_test (profile_order, G_FILE_TEST_EXISTS) &&
+            !gupnp_dlna_discoverer_load_profile_order (discover,
+                                                       profile_order,
+                                                       &err)) {
+                g_warning ("Could not load the profile order: %s",
+                           err->message);
+                g_clear_error (&err);
+        }
+
+        return discover;
+}
+
 /* Main */
 int
 main (int argc, char **argv)
 {
-        gint i;
+        gint i, n_discoverers;
+        GUPnPDLNADiscoverer **discoverers;
         GUPnPDLNADiscoverer *discover;
         gboolean relaxed_mode = FALSE;
         gboolean extended_mode = FALSE;
+        gboolean ok = TRUE;
         GError *err = NULL;
 
         GOptionEntry options[] = {
@@ -447,6 +1113,38 @@ main (int argc, char **argv)
                  "Enable Relaxed mode", NULL},
                 {"extended mode", 'e', 0, G_OPTION_ARG_NONE, &extended_mode,
                  "Enable extended mode", NULL},
+                {"fast-probe", 'f', 0, G_OPTION_ARG_NONE, &fast_probe,
+                 "Parse image and MP3/ADTS headers directly when possible "
+                 "(synchronous mode only)", NULL},
+                {"skip-non-media", 'n', 0, G_OPTION_ARG_NONE, &skip_non_media,
+                 "Do not discover files that do not look like media", NULL},
+                {"adaptive-timeout", 'A', 0, G_OPTION_ARG_NONE,
+                 &adaptive_timeout,
+                 "Shorten the timeout based on the latencies seen for each "
+                 "kind of file (synchronous mode only)", NULL},
+                {"latency", 'l', 0, G_OPTION_ARG_NONE, &latency,
+                 "Print discovery latency histograms at the end "
+                 "(synchronous mode only)", NULL},
+                {"compact", 'c', 0, G_OPTION_ARG_NONE, &compact,
+                 "Only keep a summary of the stream information", NULL},
+                {"stats", 's', 0, G_OPTION_ARG_NONE, &stats,
+                 "Print profile matching statistics at the end", NULL},
+                {"profile-order", 'o', 0, G_OPTION_ARG_FILENAME,
+                 &profile_order,
+                 "Check the most frequently matched profiles first, keeping "
+                 "what was learnt in FILE", "FILE"},
+                {"format", 'F', 0, G_OPTION_ARG_STRING, &format_name,
+                 "Print one json, csv or tsv record per file instead of "
+                 "text (with -j, defaults to tsv)", "FORMAT"},
+                {"jobs", 'j', 0, G_OPTION_ARG_INT, &jobs,
+                 "Walk the given files and directories and discover them on "
+                 "N threads, printing one line per file", "N"},
+                {"include", 'i', 0, G_OPTION_ARG_STRING_ARRAY, &includes,
+                 "Only discover the files matching GLOB when walking "
+                 "directories (with -j, can be repeated)", "GLOB"},
+                {"exclude", 'x', 0, G_OPTION_ARG_STRING_ARRAY, &excludes,
+                 "Skip the files and directories matching GLOB when walking "
+                 "directories (with -j, can be repeated)", "GLOB"},
                 {NULL}
         };
 
@@ -472,16 +1170,49 @@ main (int argc, char **argv)
                 return -1;
         }
 
+        if (!format_name)
+                format = jobs > 0 ? FORMAT_TSV : FORMAT_TEXT;
+        else if (g_str_equal (format_name, "text"))
+                format = FORMAT_TEXT;
+        else if (g_str_equal (format_name, "json"))
+                format = FORMAT_JSON;
+        else if (g_str_equal (format_name, "csv"))
+                format = FORMAT_CSV;
+        else if (g_str_equal (format_name, "tsv"))
+                format = FORMAT_TSV;
+        else {
+                g_print ("Unknown output format: %s\n", format_name);
+                return -1;
+        }
+
+        if (jobs > 1 && profile_order) {
+                g_print ("--profile-order can only be used with one job\n");
+                return -1;
+        }
+
         gst_init(&argc, &argv);
 
-        discover = gupnp_dlna_discoverer_new ((GstClockTime)
-                                              (timeout * GST_SECOND),
-                                              relaxed_mode,
-                                              extended_mode);
+        n_discoverers = MAX (jobs, 1);
+        discoverers = g_new0 (GUPnPDLNADiscoverer *, n_discoverers);
+        for (i = 0; i < n_discoverers; i++)
+                discoverers[i] = create_discoverer (relaxed_mode,
+                                                   extended_mode);
+        discover = discoverers[0];
 
-        if (async == FALSE) {
+        print_header ();
+
+        if (jobs > 0) {
+                ok = run_batch (argc, argv, discoverers);
+
+                if (latency)
+                        for (i = 0; i < n_discoverers; i++)
+                                print_latency_histograms (discoverers[i]);
+        } else if (async == FALSE) {
                 for ( i = 1 ; i < argc ; i++ )
                         process_file (discover, argv[i]);
+
+                if (latency)
+                        print_latency_histograms (discover);
         } else {
                 PrivStruct *ps = g_new0 (PrivStruct, 1);
                 GMainLoop *ml = g_main_loop_new (NULL, FALSE);
@@ -504,6 +1235,23 @@ main (int argc, char **argv)
                 gupnp_dlna_discoverer_stop (discover);
 
         }
-        g_object_unref (discover);
-        return 0;
+
+        if (stats)
+                for (i = 0; i < n_discoverers; i++)
+                        print_stats (discoverers[i]);
+
+        if (profile_order &&
+            !gupnp_dlna_discoverer_save_profile_order (discover,
+                                                       profile_order,
+                                                       &err)) {
+                g_warning ("Could not save the profile order: %s",
+                           err->message);
+                g_clear_error (&err);
+        }
+
+        for (i = 0; i < n_discoverers; i++)
+                g_object_unref (discoverers[i]);
+        g_free (discoverers);
+
+        return ok ? 0 : 1;
 }